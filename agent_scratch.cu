@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/sequence.h>
+#include <cassert>
+
+// each agent reverses its grain of the input through a private array of grainsize elements
+// which is too large to keep in registers
+struct reverse_each_grain
+{
+  template<std::size_t groupsize, std::size_t grainsize>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, thrust::device_ptr<int> data)
+  {
+    // each agent gets a private slice of the group's heap
+    bulk::agent_scratch_arena arena(g, grainsize * sizeof(int));
+
+    thrust::device_ptr<int> grain = data + grainsize * (groupsize * g.index() + g.this_exec.index());
+
+    {
+      // bump allocated from this agent's slice
+      bulk::agent_scratch<int> local(arena, grainsize);
+
+      bulk::copy_n(bulk::bound<grainsize>(g.this_exec), grain, grainsize, local.begin());
+
+      for(std::size_t i = 0; i < grainsize; ++i)
+      {
+        grain[i] = local[grainsize - i - 1];
+      }
+    }
+
+    // the arena may not be destroyed while agents use their scratch
+    g.wait();
+  }
+};
+
+int main()
+{
+  const size_t groupsize = 128;
+  const size_t grainsize = 64;
+  const size_t num_groups = 10;
+
+  thrust::device_vector<int> vec(num_groups * groupsize * grainsize);
+  thrust::sequence(vec.begin(), vec.end());
+
+  // room for every agent's slice, plus alignment
+  size_t heap_size = groupsize * grainsize * sizeof(int) + bulk::detail::agent_scratch_alignment;
+
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), reverse_each_grain(), bulk::root.this_exec, vec.data()).wait();
+
+  for(size_t grain = 0; grain < num_groups * groupsize; grain += 97)
+  {
+    assert(vec[grain * grainsize] == int(grain * grainsize + grainsize - 1));
+  }
+
+  std::printf("OK\n");
+}
@@ -0,0 +1,124 @@
+#include <bulk/detail/host_barrier.hpp>
+#include <bulk/detail/host_affinity.hpp>
+#include <pthread.h>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include "time_invocation_cuda.hpp"
+
+// measures the latency of the host barriers with one thread per participant
+// usage: barrier_latency [none|compact|scatter]
+
+typedef bulk::detail::host_barrier barrier_type;
+
+struct participant
+{
+  const bulk::detail::affinity *placement;
+  barrier_type *barrier;
+  unsigned int index;
+  unsigned int num_trials;
+  double elapsed_ns;
+};
+
+void *run_participant(void *arg)
+{
+  participant &self = *static_cast<participant*>(arg);
+
+  bulk::detail::pin_this_thread(self.placement->cpu_for_worker(self.index));
+
+  // warm up
+  for(unsigned int i = 0; i < 100; ++i)
+  {
+    self.barrier->wait(self.index);
+  }
+
+  double start = wall_clock_ns();
+
+  for(unsigned int i = 0; i < self.num_trials; ++i)
+  {
+    self.barrier->wait(self.index);
+  }
+
+  self.elapsed_ns = wall_clock_ns() - start;
+
+  return 0;
+}
+
+double ns_per_barrier(const bulk::detail::affinity &placement, unsigned int num_participants, barrier_type::kind kind, unsigned int num_trials)
+{
+  barrier_type barrier(num_participants, kind);
+
+  std::vector<participant> participants(num_participants);
+  std::vector<pthread_t> threads(num_participants);
+
+  for(unsigned int i = 0; i < num_participants; ++i)
+  {
+    participants[i].placement = &placement;
+    participants[i].barrier = &barrier;
+    participants[i].index = i;
+    participants[i].num_trials = num_trials;
+    participants[i].elapsed_ns = 0;
+
+    pthread_create(&threads[i], 0, run_participant, &participants[i]);
+  }
+
+  double max_elapsed_ns = 0;
+  for(unsigned int i = 0; i < num_participants; ++i)
+  {
+    pthread_join(threads[i], 0);
+
+    if(participants[i].elapsed_ns > max_elapsed_ns) max_elapsed_ns = participants[i].elapsed_ns;
+  }
+
+  return max_elapsed_ns / num_trials;
+}
+
+const char *kind_name(barrier_type::kind kind)
+{
+  switch(kind)
+  {
+    case barrier_type::centralized:   return "centralized";
+    case barrier_type::dissemination: return "dissemination";
+    case barrier_type::tree:          return "tree";
+    default:                          return "automatic";
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const unsigned int num_trials = 10000;
+
+  bulk::detail::affinity::kind placement_kind = bulk::detail::affinity::compact;
+  if(argc > 1)
+  {
+    std::string arg = argv[1];
+    if(arg == "none")    placement_kind = bulk::detail::affinity::none;
+    if(arg == "scatter") placement_kind = bulk::detail::affinity::scatter;
+  }
+
+  bulk::detail::affinity placement(placement_kind);
+
+  barrier_type::kind kinds[] = {barrier_type::centralized, barrier_type::dissemination, barrier_type::tree, barrier_type::automatic};
+
+  std::printf("%12s", "participants");
+  for(int k = 0; k < 4; ++k)
+  {
+    std::printf(" %14s", kind_name(kinds[k]));
+  }
+  std::printf("   (ns per barrier, automatic chooses)\n");
+
+  for(unsigned int n = 2; n <= 128; n *= 2)
+  {
+    std::printf("%12u", n);
+
+    for(int k = 0; k < 4; ++k)
+    {
+      std::printf(" %14.1f", ns_per_barrier(placement, n, kinds[k], num_trials));
+    }
+
+    std::printf("   %s\n", kind_name(barrier_type::choose_kind(n)));
+  }
+
+  return 0;
+}
+
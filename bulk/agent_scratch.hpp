@@ -0,0 +1,259 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/scoped_buffer.hpp>
+#include <bulk/iterator/strided_iterator.hpp>
+#include <cstddef>
+#include <cstdlib>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// on the host, agents' slices of an agent_scratch_arena, and the agent_scratches within them,
+// are contiguous & aligned to, and occupy a multiple of, a cache line, so that no two agents
+// share a line
+//
+// on the device, the arena is in shared memory, where agents accessing the same element of
+// contiguous slices would hit the same bank. so the slices are interleaved instead: element i
+// of agent t's scratch is at i * groupsize + t, & a warp's accesses fall in consecutive banks.
+// the slices then need only the alignment of a scoped_buffer
+#ifdef __CUDA_ARCH__
+static const std::size_t agent_scratch_alignment = scoped_buffer_alignment;
+#else
+static const std::size_t agent_scratch_alignment = 64;
+#endif
+
+
+inline __host__ __device__ std::size_t agent_scratch_footprint(std::size_t num_bytes)
+{
+  return (num_bytes + agent_scratch_alignment - 1) / agent_scratch_alignment * agent_scratch_alignment;
+} // end agent_scratch_footprint()
+
+
+} // end detail
+
+
+template<typename T> class agent_scratch;
+
+
+// gives each agent of a concurrent_group a private slice of bytes_per_agent bytes
+// of the group's heap, from which its agent_scratches are bump allocated
+//
+// each agent's arena object keeps the unused part of that agent's slice, so the agent
+// passes it to its agent_scratches. every agent of the group must construct & destroy
+// the arena together, and like a scoped_buffer, the group must wait between the agents'
+// last use of their scratch and the arena's destruction. because the device's slices are
+// interleaved, there every agent must also construct the same sequence of agent_scratches
+class agent_scratch_arena
+{
+  public:
+    typedef int size_type;
+
+    template<std::size_t groupsize, std::size_t grainsize>
+    __device__
+    agent_scratch_arena(concurrent_group<bulk::agent<grainsize>,groupsize> &g, size_type bytes_per_agent)
+#ifdef __CUDA_ARCH__
+      : m_buffer(g, g.size() * detail::agent_scratch_footprint(bytes_per_agent))
+#else
+      : m_buffer(g, g.size() * detail::agent_scratch_footprint(bytes_per_agent) + detail::agent_scratch_alignment)
+#endif
+    {
+      size_type slice_size = detail::agent_scratch_footprint(bytes_per_agent);
+
+      m_top = 0;
+      m_end = slice_size;
+
+#ifdef __CUDA_ARCH__
+      // scoped_buffers are aligned like slices, which begin together & interleave
+      m_base = m_buffer.data();
+      m_interleave = g.size();
+      m_offset = g.this_exec.index();
+#else
+      // scoped_buffers are aligned less strictly than slices
+      std::size_t misalignment = reinterpret_cast<std::size_t>(m_buffer.data()) % detail::agent_scratch_alignment;
+      char *first_slice = m_buffer.data() + (misalignment ? detail::agent_scratch_alignment - misalignment : 0);
+
+      m_base = first_slice + g.this_exec.index() * slice_size;
+      m_interleave = 1;
+      m_offset = 0;
+#endif
+    } // end agent_scratch_arena()
+
+
+  private:
+    template<typename> friend class bulk::agent_scratch;
+
+    // XXX delete these unless we find a need for them
+    agent_scratch_arena(const agent_scratch_arena &);
+    agent_scratch_arena &operator=(const agent_scratch_arena &);
+
+    // the first of n Ts which begin top bytes into this agent's slice
+    template<typename T>
+    __host__ __device__
+    T *element_zero(size_type top) const
+    {
+      return reinterpret_cast<T*>(m_base + top * m_interleave) + m_offset;
+    } // end element_zero()
+
+    // the unused part of this agent's slice, [m_top, m_end), in bytes of the slice
+    size_type m_top;
+    size_type m_end;
+
+    // where the slices begin, how many slices interleave, & this agent's position among them
+    char *m_base;
+    size_type m_interleave;
+    size_type m_offset;
+
+    scoped_buffer<char> m_buffer;
+}; // end agent_scratch_arena
+
+
+// an array of n Ts private to an agent which lives until the end of its scope
+//
+// agent_scratches are bump allocated from the agent's slice of an agent_scratch_arena,
+// in last-in first-out order, so constructing & destroying one touches only the agent's
+// own arena. an agent whose slice is exhausted gets its scratch from malloc instead
+//
+// in an interleaved slice, consecutive elements are stride() elements apart, so
+// the scratch is accessed through operator[] or its strided iterators
+//
+// this gives agents of large grainsize somewhere to keep arrays like
+//
+//   input_type local_inputs[grainsize];
+//
+// which would otherwise spill unpredictably or overflow the agent's stack
+// the elements are not constructed
+template<typename T>
+class agent_scratch
+{
+  public:
+    typedef T                     value_type;
+    typedef strided_iterator<T*>  iterator;
+    typedef int                   size_type;
+
+    __host__ __device__
+    agent_scratch(agent_scratch_arena &arena, size_type n)
+      : m_size(n),
+        m_stride(1),
+        m_top(&arena.m_top),
+        m_previous_top(arena.m_top)
+    {
+      std::size_t num_bytes = detail::agent_scratch_footprint(n * sizeof(T));
+
+      m_in_arena = static_cast<std::size_t>(arena.m_end - m_previous_top) >= num_bytes;
+
+      if(m_in_arena)
+      {
+        m_data = arena.element_zero<T>(m_previous_top);
+        m_stride = arena.m_interleave;
+        *m_top = m_previous_top + num_bytes;
+      } // end if
+      else
+      {
+#if !defined(__CUDA_ARCH__) || __CUDA_ARCH__ >= 200
+        m_data = reinterpret_cast<T*>(std::malloc(n * sizeof(T)));
+#else
+        m_data = 0;
+#endif
+      } // end else
+    } // end agent_scratch()
+
+
+    __host__ __device__
+    ~agent_scratch()
+    {
+      if(m_in_arena)
+      {
+        *m_top = m_previous_top;
+      } // end if
+      else
+      {
+#if !defined(__CUDA_ARCH__) || __CUDA_ARCH__ >= 200
+        std::free(m_data);
+#endif
+      } // end else
+    } // end ~agent_scratch()
+
+
+    // the first element, which is followed by the others every stride() elements
+    __host__ __device__
+    T *data() const
+    {
+      return m_data;
+    }
+
+
+    __host__ __device__
+    size_type stride() const
+    {
+      return m_stride;
+    }
+
+
+    __host__ __device__
+    size_type size() const
+    {
+      return m_size;
+    }
+
+
+    __host__ __device__
+    iterator begin() const
+    {
+      return iterator(m_data, m_stride);
+    }
+
+
+    __host__ __device__
+    iterator end() const
+    {
+      return iterator(m_data + m_size * m_stride, m_stride);
+    }
+
+
+    __host__ __device__
+    T &operator[](size_type i) const
+    {
+      return m_data[i * m_stride];
+    }
+
+
+  private:
+    // XXX delete these unless we find a need for them
+    agent_scratch(const agent_scratch &);
+    agent_scratch &operator=(const agent_scratch &);
+
+    T *m_data;
+    size_type m_size;
+    size_type m_stride;
+    size_type *m_top;
+    size_type m_previous_top;
+    bool m_in_arena;
+}; // end agent_scratch
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -19,6 +19,7 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/reduce.hpp>
 #include <bulk/execution_policy.hpp>
+#include <bulk/scoped_buffer.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/detail/type_traits/function_traits.h>
 
@@ -142,7 +143,8 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   > buffer_type;
 
 #if __CUDA_ARCH__ >= 200
-  buffer_type *buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
+  bulk::scoped_buffer<buffer_type> buffer_impl(g, 1);
+  buffer_type *buffer = buffer_impl.data();
 #else
   __shared__ uninitialized<buffer_type> buffer_impl;
   buffer_type *buffer = &buffer_impl.get();
@@ -185,10 +187,6 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     sum = accumulate_detail::destructive_accumulate_n(g, buffer->sums.data(), thrust::min<size_type>(groupsize,n), sum, binary_op);
   } // end for
 
-#if __CUDA_ARCH__ >= 200
-  bulk::free(g, buffer);
-#endif
-
   return sum;
 } // end accumulate
 } // end accumulate_detail
@@ -20,7 +20,11 @@
 #include <bulk/execution_policy.hpp>
 #include <bulk/detail/is_contiguous_iterator.hpp>
 #include <bulk/detail/pointer_traits.hpp>
+#include <bulk/detail/tile_loader.hpp>
 #include <thrust/detail/type_traits.h>
+#include <thrust/detail/raw_pointer_cast.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/tuple.h>
 
 
 BULK_NAMESPACE_PREFIX
@@ -166,24 +170,248 @@ typename thrust::detail::enable_if<
 } // end simple_copy_n()
 
 
+// stages each tile of the input in registers through its tile_loader, which decodes the whole tile at once
+// groups without a static size copy element by element, because tile_loader needs a static tile size
 template<std::size_t size,
          std::size_t grainsize,
          typename RandomAccessIterator1,
          typename Size,
          typename RandomAccessIterator2>
 __forceinline__ __device__
-RandomAccessIterator2 copy_n(concurrent_group<
-                               agent<grainsize>,
-                               size
-                             > &g,
-                             RandomAccessIterator1 first,
-                             Size n,
-                             RandomAccessIterator2 result)
+RandomAccessIterator2 decoding_copy_n(bulk::concurrent_group<
+                                        agent<grainsize>,
+                                        size
+                                      > &g,
+                                      RandomAccessIterator1 first, Size n,
+                                      RandomAccessIterator2 result)
+{
+  typedef bulk::concurrent_group<
+    agent<grainsize>,
+    size
+  > group_type;
+
+  typedef typename group_type::size_type size_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+  const size_type chunk_size = size * grainsize;
+
+  size_type tid = g.this_exec.index();
+
+  // XXX we use offset as the loop counter variable instead of first
+  //     for the same reason bulk::reduce does
+  for(Size offset = 0; offset < n; offset += chunk_size)
+  {
+    size_type partition_size = thrust::min<Size>(chunk_size, n - offset);
+
+    value_type stage[grainsize];
+
+    tile_loader<RandomAccessIterator1>::template load<size,grainsize>(g, first + offset, partition_size, stage);
+
+    for(size_type i = 0; i < grainsize; ++i)
+    {
+      size_type idx = size * i + tid;
+      if(idx < partition_size)
+      {
+        result[offset + idx] = stage[i];
+      } // end if
+    } // end for
+  } // end for
+
+  g.wait();
+
+  return result + n;
+} // end decoding_copy_n()
+
+
+// copies the n elements of one field of a structure of arrays. when the two arrays hold the same
+// trivially copyable type & are equally misaligned, the group copies them sixteen bytes at a time
+// after peeling the elements up to the first aligned vector
+template<typename ConcurrentGroup, typename T1, typename Size, typename T2>
+__forceinline__ __device__
+void contiguous_copy_n(ConcurrentGroup &g, T1 *first, Size n, T2 *result)
+{
+  typedef uint4 vector_type;
+
+  const std::size_t vector_size = sizeof(vector_type);
+
+  Size tid = g.this_exec.index();
+
+  std::size_t misalignment = reinterpret_cast<std::size_t>(first) % vector_size;
+
+  if(thrust::detail::is_same<typename thrust::detail::remove_const<T1>::type, T2>::value &&
+     thrust::detail::has_trivial_assign<T2>::value &&
+     vector_size % sizeof(T2) == 0 &&
+     misalignment % sizeof(T2) == 0 &&
+     misalignment == reinterpret_cast<std::size_t>(result) % vector_size)
+  {
+    const Size elements_per_vector = vector_size / sizeof(T2);
+
+    Size head = thrust::min<Size>(n, ((vector_size - misalignment) % vector_size) / sizeof(T2));
+    Size num_vectors = (n - head) / elements_per_vector;
+    Size tail = head + num_vectors * elements_per_vector;
+
+    // XXX the head & the tail are shorter than a vector, so most of the group idles while they are copied
+    for(Size i = tid; i < head; i += g.size())
+    {
+      result[i] = first[i];
+    } // end for i
+
+    const vector_type *vector_first = reinterpret_cast<const vector_type*>(first + head);
+    vector_type *vector_result = reinterpret_cast<vector_type*>(result + head);
+
+    for(Size i = tid; i < num_vectors; i += g.size())
+    {
+      vector_result[i] = vector_first[i];
+    } // end for i
+
+    for(Size i = tail + tid; i < n; i += g.size())
+    {
+      result[i] = first[i];
+    } // end for i
+  } // end if
+  else
+  {
+    for(Size i = tid; i < n; i += g.size())
+    {
+      result[i] = first[i];
+    } // end for i
+  } // end else
+} // end contiguous_copy_n()
+
+
+template<unsigned int i, unsigned int size>
+struct fieldwise_copier
+{
+  template<typename ConcurrentGroup, typename IteratorTuple1, typename Size, typename IteratorTuple2>
+  __forceinline__ __device__
+  static void copy_n(ConcurrentGroup &g, const IteratorTuple1 &first, Size n, const IteratorTuple2 &result)
+  {
+    detail::contiguous_copy_n(g,
+                              thrust::raw_pointer_cast(&*thrust::get<i>(first)),
+                              n,
+                              thrust::raw_pointer_cast(&*thrust::get<i>(result)));
+
+    fieldwise_copier<i+1,size>::copy_n(g, first, n, result);
+  } // end copy_n()
+}; // end fieldwise_copier
+
+
+template<unsigned int size>
+struct fieldwise_copier<size,size>
+{
+  template<typename ConcurrentGroup, typename IteratorTuple1, typename Size, typename IteratorTuple2>
+  __forceinline__ __device__
+  static void copy_n(ConcurrentGroup &, const IteratorTuple1 &, Size, const IteratorTuple2 &)
+  {
+  } // end copy_n()
+}; // end fieldwise_copier
+
+
+// zip_iterators over the same number of contiguous fields, like the iterators of soa_vectors,
+// are copied one field at a time rather than by assigning a tuple of references per element
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct is_fieldwise_copyable
+  : thrust::detail::false_type
+{};
+
+
+template<typename IteratorTuple1, typename IteratorTuple2>
+struct is_fieldwise_copyable<thrust::zip_iterator<IteratorTuple1>, thrust::zip_iterator<IteratorTuple2> >
+  : thrust::detail::integral_constant<
+      bool,
+      is_contiguous_zip_iterator<thrust::zip_iterator<IteratorTuple1> >::value &&
+      is_contiguous_zip_iterator<thrust::zip_iterator<IteratorTuple2> >::value &&
+      (thrust::tuple_size<IteratorTuple1>::value == thrust::tuple_size<IteratorTuple2>::value)
+    >
+{};
+
+
+template<typename ConcurrentGroup,
+         typename IteratorTuple1,
+         typename Size,
+         typename IteratorTuple2>
+__forceinline__ __device__
+thrust::zip_iterator<IteratorTuple2>
+  fieldwise_copy_n(ConcurrentGroup &g,
+                   thrust::zip_iterator<IteratorTuple1> first,
+                   Size n,
+                   thrust::zip_iterator<IteratorTuple2> result)
+{
+  fieldwise_copier<0, thrust::tuple_size<IteratorTuple1>::value>::copy_n(g, first.get_iterator_tuple(), n, result.get_iterator_tuple());
+
+  g.wait();
+
+  return result + n;
+} // end fieldwise_copy_n()
+
+
+template<std::size_t size,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::disable_if<
+  ((size * grainsize > 0) && tile_loader<RandomAccessIterator1>::decodes_tiles) ||
+  is_fieldwise_copyable<RandomAccessIterator1,RandomAccessIterator2>::value,
+  RandomAccessIterator2
+>::type
+  copy_n(concurrent_group<
+           agent<grainsize>,
+           size
+         > &g,
+         RandomAccessIterator1 first,
+         Size n,
+         RandomAccessIterator2 result)
 {
   return detail::simple_copy_n(g, first, n, result);
 } // end copy_n()
 
 
+template<std::size_t size,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (size * grainsize > 0) && tile_loader<RandomAccessIterator1>::decodes_tiles,
+  RandomAccessIterator2
+>::type
+  copy_n(concurrent_group<
+           agent<grainsize>,
+           size
+         > &g,
+         RandomAccessIterator1 first,
+         Size n,
+         RandomAccessIterator2 result)
+{
+  return detail::decoding_copy_n(g, first, n, result);
+} // end copy_n()
+
+
+template<std::size_t size,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  is_fieldwise_copyable<RandomAccessIterator1,RandomAccessIterator2>::value,
+  RandomAccessIterator2
+>::type
+  copy_n(concurrent_group<
+           agent<grainsize>,
+           size
+         > &g,
+         RandomAccessIterator1 first,
+         Size n,
+         RandomAccessIterator2 result)
+{
+  return detail::fieldwise_copy_n(g, first, n, result);
+} // end copy_n()
+
+
 } // end detail
 
 
@@ -203,7 +431,8 @@ RandomAccessIterator2
 template<std::size_t bound, std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
 __device__
 typename thrust::detail::enable_if<
-  (bound <= groupsize * grainsize),
+  (bound <= groupsize * grainsize) &&
+  !detail::is_fieldwise_copyable<RandomAccessIterator1,RandomAccessIterator2>::value,
   RandomAccessIterator2 
 >::type
 copy_n(bulk::bounded<
@@ -234,15 +463,11 @@ copy_n(bulk::bounded<
   // XXX make this an uninitialized array
   value_type stage[grainsize];
 
+  detail::tile_loader<RandomAccessIterator1>::template load<groupsize,grainsize>(g, first, thrust::min<Size>(groupsize * grainsize, n), stage);
+
   // avoid conditional accesses when possible
   if(groupsize * grainsize <= n)
   {
-    for(size_type i = 0; i < grainsize; ++i)
-    {
-      size_type src_idx = g.size() * i + tid;
-      stage[i] = first[src_idx];
-    } // end for i
-
     for(size_type i = 0; i < grainsize; ++i)
     {
       size_type dst_idx = g.size() * i + tid;
@@ -251,15 +476,6 @@ copy_n(bulk::bounded<
   } // end if
   else
   {
-    for(size_type i = 0; i < grainsize; ++i)
-    {
-      size_type src_idx = g.size() * i + tid;
-      if(src_idx < n)
-      {
-        stage[i] = first[src_idx];
-      } // end if
-    } // end for
-
     for(size_type i = 0; i < grainsize; ++i)
     {
       size_type dst_idx = g.size() * i + tid;
@@ -276,6 +492,28 @@ copy_n(bulk::bounded<
 } // end copy_n()
 
 
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize) &&
+  detail::is_fieldwise_copyable<RandomAccessIterator1,RandomAccessIterator2>::value,
+  RandomAccessIterator2 
+>::type
+copy_n(bulk::bounded<
+         bound,
+         concurrent_group<
+           agent<grainsize>,
+           groupsize
+         >
+       > &g,
+       RandomAccessIterator1 first,
+       Size n,
+       RandomAccessIterator2 result)
+{
+  return detail::fieldwise_copy_n(g, first, thrust::min<Size>(groupsize * grainsize, n), result);
+} // end copy_n()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -18,6 +18,7 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
+#include <bulk/scoped_buffer.hpp>
 #include <bulk/algorithm/gather.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/algorithm/merge.hpp>
@@ -153,7 +154,8 @@ stable_merge_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<
     value_type *values;
   } stage;
 
-  stage.keys = static_cast<key_type*>(bulk::malloc(g, tile_size * thrust::max(sizeof(key_type), sizeof(value_type))));
+  bulk::scoped_buffer<char> stage_impl(g, tile_size * thrust::max(sizeof(key_type), sizeof(value_type)));
+  stage.keys = reinterpret_cast<key_type*>(stage_impl.data());
 #else
   __shared__ union
   {
@@ -199,10 +201,6 @@ stable_merge_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<
   g.wait();
 
   bulk::copy_n(bulk::bound<tile_size>(g), stage.values, n, values_first);
-
-#if __CUDA_ARCH__ >= 200
-  bulk::free(g, stage.keys);
-#endif
 } // end stable_merge_sort_by_key()
 
 
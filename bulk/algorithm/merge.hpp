@@ -19,6 +19,7 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/scoped_buffer.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/algorithm/gather.hpp>
 #include <bulk/uninitialized.hpp>
@@ -463,7 +464,8 @@ RandomAccessIterator3 merge(bulk::concurrent_group<bulk::agent<grainsize>,groups
 
   typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
 
-  value_type *buffer = reinterpret_cast<value_type*>(bulk::malloc(exec, exec.size() * exec.grainsize() * sizeof(value_type)));
+  bulk::scoped_buffer<value_type> buffer_impl(exec, exec.size() * exec.grainsize());
+  value_type *buffer = buffer_impl.data();
 
   size_type chunk_size = exec.size() * exec.this_exec.grainsize();
 
@@ -498,8 +500,6 @@ RandomAccessIterator3 merge(bulk::concurrent_group<bulk::agent<grainsize>,groups
     } // end while
   } // end else
 
-  bulk::free(exec, buffer);
-
   return result;
 } // end merge()
 
@@ -537,7 +537,8 @@ merge_by_key(bulk::bounded<
     size_type *indices;
   } stage;
 
-  stage.keys = static_cast<key_type*>(bulk::malloc(g, groupsize * grainsize * thrust::max(sizeof(key_type), sizeof(size_type))));
+  bulk::scoped_buffer<char> stage_impl(g, groupsize * grainsize * thrust::max(sizeof(key_type), sizeof(size_type)));
+  stage.keys = reinterpret_cast<key_type*>(stage_impl.data());
 #else
   __shared__ union
   {
@@ -599,10 +600,6 @@ merge_by_key(bulk::bounded<
                                thrust::detail::make_join_iterator(values_first1, n1, values_first2),
                                values_result);
 
-#if __CUDA_ARCH__ >= 200
-  bulk::free(g, stage.keys);
-#endif
-
   return thrust::make_pair(keys_result, values_result);
 } // end merge_by_key()
 
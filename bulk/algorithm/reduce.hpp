@@ -19,8 +19,9 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/scoped_buffer.hpp>
 #include <bulk/uninitialized.hpp>
-#include <bulk/iterator/strided_iterator.hpp>
+#include <bulk/detail/tile_loader.hpp>
 #include <thrust/iterator/iterator_traits.h>
 #include <thrust/detail/minmax.h>
 
@@ -141,50 +142,7 @@ T reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
 
     // each agent strides through the input range
     // and copies into a local array
-    strided_iterator<RandomAccessIterator,size_type> local_first = make_strided_iterator(first + tid, static_cast<size_type>(groupsize));
-
-    // XXX if we could precompute local_size for the else branch,
-    //     we could just call copy_n here
-    //     we can't precompute it (without a divide afaik), so we compute local_size in the else branch
-    size_type local_size = 0;
-    if(partition_size < elements_per_group)
-    {
-//  XXX i guess nvcc miscompiles this loop for counting_iterators
-//      size_type index = tid;
-//      for(size_type i = 0; i < grainsize; ++i, ++local_first, index += groupsize)
-//      {
-//        if(index < partition_size)
-//        {
-//          local_inputs[i] = *local_first;
-//          ++local_size;
-//        } // end if
-//      } // end for
-//
-      RandomAccessIterator iter = local_first.base();
-      size_type index = tid;
-      for(size_type i = 0; i < grainsize; ++i, index += groupsize, iter += groupsize)
-      {
-        if(index < partition_size)
-        {
-          local_inputs[i] = *iter;
-          ++local_size;
-        } // end if
-      } // end for
-    } // end if
-    else
-    {
-      local_size = grainsize;
-//  XXX nvcc 6.5 RC miscompiles this loop when RandomAccessIterator is a counting_iterator
-//      bulk::copy_n(bulk::bound<grainsize>(g.this_exec),
-//                   local_first,
-//                   local_size,
-//                   local_inputs);
-      RandomAccessIterator iter = local_first.base();
-      for(size_type i = 0; i < grainsize; ++i, iter += groupsize)
-      {
-        local_inputs[i] = *iter;
-      } // end for
-    } // end else
+    size_type local_size = detail::tile_loader<RandomAccessIterator>::template load<groupsize,grainsize>(g, first, partition_size, local_inputs);
 
     // reduce local_inputs sequentially
     this_sum = this_sum_defined ?
@@ -195,11 +153,11 @@ T reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   } // end for
 
 #if __CUDA_ARCH__ >= 200
-  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, groupsize * sizeof(T)));
+  bulk::scoped_buffer<T> buffer_impl(g, groupsize);
 #else
   __shared__ bulk::uninitialized_array<T,groupsize> buffer_impl;
-  T *buffer = buffer_impl.data();
 #endif
+  T *buffer = buffer_impl.data();
 
   if(this_sum_defined)
   {
@@ -209,13 +167,7 @@ T reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   g.wait();
 
   // reduce across the group
-  T result = bulk::detail::reduce_detail::destructive_reduce_n(g, buffer, thrust::min<size_type>(groupsize,n), init, binary_op);
-
-#if __CUDA_ARCH__ >= 200
-  bulk::free(g,buffer);
-#endif
-
-  return result;
+  return bulk::detail::reduce_detail::destructive_reduce_n(g, buffer, thrust::min<size_type>(groupsize,n), init, binary_op);
 } // end reduce
 
 
@@ -237,7 +189,7 @@ T reduce(bulk::concurrent_group<> &g,
 
   typename thrust::iterator_difference<RandomAccessIterator>::type n = last - first;
 
-  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, g.size() * sizeof(T)));
+  bulk::scoped_buffer<T> buffer(g, g.size());
 
   for(size_type i = tid; i < n; i += g.size())
   {
@@ -256,11 +208,7 @@ T reduce(bulk::concurrent_group<> &g,
   g.wait();
 
   // reduce across the block
-  T result = detail::reduce_detail::destructive_reduce_n(g, buffer, thrust::min<size_type>(g.size(),n), init, binary_op);
-
-  bulk::free(g,buffer);
-
-  return result;
+  return detail::reduce_detail::destructive_reduce_n(g, buffer.data(), thrust::min<size_type>(g.size(),n), init, binary_op);
 } // end reduce
 
 
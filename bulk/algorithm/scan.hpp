@@ -19,6 +19,7 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/scoped_buffer.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/algorithm/accumulate.hpp>
 #include <bulk/uninitialized.hpp>
@@ -467,18 +468,16 @@ __device__ void inclusive_scan(bulk::concurrent_group<bulk::agent<grainsize>,gro
   typedef detail::scan_detail::scan_buffer<groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> buffer_type;
 
 #if __CUDA_ARCH__ >= 200
-  buffer_type *buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
+  bulk::scoped_buffer<buffer_type> buffer(g, 1);
 
-  if(bulk::is_on_chip(buffer))
+  if(bulk::is_on_chip(buffer.data()))
   {
-    detail::scan_detail::scan_with_buffer<true>(g, first, last, result, init, binary_op, *bulk::on_chip_cast(buffer));
+    detail::scan_detail::scan_with_buffer<true>(g, first, last, result, init, binary_op, *bulk::on_chip_cast(buffer.data()));
   } // end if
   else
   {
-    detail::scan_detail::scan_with_buffer<true>(g, first, last, result, init, binary_op, *buffer);
+    detail::scan_detail::scan_with_buffer<true>(g, first, last, result, init, binary_op, *buffer.data());
   } // end else
-
-  bulk::free(g, buffer);
 #else
   __shared__ uninitialized<buffer_type> buffer;
   detail::scan_detail::scan_with_buffer<true>(g, first, last, result, init, binary_op, buffer.get());
@@ -570,18 +569,16 @@ exclusive_scan(bulk::concurrent_group<agent<grainsize>,groupsize> &g,
   typedef detail::scan_detail::scan_buffer<groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> buffer_type;
 
 #if __CUDA_ARCH__ >= 200
-  buffer_type *buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
+  bulk::scoped_buffer<buffer_type> buffer(g, 1);
 
-  if(bulk::is_on_chip(buffer))
+  if(bulk::is_on_chip(buffer.data()))
   {
-    detail::scan_detail::scan_with_buffer<false>(g, first, last, result, init, binary_op, *bulk::on_chip_cast(buffer));
+    detail::scan_detail::scan_with_buffer<false>(g, first, last, result, init, binary_op, *bulk::on_chip_cast(buffer.data()));
   } // end if
   else
   {
-    detail::scan_detail::scan_with_buffer<false>(g, first, last, result, init, binary_op, *buffer);
+    detail::scan_detail::scan_with_buffer<false>(g, first, last, result, init, binary_op, *buffer.data());
   } // end else
-
-  bulk::free(g, buffer);
 #else
   __shared__ uninitialized<buffer_type> buffer;
   detail::scan_detail::scan_with_buffer<false>(g, first, last, result, init, binary_op, buffer.get());
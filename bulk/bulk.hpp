@@ -22,7 +22,13 @@
 #include <bulk/future.hpp>
 #include <bulk/async.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/scoped_buffer.hpp>
+#include <bulk/agent_scratch.hpp>
 #include <bulk/algorithm.hpp>
+#include <bulk/heap_requirement.hpp>
 #include <bulk/iterator.hpp>
 #include <bulk/uninitialized.hpp>
+#include <bulk/work_queue.hpp>
+#include <bulk/sender.hpp>
+#include <bulk/soa_vector.hpp>
 
@@ -0,0 +1,245 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/future.hpp>
+
+// co_await support for bulk::future<void>
+//
+// a coroutine which awaits an incomplete future is parked in an event_reactor
+// rather than blocking its thread. whichever thread calls reactor.poll() or
+// reactor.run() resumes coroutines as the events of their futures complete,
+// so a single thread may multiplex many outstanding launches:
+//
+//   task consume(...)
+//   {
+//     co_await bulk::async(bulk::par(n), f, ...);
+//     ...
+//   }
+//
+//   bulk::default_reactor().run();
+//
+// this header requires a compiler with C++20 coroutines; otherwise it is empty
+
+#if defined(__cpp_impl_coroutine) && (__cpp_impl_coroutine >= 201902L) && !defined(__CUDA_ARCH__)
+
+#include <coroutine>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// resumes coroutines which are waiting on CUDA events
+class event_reactor
+{
+  public:
+    event_reactor() = default;
+
+    event_reactor(const event_reactor &) = delete;
+    event_reactor &operator=(const event_reactor &) = delete;
+
+    // h is resumed by poll() or run() after e completes
+    void resume_after(cudaEvent_t e, std::coroutine_handle<> h)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_waiters.push_back(waiter{e, h});
+    } // end resume_after()
+
+    std::size_t num_pending() const
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      return m_waiters.size();
+    } // end num_pending()
+
+    // resumes every coroutine whose event has completed
+    // returns the number of coroutines resumed
+    std::size_t poll()
+    {
+      std::vector<std::coroutine_handle<> > ready;
+
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        std::size_t n = 0;
+        for(std::size_t i = 0; i < m_waiters.size(); ++i)
+        {
+          // errors count as completion; the awaiter rethrows them
+          if(cudaEventQuery(m_waiters[i].event) != cudaErrorNotReady)
+          {
+            ready.push_back(m_waiters[i].handle);
+          }
+          else
+          {
+            m_waiters[n++] = m_waiters[i];
+          } // end else
+        } // end for
+
+        m_waiters.resize(n);
+      }
+
+      // resume outside of the lock, since resumed coroutines may await again
+      for(std::size_t i = 0; i < ready.size(); ++i)
+      {
+        ready[i].resume();
+      } // end for
+
+      return ready.size();
+    } // end poll()
+
+    // polls until no coroutine is waiting
+    void run()
+    {
+      while(num_pending() > 0)
+      {
+        if(poll() == 0)
+        {
+          std::this_thread::yield();
+        } // end if
+      } // end while
+    } // end run()
+
+  private:
+    struct waiter
+    {
+      cudaEvent_t event;
+      std::coroutine_handle<> handle;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<waiter> m_waiters;
+}; // end event_reactor
+
+
+inline event_reactor &default_reactor()
+{
+  static event_reactor reactor;
+  return reactor;
+} // end default_reactor()
+
+
+namespace detail
+{
+
+
+inline bool is_ready(const future<void> &f)
+{
+  // a future without an event failed to launch, & is ready to throw its error
+  return future_core_access::event(f) == 0 || cudaEventQuery(future_core_access::event(f)) != cudaErrorNotReady;
+} // end is_ready()
+
+
+// awaits a future owned by someone else
+class future_ref_awaiter
+{
+  public:
+    future_ref_awaiter(const future<void> &f, event_reactor &reactor)
+      : m_future(f), m_reactor(reactor)
+    {}
+
+    bool await_ready() const
+    {
+      return is_ready(m_future);
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      m_reactor.resume_after(future_core_access::event(m_future), h);
+    }
+
+    // throws any error encountered by the launch
+    void await_resume() const
+    {
+      if(m_future.valid()) m_future.wait();
+    }
+
+  private:
+    const future<void> &m_future;
+    event_reactor &m_reactor;
+}; // end future_ref_awaiter
+
+
+// awaits a temporary future, keeping it alive until the coroutine resumes
+class future_awaiter
+{
+  public:
+    // XXX copy emulates a move
+    future_awaiter(const future<void> &f, event_reactor &reactor)
+      : m_future(f), m_reactor(reactor)
+    {}
+
+    bool await_ready() const
+    {
+      return is_ready(m_future);
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      m_reactor.resume_after(future_core_access::event(m_future), h);
+    }
+
+    void await_resume() const
+    {
+      if(m_future.valid()) m_future.wait();
+    }
+
+  private:
+    future<void> m_future;
+    event_reactor &m_reactor;
+}; // end future_awaiter
+
+
+} // end detail
+
+
+inline detail::future_ref_awaiter operator co_await(const future<void> &f)
+{
+  return detail::future_ref_awaiter(f, default_reactor());
+} // end operator co_await()
+
+
+inline detail::future_awaiter operator co_await(future<void> &&f)
+{
+  return detail::future_awaiter(f, default_reactor());
+} // end operator co_await()
+
+
+// awaits f using the given reactor rather than the default one
+inline detail::future_ref_awaiter on(event_reactor &reactor, const future<void> &f)
+{
+  return detail::future_ref_awaiter(f, reactor);
+} // end on()
+
+
+inline detail::future_awaiter on(event_reactor &reactor, future<void> &&f)
+{
+  return detail::future_awaiter(f, reactor);
+} // end on()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
+
+#endif // __cpp_impl_coroutine
+
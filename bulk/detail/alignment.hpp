@@ -192,6 +192,12 @@ template<std::size_t Align> struct aligned_type
   struct __align__(Align) type { };
 };
 #  endif // THRUST_HOST_COMPILER
+#elif defined(__GNUC__)
+// align on the host too, so that layouts like padded_layout hold in host-only code
+template<std::size_t Align> struct aligned_type
+{
+  struct __attribute__((aligned(Align))) type { };
+};
 #else
 template<std::size_t Align> struct aligned_type
 {
@@ -29,23 +29,50 @@ namespace detail
 {
 
 
+// launches c on s, and returns any error thrown while configuring the launch instead of throwing it
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+cudaError_t launch_capturing_errors(ExecutionGroup g, Closure c, cudaStream_t s)
+{
+  bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
+
+#ifndef __CUDA_ARCH__
+  try
+  {
+    return launcher.launch(g, c, s);
+  } // end try
+  catch(thrust::system_error &e)
+  {
+    return bulk::detail::error_of(e);
+  } // end catch
+#else
+  return launcher.launch(g, c, s);
+#endif
+} // end launch_capturing_errors()
+
+
 template<typename ExecutionGroup, typename Closure>
 __host__ __device__
 future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEvent_t before_event)
 {
+  // errors are captured into the future rather than thrown here
+  cudaError_t error = cudaSuccess;
+
 #if __BULK_HAS_CUDART__
   if(before_event != 0)
   {
-    bulk::detail::throw_on_error(cudaStreamWaitEvent(s, before_event, 0), "cudaStreamWaitEvent in async_in_stream");
+    error = cudaStreamWaitEvent(s, before_event, 0);
   }
 #else
   bulk::detail::terminate_with_message("async_in_stream(): cudaStreamWaitEvent requires CUDART");
 #endif
 
-  bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
-  launcher.launch(g, c, s);
+  if(!error)
+  {
+    error = bulk::detail::launch_capturing_errors(g, c, s);
+  } // end if
 
-  return future_core_access::create(s, false);
+  return future_core_access::create(s, false, error);
 } // end async_in_stream()
 
 
@@ -53,31 +80,43 @@ template<typename ExecutionGroup, typename Closure>
 __host__ __device__
 future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event)
 {
-  cudaStream_t s;
+  cudaStream_t s = 0;
+  bool owns_stream = false;
+
+  cudaError_t error = cudaSuccess;
 
   // XXX cudaStreamCreate is __host__-only
   //     figure out a way to support this that does not require creating a new stream
 #if (__BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__))
-  bulk::detail::throw_on_error(cudaStreamCreate(&s), "cudaStreamCreate in bulk::detail::async");
+  try
+  {
+    s = bulk::detail::stream_pool().acquire_stream();
+    owns_stream = true;
+  } // end try
+  catch(thrust::system_error &e)
+  {
+    error = bulk::detail::error_of(e);
+  } // end catch
 #else
-  s = 0;
   bulk::detail::terminate_with_message("bulk::async(): cudaStreamCreate() is unsupported in __device__ code.");
 #endif
 
 #if __BULK_HAS_CUDART__
-  if(before_event != 0)
+  if(!error && before_event != 0)
   {
-    bulk::detail::throw_on_error(cudaStreamWaitEvent(s, before_event, 0), "cudaStreamWaitEvent in bulk::detail::async");
+    error = cudaStreamWaitEvent(s, before_event, 0);
   }
 #else
   bulk::detail::terminate_with_message("async_in_stream(): cudaStreamWaitEvent requires CUDART");
 #endif
 
-  bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
-  launcher.launch(g, c, s);
+  if(!error)
+  {
+    error = bulk::detail::launch_capturing_errors(g, c, s);
+  } // end if
 
-  // note we pass true here, unlike false above
-  return future_core_access::create(s, true);
+  // note we pass owns_stream here, unlike false above
+  return future_core_access::create(s, owns_stream, error);
 } // end async()
 
 
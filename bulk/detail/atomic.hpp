@@ -0,0 +1,149 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+#if !defined(__CUDA_ARCH__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+// a minimal set of atomic operations which work in both __host__ and __device__ code
+// in __device__ code these map onto CUDA's atomic intrinsics
+// in __host__ code they map onto the host compiler's builtins so that
+// data structures built on top of them may be exercised with real threads
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+inline __host__ __device__
+unsigned int atomic_fetch_add(unsigned int *ptr, unsigned int val)
+{
+#if defined(__CUDA_ARCH__)
+  return atomicAdd(ptr, val);
+#elif defined(_MSC_VER)
+  return static_cast<unsigned int>(_InterlockedExchangeAdd(reinterpret_cast<volatile long*>(ptr), static_cast<long>(val)));
+#else
+  return __sync_fetch_and_add(ptr, val);
+#endif
+} // end atomic_fetch_add()
+
+
+inline __host__ __device__
+unsigned long long atomic_fetch_add(unsigned long long *ptr, unsigned long long val)
+{
+#if defined(__CUDA_ARCH__)
+  return atomicAdd(ptr, val);
+#elif defined(_MSC_VER)
+  return static_cast<unsigned long long>(_InterlockedExchangeAdd64(reinterpret_cast<volatile __int64*>(ptr), static_cast<__int64>(val)));
+#else
+  return __sync_fetch_and_add(ptr, val);
+#endif
+} // end atomic_fetch_add()
+
+
+// returns the value of *ptr before the operation
+// the swap succeeded iff the result == compare
+inline __host__ __device__
+unsigned int atomic_compare_and_swap(unsigned int *ptr, unsigned int compare, unsigned int val)
+{
+#if defined(__CUDA_ARCH__)
+  return atomicCAS(ptr, compare, val);
+#elif defined(_MSC_VER)
+  return static_cast<unsigned int>(_InterlockedCompareExchange(reinterpret_cast<volatile long*>(ptr), static_cast<long>(val), static_cast<long>(compare)));
+#else
+  return __sync_val_compare_and_swap(ptr, compare, val);
+#endif
+} // end atomic_compare_and_swap()
+
+
+inline __host__ __device__
+unsigned long long atomic_compare_and_swap(unsigned long long *ptr, unsigned long long compare, unsigned long long val)
+{
+#if defined(__CUDA_ARCH__)
+  return atomicCAS(ptr, compare, val);
+#elif defined(_MSC_VER)
+  return static_cast<unsigned long long>(_InterlockedCompareExchange64(reinterpret_cast<volatile __int64*>(ptr), static_cast<__int64>(val), static_cast<__int64>(compare)));
+#else
+  return __sync_val_compare_and_swap(ptr, compare, val);
+#endif
+} // end atomic_compare_and_swap()
+
+
+// returns the value of *ptr before the operation
+inline __host__ __device__
+unsigned long long atomic_fetch_max(unsigned long long *ptr, unsigned long long val)
+{
+  unsigned long long old = *const_cast<volatile unsigned long long*>(ptr);
+
+  while(old < val)
+  {
+    unsigned long long observed = atomic_compare_and_swap(ptr, old, val);
+
+    if(observed == old) break;
+
+    old = observed;
+  } // end while
+
+  return old;
+} // end atomic_fetch_max()
+
+
+inline __host__ __device__
+void atomic_thread_fence()
+{
+#if defined(__CUDA_ARCH__)
+  __threadfence();
+#elif defined(_MSC_VER)
+  _ReadWriteBarrier();
+  _mm_mfence();
+#else
+  __sync_synchronize();
+#endif
+} // end atomic_thread_fence()
+
+
+// loads through a volatile pointer so the compiler may not cache the value in a register
+template<typename T>
+inline __host__ __device__
+T atomic_load(const T *ptr)
+{
+  T result = *const_cast<const volatile T*>(ptr);
+  atomic_thread_fence();
+  return result;
+} // end atomic_load()
+
+
+template<typename T>
+inline __host__ __device__
+void atomic_store(T *ptr, T val)
+{
+  atomic_thread_fence();
+  *const_cast<volatile T*>(ptr) = val;
+} // end atomic_store()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
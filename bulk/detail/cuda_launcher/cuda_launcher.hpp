@@ -22,6 +22,7 @@
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <bulk/detail/cuda_launcher/triple_chevron_launcher.hpp>
 #include <bulk/detail/cuda_launcher/cuda_launch_config.hpp>
+#include <bulk/detail/cuda_launcher/cuda_overflow_heap.hpp>
 #include <bulk/detail/synchronize.hpp>
 #include <thrust/detail/minmax.h>
 #include <thrust/pair.h>
@@ -64,15 +65,29 @@ struct cuda_launcher_base
   {}
 
 
+  // returns the error reported by the launch
+  // errors from the kernel's execution are discovered by the future which waits on it
   __host__ __device__
-  void launch(size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+  cudaError_t launch(size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
   {
+    cudaError_t result = cudaSuccess;
+
     if(num_blocks > 0)
     {
-      super_t::launch(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      result = super_t::launch(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 
-      bulk::detail::synchronize_if_enabled("bulk_kernel_by_value");
+// XXX we rely on __THRUST_SYNCHRONOUS here
+//     note we always have to synchronize in __device__ code
+//     the synchronization's error is captured like the launch's
+#if __BULK_HAS_CUDART__ && (__THRUST_SYNCHRONOUS || defined(__CUDA_ARCH__))
+      if(!result)
+      {
+        result = cudaDeviceSynchronize();
+      } // end if
+#endif
     } // end if
+
+    return result;
   } // end launch()
 
 
@@ -143,6 +158,22 @@ struct cuda_launcher_base
   } // end choose_smem_size()
 
 
+  // returns the size of each group's slice of the overflow heap,
+  // which backs the part of a group's requested heap that choose_heap_size() did not grant
+  __host__ __device__
+  size_type choose_overflow_size(size_type requested_heap_size, size_type granted_heap_size)
+  {
+    // a default request asks for no particular amount of heap, and
+    // kernels whose ptx version is < 200 have no heap to overflow
+    if(requested_heap_size == use_default || bulk::detail::function_attributes(super_t::global_function_pointer()).ptxVersion < 20)
+    {
+      return 0;
+    } // end if
+
+    return static_cast<size_type>(overflow_heap::choose_slice_size(requested_heap_size, granted_heap_size));
+  } // end choose_overflow_size()
+
+
   __host__ __device__
   size_type choose_group_size(size_type requested_size)
   {
@@ -248,8 +279,10 @@ struct cuda_launcher<
 
   // launch(...) requires CUDA launch capability
   __host__ __device__
-  void launch(grid_type request, Closure c, cudaStream_t stream)
+  cudaError_t launch(grid_type request, Closure c, cudaStream_t stream)
   {
+    cudaError_t result = cudaSuccess;
+
     grid_type g = configure(request);
 
     size_type num_blocks = g.size();
@@ -259,6 +292,9 @@ struct cuda_launcher<
     {
       size_type heap_size  = g.this_exec.heap_size();
 
+      // every physical grid slices the same overflow heap by its blocks' group indices
+      scoped_overflow_heap overflow(super_t::choose_overflow_size(request.this_exec.heap_size(), heap_size), num_blocks, stream);
+
       size_type max_physical_grid_size = super_t::max_physical_grid_size();
 
       // launch multiple grids in order to accomodate potentially too large grid size requests
@@ -271,16 +307,20 @@ struct cuda_launcher<
             block_offset < num_blocks;
             block_offset += max_physical_grid_size)
         {
-          task_type task(g, c, block_offset);
+          task_type task(g, c, block_offset, overflow.get());
 
           size_type num_physical_blocks = thrust::min<size_type>(num_remaining_physical_blocks, max_physical_grid_size);
 
-          super_t::launch(num_physical_blocks, block_size, heap_size, stream, task);
+          result = super_t::launch(num_physical_blocks, block_size, heap_size, stream, task);
+
+          if(result) break;
 
           num_remaining_physical_blocks -= num_physical_blocks;
         } // end for block_offset
       } // end if
     } // end if
+
+    return result;
   } // end go()
 
   __host__ __device__
@@ -318,6 +358,118 @@ struct cuda_launcher<
 }; // end cuda_launcher
 
 
+template<std::size_t gridsize, std::size_t blocksize, std::size_t subgroupsize, std::size_t grainsize, typename Closure>
+struct cuda_launcher<
+  parallel_group<
+    concurrent_group<
+      concurrent_group<
+        agent<grainsize>,
+        subgroupsize
+      >,
+      blocksize
+    >,
+    gridsize
+  >,
+  Closure
+>
+  : public cuda_launcher_base<blocksize * subgroupsize, typename cuda_partitioned_grid<gridsize,blocksize,subgroupsize,grainsize>::type,Closure>
+{
+  typedef cuda_launcher_base<blocksize * subgroupsize, typename cuda_partitioned_grid<gridsize,blocksize,subgroupsize,grainsize>::type,Closure> super_t;
+  typedef typename super_t::size_type size_type;
+
+  typedef typename cuda_partitioned_grid<gridsize,blocksize,subgroupsize,grainsize>::type grid_type;
+  typedef typename grid_type::agent_type                                                 block_type;
+  typedef typename block_type::agent_type                                                subgroup_type;
+
+  typedef typename super_t::task_type task_type;
+
+  // launch(...) requires CUDA launch capability
+  __host__ __device__
+  cudaError_t launch(grid_type request, Closure c, cudaStream_t stream)
+  {
+    cudaError_t result = cudaSuccess;
+
+    grid_type g = configure(request);
+
+    size_type num_blocks = g.size();
+    size_type block_size = g.this_exec.size() * g.this_exec.this_exec.size();
+
+    if(num_blocks > 0 && block_size > 0)
+    {
+      size_type heap_size  = g.this_exec.heap_size();
+
+      // every physical grid slices the same overflow heap by its blocks' group indices
+      scoped_overflow_heap overflow(super_t::choose_overflow_size(request.this_exec.heap_size(), heap_size), num_blocks, stream);
+
+      size_type max_physical_grid_size = super_t::max_physical_grid_size();
+
+      size_type num_remaining_physical_blocks = num_blocks;
+      for(size_type block_offset = 0;
+          block_offset < num_blocks;
+          block_offset += max_physical_grid_size)
+      {
+        task_type task(g, c, block_offset, overflow.get());
+
+        size_type num_physical_blocks = thrust::min<size_type>(num_remaining_physical_blocks, max_physical_grid_size);
+
+        result = super_t::launch(num_physical_blocks, block_size, heap_size, stream, task);
+
+        if(result) break;
+
+        num_remaining_physical_blocks -= num_physical_blocks;
+      } // end for block_offset
+    } // end if
+
+    return result;
+  } // end go()
+
+  __host__ __device__
+  grid_type configure(grid_type g)
+  {
+    // by default, a subgroup is a warp
+    size_type subgroup_size = g.this_exec.this_exec.size();
+    if(subgroup_size == use_default)
+    {
+      subgroup_size = device_properties().warpSize;
+    } // end if
+
+    // by default, choose the number of subgroups which best fills a block
+    size_type num_subgroups = g.this_exec.size();
+    if(num_subgroups == use_default)
+    {
+      num_subgroups = thrust::max<size_type>(1, super_t::choose_group_size(use_default) / subgroup_size);
+    } // end if
+
+    const size_type header_size = private_heap<subgroup_type>::header_size;
+
+    // a request for the subgroups' heaps alone is a request for the block's heap
+    size_type requested_heap_size          = g.this_exec.heap_size();
+    size_type requested_subgroup_heap_size = g.this_exec.this_exec.heap_size();
+    if(requested_heap_size == use_default && requested_subgroup_heap_size != use_default)
+    {
+      requested_heap_size = num_subgroups * (requested_subgroup_heap_size + header_size);
+    } // end if
+
+    size_type heap_size  = super_t::choose_heap_size(device_properties(), num_subgroups * subgroup_size, requested_heap_size);
+
+    // by default, the block's heap is divided among its subgroups
+    // each subgroup's private heap is aligned like the block's heap and has room for at least bulk::malloc's broadcast
+    size_type subgroup_heap_size = heap_size / num_subgroups / header_size * header_size;
+    if(requested_subgroup_heap_size != use_default)
+    {
+      subgroup_heap_size = thrust::min<size_type>(subgroup_heap_size, (requested_subgroup_heap_size + 2 * header_size - 1) / header_size * header_size);
+    } // end if
+
+    subgroup_heap_size = thrust::max<size_type>(subgroup_heap_size, header_size);
+    heap_size = thrust::max<size_type>(heap_size, num_subgroups * subgroup_heap_size);
+
+    size_type num_blocks = g.size();
+
+    return make_grid<grid_type>(num_blocks, make_block<block_type>(num_subgroups, heap_size, make_block<subgroup_type>(subgroup_size, subgroup_heap_size)));
+  } // end configure()
+}; // end cuda_launcher
+
+
 template<std::size_t blocksize, std::size_t grainsize, typename Closure>
 struct cuda_launcher<
   concurrent_group<
@@ -335,7 +487,7 @@ struct cuda_launcher<
   typedef concurrent_group<agent<grainsize>,blocksize> block_type;
 
   __host__ __device__
-  void launch(block_type request, Closure c, cudaStream_t stream)
+  cudaError_t launch(block_type request, Closure c, cudaStream_t stream)
   {
     block_type b = configure(request);
 
@@ -344,9 +496,13 @@ struct cuda_launcher<
 
     if(block_size > 0)
     {
-      task_type task(b, c);
-      super_t::launch(1, block_size, heap_size, stream, task);
+      scoped_overflow_heap overflow(super_t::choose_overflow_size(request.heap_size(), heap_size), 1, stream);
+
+      task_type task(b, c, overflow.get());
+      return super_t::launch(1, block_size, heap_size, stream, task);
     } // end if
+
+    return cudaSuccess;
   } // end go()
 
   __host__ __device__
@@ -376,7 +532,7 @@ struct cuda_launcher<
   typedef parallel_group<agent<grainsize>,groupsize> group_type;
 
   __host__ __device__
-  void launch(group_type g, Closure c, cudaStream_t stream)
+  cudaError_t launch(group_type g, Closure c, cudaStream_t stream)
   {
     size_type num_blocks, block_size;
     thrust::tie(num_blocks,block_size) = configure(g);
@@ -385,8 +541,10 @@ struct cuda_launcher<
     {
       task_type task(g, c);
 
-      super_t::launch(num_blocks, block_size, 0, stream, task);
+      return super_t::launch(num_blocks, block_size, 0, stream, task);
     } // end if
+
+    return cudaSuccess;
   } // end go()
 
   __host__ __device__
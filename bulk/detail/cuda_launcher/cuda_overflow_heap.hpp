@@ -0,0 +1,109 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/cuda_launcher/cuda_parameter_arena.hpp>
+#include <bulk/malloc.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+#if __BULK_HAS_CUDART__
+
+
+// the arena from which launches reserve their overflow heaps
+// like the parameter arena, its buffer is created on first use & its bytes are recycled
+// once the launches which use them complete, so overflowing launches make no cudaMalloc
+// after the first. launches whose overflow heap exceeds the arena get none
+inline cuda_parameter_arena &default_overflow_arena()
+{
+  // the stream pool lends the arena its fences, so it must outlive the arena
+  bulk::detail::stream_pool();
+
+  static cuda_parameter_arena arena(1 << 26);
+  return arena;
+} // end default_overflow_arena()
+
+
+#endif // __BULK_HAS_CUDART__
+
+
+// reserves the overflow_heap of a launch of num_groups groups for the scope of the launch
+// the reservation is released along with stream, so it outlives the launched kernel
+//
+// launches from the device reserve nothing, so their groups fall back to malloc
+class scoped_overflow_heap
+{
+  public:
+    __host__ __device__
+    scoped_overflow_heap(size_t slice_size, size_t num_groups, cudaStream_t stream)
+      : m_buffer(0),
+        m_slice_size(slice_size),
+        m_stream(stream)
+    {
+#if __BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__)
+      if(slice_size > 0)
+      {
+        m_buffer = bulk::detail::default_overflow_arena().allocate(overflow_heap::buffer_size(slice_size, num_groups), overflow_heap::slice_alignment);
+      } // end if
+#else
+      (void)num_groups;
+#endif
+    } // end scoped_overflow_heap()
+
+
+    __host__ __device__
+    ~scoped_overflow_heap()
+    {
+#if __BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__)
+      if(m_buffer)
+      {
+        bulk::detail::default_overflow_arena().release(m_buffer, m_stream);
+      } // end if
+#endif
+    } // end ~scoped_overflow_heap()
+
+
+    __host__ __device__
+    overflow_heap get() const
+    {
+      return overflow_heap(m_buffer, m_slice_size);
+    } // end get()
+
+
+  private:
+    // XXX delete these unless we find a need for them
+    scoped_overflow_heap(const scoped_overflow_heap &);
+    scoped_overflow_heap &operator=(const scoped_overflow_heap &);
+
+    void *m_buffer;
+    size_t m_slice_size;
+    cudaStream_t m_stream;
+}; // end scoped_overflow_heap
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
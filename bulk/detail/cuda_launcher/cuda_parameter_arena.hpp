@@ -0,0 +1,115 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/cuda_launcher/parameter_arena.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+#if __BULK_HAS_CUDART__
+
+
+// the Runtime of parameter_arena for the CUDA runtime
+// fences are events borrowed from the stream pool
+struct cuda_parameter_arena_runtime
+{
+  typedef cudaStream_t stream_type;
+  typedef cudaEvent_t  fence_type;
+
+  void *allocate(std::size_t n)
+  {
+    void *result = 0;
+    bulk::detail::throw_on_error(cudaMalloc(&result, n), "cudaMalloc in cuda_parameter_arena_runtime::allocate");
+    return result;
+  } // end allocate()
+
+  // errors are swallowed because the arena is destroyed at program exit
+  void deallocate(void *ptr)
+  {
+    cudaFree(ptr);
+  } // end deallocate()
+
+  cudaEvent_t record_fence(cudaStream_t s)
+  {
+    cudaEvent_t result = bulk::detail::stream_pool().acquire_event();
+
+    cudaError_t error = cudaEventRecord(result, s);
+
+    if(error)
+    {
+      bulk::detail::stream_pool().release_event(result);
+      bulk::detail::throw_on_error(error, "cudaEventRecord in cuda_parameter_arena_runtime::record_fence");
+    } // end if
+
+    return result;
+  } // end record_fence()
+
+  // errors are swallowed because the arena calls this in place of a fence it could not record
+  void synchronize(cudaStream_t s)
+  {
+    cudaStreamSynchronize(s);
+  } // end synchronize()
+
+  bool is_complete(cudaEvent_t e)
+  {
+    return cudaEventQuery(e) != cudaErrorNotReady;
+  } // end is_complete()
+
+  void wait(cudaEvent_t e)
+  {
+    cudaEventSynchronize(e);
+  } // end wait()
+
+  void destroy_fence(cudaEvent_t e)
+  {
+    bulk::detail::stream_pool().release_event(e);
+  } // end destroy_fence()
+}; // end cuda_parameter_arena_runtime
+
+
+typedef bulk::detail::parameter_arena<cuda_parameter_arena_runtime> cuda_parameter_arena;
+
+
+// the arena used by triple_chevron_launcher to marshal tasks
+// which do not fit in the 4096 bytes of kernel parameter space
+inline cuda_parameter_arena &default_parameter_arena()
+{
+  // the stream pool lends the arena its fences, so it must outlive the arena
+  bulk::detail::stream_pool();
+
+  static cuda_parameter_arena arena(1 << 20);
+  return arena;
+} // end default_parameter_arena()
+
+
+#endif // __BULK_HAS_CUDART__
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,351 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/resource_pool.hpp>
+#include <deque>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+struct parameter_arena_statistics
+{
+  parameter_arena_statistics()
+    : allocations(0), wraps(0), stalls(0), oversized(0)
+  {}
+
+  std::size_t allocations;
+
+  // allocations which skipped the end of the buffer to stay contiguous
+  std::size_t wraps;
+
+  // times allocate() had to block on the oldest outstanding fence
+  std::size_t stalls;
+
+  // requests larger than the buffer, which the caller must satisfy elsewhere
+  std::size_t oversized;
+}; // end parameter_arena_statistics
+
+
+// a ring buffer of marshalled kernel parameters
+//
+// each allocation is released along with the stream which consumes it. the arena
+// records a fence on that stream and recycles the allocation's bytes once the fence
+// has completed. when the ring is full, allocate() blocks on the oldest fence,
+// without holding the arena's lock. release() does not throw: if the fence cannot
+// be recorded, it synchronizes the stream instead.
+//
+// Runtime provides
+//
+//   typedef ... stream_type;
+//   typedef ... fence_type;
+//   void      *allocate(std::size_t);
+//   void       deallocate(void *);
+//   fence_type record_fence(stream_type); // may throw
+//   void       synchronize(stream_type);
+//   bool       is_complete(fence_type);
+//   void       wait(fence_type);
+//   void       destroy_fence(fence_type);
+template<typename Runtime>
+class parameter_arena
+{
+  public:
+    typedef Runtime                       runtime_type;
+    typedef typename Runtime::stream_type stream_type;
+    typedef typename Runtime::fence_type  fence_type;
+
+    parameter_arena(std::size_t capacity, Runtime runtime = Runtime())
+      : m_runtime(runtime),
+        m_buffer(0),
+        m_capacity(capacity),
+        m_tail(0),
+        m_bytes_in_use(0)
+    {}
+
+    ~parameter_arena()
+    {
+      scoped_spin_lock guard(m_lock);
+
+      while(!m_slots.empty())
+      {
+        if(m_slots.front().is_fenced)
+        {
+          m_runtime.wait(m_slots.front().fence);
+          m_runtime.destroy_fence(m_slots.front().fence);
+        } // end if
+
+        m_slots.pop_front();
+      } // end while
+
+      if(m_buffer)
+      {
+        m_runtime.deallocate(m_buffer);
+      } // end if
+    } // end ~parameter_arena()
+
+    std::size_t capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+    std::size_t bytes_in_use() const
+    {
+      scoped_spin_lock guard(m_lock);
+      return m_bytes_in_use;
+    } // end bytes_in_use()
+
+    parameter_arena_statistics statistics() const
+    {
+      scoped_spin_lock guard(m_lock);
+      return m_statistics;
+    } // end statistics()
+
+    // returns 0 when n exceeds the capacity of the arena
+    void *allocate(std::size_t n, std::size_t alignment)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      if(n > m_capacity)
+      {
+        ++m_statistics.oversized;
+        return 0;
+      } // end if
+
+      // the buffer is created lazily so that merely instantiating
+      // the arena does not touch the runtime
+      if(m_buffer == 0)
+      {
+        m_buffer = reinterpret_cast<char*>(m_runtime.allocate(m_capacity));
+      } // end if
+
+      while(true)
+      {
+        reclaim();
+
+        std::size_t offset = align_up(m_tail, alignment);
+        std::size_t reserved = 0;
+        bool wrapped = false;
+
+        if(offset + n <= m_capacity)
+        {
+          reserved = offset + n - m_tail;
+        }
+        else
+        {
+          // skip the end of the buffer so the allocation stays contiguous
+          offset = 0;
+          reserved = (m_capacity - m_tail) + n;
+          wrapped = true;
+        } // end else
+
+        if(m_bytes_in_use + reserved <= m_capacity)
+        {
+          m_slots.push_back(slot(offset, reserved));
+          m_bytes_in_use += reserved;
+          m_tail = offset + n;
+          ++m_statistics.allocations;
+          if(wrapped) ++m_statistics.wraps;
+
+          return m_buffer + offset;
+        } // end if
+
+        if(m_slots.empty())
+        {
+          // the ring is empty, but the tail is poorly placed
+          m_tail = 0;
+          continue;
+        } // end if
+
+        // back-pressure: block on the oldest outstanding launch
+        ++m_statistics.stalls;
+
+        if(m_slots.front().is_fenced)
+        {
+          // reclaim() leaves the slot, & so its fence, alone while we wait
+          // deque::push_back does not invalidate references to the other slots
+          slot &oldest = m_slots.front();
+          ++oldest.num_waiters;
+
+          fence_type f = oldest.fence;
+
+          m_lock.unlock();
+          m_runtime.wait(f);
+          m_lock.lock();
+
+          --oldest.num_waiters;
+        }
+        else
+        {
+          // another thread is between allocate() and release(); let it finish
+          m_lock.unlock();
+          m_lock.lock();
+        } // end else
+      } // end while
+    } // end allocate()
+
+    // work which reads ptr has been enqueued on s
+    // ptr's bytes will be recycled once that work completes
+    void release(void *ptr, stream_type s)
+    {
+      fence_type f = fence_type();
+      bool is_fenced = true;
+
+      try
+      {
+        f = m_runtime.record_fence(s);
+      } // end try
+      catch(...)
+      {
+        // without a fence, the work must be complete before the bytes are recycled
+        m_runtime.synchronize(s);
+        is_fenced = false;
+      } // end catch
+
+      scoped_spin_lock guard(m_lock);
+
+      std::size_t offset = reinterpret_cast<char*>(ptr) - m_buffer;
+
+      // search from the back, since the slot was most likely allocated most recently
+      for(typename std::deque<slot>::reverse_iterator i = m_slots.rbegin(); i != m_slots.rend(); ++i)
+      {
+        if(i->offset == offset && !i->is_fenced && !i->is_complete)
+        {
+          i->fence = f;
+          i->is_fenced = is_fenced;
+          i->is_complete = !is_fenced;
+          break;
+        } // end if
+      } // end for
+
+      if(!is_fenced)
+      {
+        reclaim();
+      } // end if
+    } // end release()
+
+  private:
+    // non-copyable
+    parameter_arena(const parameter_arena &);
+    parameter_arena &operator=(const parameter_arena &);
+
+    struct slot
+    {
+      slot(std::size_t offset_, std::size_t reserved_)
+        : offset(offset_), reserved(reserved_), fence(), is_fenced(false), is_complete(false), num_waiters(0)
+      {}
+
+      std::size_t offset;
+
+      // includes alignment padding & any bytes skipped at the end of the buffer
+      std::size_t reserved;
+
+      fence_type fence;
+      bool is_fenced;
+
+      // the slot's work was synchronized when its fence could not be recorded
+      bool is_complete;
+
+      // threads blocked on the fence in allocate()
+      int num_waiters;
+
+      bool is_reclaimable(Runtime &runtime) const
+      {
+        return is_complete || (is_fenced && num_waiters == 0 && runtime.is_complete(fence));
+      }
+    };
+
+    static std::size_t align_up(std::size_t offset, std::size_t alignment)
+    {
+      return ((offset + alignment - 1) / alignment) * alignment;
+    } // end align_up()
+
+    // recycles the bytes of slots whose work has completed, oldest first
+    void reclaim()
+    {
+      while(!m_slots.empty() && m_slots.front().is_reclaimable(m_runtime))
+      {
+        if(m_slots.front().is_fenced)
+        {
+          m_runtime.destroy_fence(m_slots.front().fence);
+        } // end if
+
+        m_bytes_in_use -= m_slots.front().reserved;
+        m_slots.pop_front();
+      } // end while
+
+      if(m_slots.empty())
+      {
+        // start over at the front of the buffer
+        m_tail = 0;
+        m_bytes_in_use = 0;
+      } // end if
+    } // end reclaim()
+
+    mutable spin_lock m_lock;
+    Runtime m_runtime;
+    char *m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_tail;
+    std::size_t m_bytes_in_use;
+    std::deque<slot> m_slots;
+    parameter_arena_statistics m_statistics;
+}; // end parameter_arena
+
+
+// releases an allocation from a parameter_arena on scope exit,
+// even if the launch which consumes it throws. release() does not throw, so neither does the destructor
+template<typename Arena>
+class scoped_parameter_allocation
+{
+  public:
+    scoped_parameter_allocation(Arena &arena, std::size_t n, std::size_t alignment, typename Arena::stream_type s)
+      : m_arena(arena),
+        m_ptr(arena.allocate(n, alignment)),
+        m_stream(s)
+    {}
+
+    ~scoped_parameter_allocation()
+    {
+      if(m_ptr)
+      {
+        m_arena.release(m_ptr, m_stream);
+      } // end if
+    } // end ~scoped_parameter_allocation()
+
+    void *get() const
+    {
+      return m_ptr;
+    } // end get()
+
+  private:
+    Arena &m_arena;
+    void *m_ptr;
+    typename Arena::stream_type m_stream;
+}; // end scoped_parameter_allocation
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
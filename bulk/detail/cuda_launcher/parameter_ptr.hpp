@@ -84,28 +84,46 @@ class parameter_ptr
 };
 
 
+// marshals x through global memory into result
+// returns the error, if any, instead of throwing it
 template<typename T>
 __host__ __device__
-parameter_ptr<T> make_parameter(const T& x)
+cudaError_t make_parameter(const T& x, parameter_ptr<T> &result)
 {
   T* raw_ptr = 0;
 
   // allocate
 #if __BULK_HAS_CUDART__
-  bulk::detail::throw_on_error(cudaMalloc(&raw_ptr, sizeof(T)), "make_parameter(): after cudaMalloc");
+  cudaError_t error = cudaMalloc(&raw_ptr, sizeof(T));
+  if(error) return error;
 #else
   bulk::detail::terminate_with_message("make_parameter(): cudaMalloc requires CUDART\n");
+  cudaError_t error = cudaErrorUnknown;
 #endif
 
+  // take ownership before the copy, so that a failed copy frees the allocation
+  result = parameter_ptr<T>(raw_ptr);
+
   // do a trivial copy
 #ifndef __CUDA_ARCH__
-  bulk::detail::throw_on_error(cudaMemcpy(raw_ptr, &x, sizeof(T), cudaMemcpyHostToDevice),
-                               "make_parameter(): after cudaMemcpy");
+  error = cudaMemcpy(raw_ptr, &x, sizeof(T), cudaMemcpyHostToDevice);
 #else
   std::memcpy(raw_ptr, &x, sizeof(T));
 #endif
 
-  return parameter_ptr<T>(raw_ptr);
+  return error;
+}
+
+
+template<typename T>
+__host__ __device__
+parameter_ptr<T> make_parameter(const T& x)
+{
+  parameter_ptr<T> result(0);
+
+  bulk::detail::throw_on_error(make_parameter(x, result), "make_parameter()");
+
+  return result;
 }
 
 
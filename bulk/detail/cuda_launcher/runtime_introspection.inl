@@ -17,6 +17,8 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/atomic.hpp>
+#include <bulk/detail/resource_pool.hpp>
 #include <thrust/system/cuda/detail/guarded_cuda_runtime_api.h>
 #include <thrust/detail/util/blocking.h>
 #include <thrust/detail/minmax.h>
@@ -129,7 +131,7 @@ inline device_properties_t device_properties()
 
 template <typename KernelFunction>
 __host__ __device__
-inline function_attributes_t function_attributes(KernelFunction kernel)
+inline function_attributes_t function_attributes_uncached(KernelFunction kernel)
 {
 #if __BULK_HAS_CUDART__
   typedef void (*fun_ptr_type)();
@@ -156,6 +158,80 @@ inline function_attributes_t function_attributes(KernelFunction kernel)
 #endif // __CUDACC__
 }
 
+
+template <typename KernelFunction>
+inline function_attributes_t function_attributes_cached(KernelFunction kernel)
+{
+  // cache the result of function_attributes_uncached, because it is slow
+  // and a single launch asks for the attributes of its kernel several times
+  // only cache the first few kernels of each signature on the first few devices
+  static const int max_num_devices = 16;
+  static const int max_num_kernels = 4;
+
+  static int num_kernels[max_num_devices]                                      = {0};
+  static KernelFunction kernels[max_num_devices][max_num_kernels]              = {};
+  static function_attributes_t attributes[max_num_devices][max_num_kernels]    = {};
+
+  // entries are only ever appended, so readers need not lock:
+  // a reader sees an entry only after its count is published
+  static spin_lock insertion_lock;
+
+  int device_id = current_device();
+
+  if(device_id >= max_num_devices)
+  {
+    return function_attributes_uncached(kernel);
+  }
+
+  int n = atomic_load(&num_kernels[device_id]);
+
+  for(int i = 0; i < n; ++i)
+  {
+    if(kernels[device_id][i] == kernel)
+    {
+      return attributes[device_id][i];
+    }
+  }
+
+  function_attributes_t result = function_attributes_uncached(kernel);
+
+  scoped_spin_lock guard(insertion_lock);
+
+  // another thread may have inserted entries since we looked
+  n = num_kernels[device_id];
+
+  for(int i = 0; i < n; ++i)
+  {
+    if(kernels[device_id][i] == kernel)
+    {
+      return result;
+    }
+  }
+
+  if(n < max_num_kernels)
+  {
+    kernels[device_id][n]    = kernel;
+    attributes[device_id][n] = result;
+
+    // publish the count only after both halves of the new entry are written
+    atomic_store(&num_kernels[device_id], n + 1);
+  }
+
+  return result;
+}
+
+
+template <typename KernelFunction>
+__host__ __device__
+inline function_attributes_t function_attributes(KernelFunction kernel)
+{
+#ifndef __CUDA_ARCH__
+  return function_attributes_cached(kernel);
+#else
+  return function_attributes_uncached(kernel);
+#endif
+}
+
 __host__ __device__
 inline size_t compute_capability(const device_properties_t &properties)
 {
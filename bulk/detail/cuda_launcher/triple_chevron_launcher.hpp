@@ -20,6 +20,7 @@
 #include <bulk/detail/alignment.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/cuda_launcher/parameter_ptr.hpp>
+#include <bulk/detail/cuda_launcher/cuda_parameter_arena.hpp>
 
 // It's not possible to launch a CUDA kernel unless __BULK_HAS_CUDART__
 // is 1, so we'd like to just hide all this code when that macro is 0.
@@ -114,39 +115,42 @@ class triple_chevron_launcher : protected triple_chevron_launcher_base<block_siz
   public:
     typedef Function task_type;
 
+    // returns the error reported by the launch itself, without synchronizing
     inline __host__ __device__
-    void launch(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+    cudaError_t launch(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
     {
       struct workaround
       {
         __host__ __device__
-        static void supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+        static cudaError_t supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
         {
 #if __BULK_HAS_CUDART__
 #  ifndef __CUDA_ARCH__
           cudaConfigureCall(dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
           cudaSetupArgument(task, 0);
-          bulk::detail::throw_on_error(cudaLaunch(super_t::global_function_pointer()), "after cudaLaunch in triple_chevron_launcher::launch()");
+          return cudaLaunch(super_t::global_function_pointer());
 #  else
           void *param_buffer = cudaGetParameterBuffer(alignment_of<task_type>::value, sizeof(task_type));
           std::memcpy(param_buffer, &task, sizeof(task_type));
-          bulk::detail::throw_on_error(cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream),
-                                       "after cudaLaunchDevice in triple_chevron_launcher::launch()");
+          return cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
 #  endif // __CUDA_ARCH__
+#else
+          return cudaErrorUnknown;
 #endif // __BULK_HAS_CUDART__
         }
 
         __host__ __device__
-        static void unsupported_path(unsigned int, unsigned int, size_t, cudaStream_t, task_type)
+        static cudaError_t unsupported_path(unsigned int, unsigned int, size_t, cudaStream_t, task_type)
         {
           bulk::detail::terminate_with_message("triple_chevron_launcher::launch(): CUDA kernel launch requires CUDART.");
+          return cudaErrorUnknown;
         }
       };
 
 #if __BULK_HAS_CUDART__
-      workaround::supported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      return workaround::supported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 #else
-      workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      return workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 #endif
     } // end launch()
 };
@@ -165,42 +169,76 @@ class triple_chevron_launcher<block_size_,Function,false> : protected triple_che
   public:
     typedef Function task_type;
 
+    // returns the error reported by the launch itself, without synchronizing
     inline __host__ __device__
-    void launch(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+    cudaError_t launch(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
     {
       struct workaround
       {
         __host__ __device__
-        static void supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+        static cudaError_t supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
         {
-          bulk::detail::parameter_ptr<task_type> parm = bulk::detail::make_parameter<task_type>(task);
-
 #if __BULK_HAS_CUDART__
 #  ifndef __CUDA_ARCH__
+          // marshal the task through the persistent parameter arena
+          // only tasks larger than the arena itself fall back to a fresh allocation
+          bulk::detail::scoped_parameter_allocation<cuda_parameter_arena> slot(bulk::detail::default_parameter_arena(), sizeof(task_type), alignment_of<task_type>::value, stream);
+          bulk::detail::parameter_ptr<task_type> parm(0);
+
+          const task_type *task_ptr = static_cast<const task_type*>(slot.get());
+
+          if(task_ptr)
+          {
+            cudaError_t error = cudaMemcpyAsync(slot.get(), &task, sizeof(task_type), cudaMemcpyHostToDevice, stream);
+            if(error) return error;
+          }
+          else
+          {
+            cudaError_t error = bulk::detail::make_parameter<task_type>(task, parm);
+            if(error) return error;
+
+            task_ptr = parm.get();
+          } // end else
+
           cudaConfigureCall(dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
-          cudaSetupArgument(static_cast<const task_type*>(parm.get()), 0);
-          bulk::detail::throw_on_error(cudaLaunch(super_t::global_function_pointer()), "after cudaLaunch in triple_chevron_launcher::launch()");
+          cudaSetupArgument(task_ptr, 0);
+          return cudaLaunch(super_t::global_function_pointer());
 #  else
+          bulk::detail::parameter_ptr<task_type> parm(0);
+
+          cudaError_t error = bulk::detail::make_parameter<task_type>(task, parm);
+          if(error) return error;
+
           void *param_buffer = cudaGetParameterBuffer(alignment_of<task_type>::value, sizeof(task_type));
           task_type *task_ptr = parm.get();
           std::memcpy(param_buffer, &task_ptr, sizeof(task_type*));
-          bulk::detail::throw_on_error(cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream),
-                                       "after cudaLaunchDevice in triple_chevron_launcher::launch()");
+          error = cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
+
+          // parm is freed on return, so the kernel which reads it must finish first
+          if(!error)
+          {
+            error = cudaDeviceSynchronize();
+          } // end if
+
+          return error;
 #  endif // __CUDA_ARCH__
+#else
+          return cudaErrorUnknown;
 #endif // __BULK_HAS_CUDART__
         }
 
         __host__ __device__
-        static void unsupported_path(unsigned int, unsigned int, size_t, cudaStream_t, task_type)
+        static cudaError_t unsupported_path(unsigned int, unsigned int, size_t, cudaStream_t, task_type)
         {
           bulk::detail::terminate_with_message("triple_chevron_launcher::launch(): CUDA kernel launch requires CUDART.");
+          return cudaErrorUnknown;
         }
       };
 
 #if __BULK_HAS_CUDART__
-      workaround::supported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      return workaround::supported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 #else
-      workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      return workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 #endif
     } // end launch()
 };
@@ -125,6 +125,19 @@ struct cuda_grid
 };
 
 
+// a CUDA grid whose blocks are partitioned into subgroups of consecutive threads
+template<std::size_t gridsize, std::size_t blocksize, std::size_t subgroupsize, std::size_t grainsize>
+struct cuda_partitioned_grid
+{
+  typedef parallel_group<
+    concurrent_group<
+      concurrent_group<agent<grainsize>, subgroupsize>,
+      blocksize
+    >
+  > type;
+};
+
+
 template<typename Group, typename Closure> class cuda_task;
 
 
@@ -222,13 +235,15 @@ class cuda_task<
 
   private:
     size_type block_offset;
+    overflow_heap overflow;
 
   public:
 
     __host__ __device__
-    cuda_task(grid_type g, closure_type c, size_type offset)
+    cuda_task(grid_type g, closure_type c, size_type offset, overflow_heap overflow = overflow_heap())
       : super_t(g,c),
-        block_offset(offset)
+        block_offset(offset),
+        overflow(overflow)
     {}
 
     __device__
@@ -253,7 +268,98 @@ class cuda_task<
       // initialize shared storage
       if(this_grid.this_exec.this_exec.index() == 0)
       {
-        bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size());
+        bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size(), overflow.slice(this_grid.this_exec.index()), overflow.slice_size());
+      }
+      this_grid.this_exec.wait();
+#endif
+
+      substitute_placeholders_and_execute(this_grid, super_t::c);
+#endif
+    } // end operator()
+}; // end cuda_task
+
+
+// specialize cuda_task for a CUDA grid of partitioned blocks
+// each block is made of this_exec.size() subgroups of this_exec.this_exec.size() threads
+// each subgroup's heap is a private slice of this_exec.this_exec.heap_size() bytes at the end of its block's heap,
+// and the block's on-chip allocator manages the rest. because a subgroup's wait()
+// synchronizes the entire block, every subgroup of a block must wait() together
+template<std::size_t gridsize, std::size_t blocksize, std::size_t subgroupsize, std::size_t grainsize, typename Closure>
+class cuda_task<
+  parallel_group<
+    concurrent_group<
+      concurrent_group<
+        agent<grainsize>,
+        subgroupsize
+      >,
+      blocksize
+    >,
+    gridsize
+  >,
+  Closure
+> : public task_base<typename cuda_partitioned_grid<gridsize,blocksize,subgroupsize,grainsize>::type,Closure>
+{
+  private:
+    typedef task_base<typename cuda_partitioned_grid<gridsize,blocksize,subgroupsize,grainsize>::type,Closure> super_t;
+
+  public:
+    typedef typename super_t::group_type       grid_type;
+    typedef typename grid_type::agent_type     block_type;
+    typedef typename block_type::agent_type    subgroup_type;
+    typedef typename subgroup_type::agent_type thread_type;
+    typedef typename super_t::closure_type     closure_type;
+    typedef typename grid_type::size_type      size_type;
+
+  private:
+    size_type block_offset;
+    overflow_heap overflow;
+
+  public:
+
+    __host__ __device__
+    cuda_task(grid_type g, closure_type c, size_type offset, overflow_heap overflow = overflow_heap())
+      : super_t(g,c),
+        block_offset(offset),
+        overflow(overflow)
+    {}
+
+    __device__
+    void operator()()
+    {
+      // guard use of CUDA built-ins from foreign compilers
+#ifdef __CUDA_ARCH__
+      size_type subgroup_size = super_t::g.this_exec.this_exec.size();
+      size_type num_subgroups = blockDim.x / subgroup_size;
+
+      // the subgroups' private heaps follow the block's heap
+      size_type subgroup_heap_size = super_t::g.this_exec.this_exec.heap_size();
+      size_type heap_size = super_t::g.this_exec.heap_size() - num_subgroups * subgroup_heap_size;
+
+      // instantiate a view of this grid
+      grid_type this_grid =
+        make_grid<grid_type>(
+          super_t::g.size(),
+          make_block<block_type>(
+            num_subgroups,
+            heap_size,
+            make_block<subgroup_type>(
+              subgroup_size,
+              subgroup_heap_size,
+              thread_type(threadIdx.x % subgroup_size),
+              threadIdx.x / subgroup_size
+            ),
+            block_offset + blockIdx.x
+          ),
+          0
+      );
+
+      private_heap<subgroup_type>::make(this_grid.this_exec.this_exec, heap_size + this_grid.this_exec.this_exec.index() * subgroup_heap_size, subgroup_heap_size);
+
+#if __CUDA_ARCH__ >= 200
+      // initialize shared storage
+      if(threadIdx.x == 0)
+      {
+        bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size(), overflow.slice(this_grid.this_exec.index()), overflow.slice_size());
       }
       this_grid.this_exec.wait();
 #endif
@@ -283,10 +389,14 @@ class cuda_task<
     typedef typename super_t::closure_type  closure_type;
     typedef typename block_type::size_type  size_type;
 
+  private:
+    overflow_heap overflow;
+
   public:
     __host__ __device__
-    cuda_task(block_type b, closure_type c)
-      : super_t(b,c)
+    cuda_task(block_type b, closure_type c, overflow_heap overflow = overflow_heap())
+      : super_t(b,c),
+        overflow(overflow)
     {}
 
     __device__
@@ -307,7 +417,7 @@ class cuda_task<
       // initialize shared storage
       if(this_block.this_exec.index() == 0)
       {
-        bulk::detail::init_on_chip_malloc(this_block.heap_size());
+        bulk::detail::init_on_chip_malloc(this_block.heap_size(), overflow.slice(0), overflow.slice_size());
       }
       this_block.wait();
 #endif
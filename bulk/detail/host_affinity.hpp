@@ -0,0 +1,373 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+
+// placement of host worker threads onto logical cpus
+//
+// workers are numbered 0, 1, ..., num_workers - 1 and groups are assigned to workers
+// in contiguous index ranges, so the same group index lands on the same cpu
+// on every launch as long as the number of groups & workers does not change
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+struct logical_cpu
+{
+  int id;
+  int package;
+  int core;
+};
+
+
+namespace host_affinity_detail
+{
+
+
+inline int read_topology_value(int cpu, const char *name, int default_value)
+{
+  int result = default_value;
+
+#if defined(__linux__)
+  char path[128];
+  std::sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+
+  std::FILE *f = std::fopen(path, "r");
+  if(f)
+  {
+    if(std::fscanf(f, "%d", &result) != 1) result = default_value;
+    std::fclose(f);
+  } // end if
+#else
+  (void)cpu;
+  (void)name;
+#endif
+
+  return result;
+} // end read_topology_value()
+
+
+// orders cpus so that consecutive entries share as much cache as possible
+struct compact_order
+{
+  bool operator()(const logical_cpu &a, const logical_cpu &b) const
+  {
+    if(a.package != b.package) return a.package < b.package;
+    if(a.core    != b.core)    return a.core    < b.core;
+    return a.id < b.id;
+  }
+};
+
+
+} // end host_affinity_detail
+
+
+// the cpus this process may run on, with their package & core, in compact order
+inline std::vector<logical_cpu> available_cpus()
+{
+  std::vector<logical_cpu> result;
+
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if(sched_getaffinity(0, sizeof(set), &set) == 0)
+  {
+    for(int i = 0; i < CPU_SETSIZE; ++i)
+    {
+      if(CPU_ISSET(i, &set))
+      {
+        logical_cpu cpu;
+        cpu.id = i;
+        cpu.package = host_affinity_detail::read_topology_value(i, "physical_package_id", 0);
+        cpu.core    = host_affinity_detail::read_topology_value(i, "core_id", i);
+        result.push_back(cpu);
+      } // end if
+    } // end for
+  } // end if
+#endif
+
+  std::sort(result.begin(), result.end(), host_affinity_detail::compact_order());
+
+  return result;
+} // end available_cpus()
+
+
+class affinity
+{
+  public:
+    enum kind
+    {
+      // let the operating system place workers
+      none,
+
+      // fill one core, then one package, before moving to the next
+      compact,
+
+      // spread workers across packages, then cores, before sharing one
+      scatter,
+
+      // use the given list of cpus in order
+      explicit_cpus
+    };
+
+    affinity(kind k = none)
+      : m_kind(k)
+    {
+      // compute the placement eagerly so that workers may query it concurrently
+      if(m_kind == compact || m_kind == scatter) placement();
+    }
+
+    explicit affinity(const std::vector<int> &cpus)
+      : m_kind(explicit_cpus),
+        m_explicit_cpus(cpus)
+    {}
+
+    kind get_kind() const
+    {
+      return m_kind;
+    }
+
+    // the cpu to which worker should be pinned, or -1 for no pinning
+    int cpu_for_worker(unsigned int worker) const
+    {
+      if(m_kind == none) return -1;
+
+      if(m_kind == explicit_cpus)
+      {
+        return m_explicit_cpus.empty() ? -1 : m_explicit_cpus[worker % m_explicit_cpus.size()];
+      }
+
+      const std::vector<int> &order = placement();
+      return order.empty() ? -1 : order[worker % order.size()];
+    } // end cpu_for_worker()
+
+  private:
+    // the order in which cpus are handed out to workers
+    const std::vector<int> &placement() const
+    {
+      if(m_placement.empty())
+      {
+        // available_cpus() is in compact order
+        std::vector<logical_cpu> cpus = available_cpus();
+
+        if(m_kind == scatter)
+        {
+          // rank each cpu among its core's siblings and each core within its package
+          // then order by sibling rank, core rank & package, so that consecutive workers
+          // land on different packages, then different cores, before sharing a core
+          std::vector<scatter_key> keys(cpus.size());
+
+          int sibling_rank = 0, core_rank = 0;
+          for(std::size_t i = 0; i < cpus.size(); ++i)
+          {
+            if(i > 0 && cpus[i].package != cpus[i-1].package)
+            {
+              sibling_rank = 0;
+              core_rank = 0;
+            }
+            else if(i > 0 && cpus[i].core != cpus[i-1].core)
+            {
+              sibling_rank = 0;
+              ++core_rank;
+            }
+            else if(i > 0)
+            {
+              ++sibling_rank;
+            } // end else
+
+            keys[i].sibling_rank = sibling_rank;
+            keys[i].core_rank    = core_rank;
+            keys[i].cpu          = cpus[i];
+          } // end for
+
+          std::sort(keys.begin(), keys.end());
+
+          for(std::size_t i = 0; i < keys.size(); ++i)
+          {
+            m_placement.push_back(keys[i].cpu.id);
+          } // end for
+        }
+        else
+        {
+          for(std::size_t i = 0; i < cpus.size(); ++i)
+          {
+            m_placement.push_back(cpus[i].id);
+          } // end for
+        } // end else
+      } // end if
+
+      return m_placement;
+    } // end placement()
+
+    struct scatter_key
+    {
+      int sibling_rank;
+      int core_rank;
+      logical_cpu cpu;
+
+      bool operator<(const scatter_key &other) const
+      {
+        if(sibling_rank != other.sibling_rank) return sibling_rank < other.sibling_rank;
+        if(core_rank    != other.core_rank)    return core_rank    < other.core_rank;
+        if(cpu.package  != other.cpu.package)  return cpu.package  < other.cpu.package;
+        return cpu.id < other.cpu.id;
+      }
+    };
+
+    kind m_kind;
+    std::vector<int> m_explicit_cpus;
+    mutable std::vector<int> m_placement;
+};
+
+
+// pins the calling thread to cpu
+// returns false if the request could not be honored
+inline bool pin_this_thread(int cpu)
+{
+  if(cpu < 0) return false;
+
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+} // end pin_this_thread()
+
+
+// the worker which executes group_index when num_groups groups are
+// divided among num_workers workers in contiguous ranges
+// a worker sees the same groups, and so the same tiles of an aligned_decomposition,
+// on every pass over the same data
+inline unsigned int worker_for_group(unsigned int group_index, unsigned int num_groups, unsigned int num_workers)
+{
+  if(num_workers == 0 || num_groups == 0) return 0;
+
+  // the first num_groups % num_workers workers get one extra group
+  unsigned int quotient  = num_groups / num_workers;
+  unsigned int remainder = num_groups % num_workers;
+
+  unsigned int boundary = remainder * (quotient + 1);
+
+  if(group_index < boundary)
+  {
+    return group_index / (quotient + 1);
+  } // end if
+
+  return remainder + (quotient ? (group_index - boundary) / quotient : 0);
+} // end worker_for_group()
+
+
+// the first of the groups which worker_for_group assigns to worker
+inline unsigned int first_group_of_worker(unsigned int worker, unsigned int num_groups, unsigned int num_workers)
+{
+  if(num_workers == 0) return 0;
+
+  unsigned int quotient  = num_groups / num_workers;
+  unsigned int remainder = num_groups % num_workers;
+
+  if(worker < remainder)
+  {
+    return worker * (quotient + 1);
+  } // end if
+
+  return remainder * (quotient + 1) + (worker - remainder) * quotient;
+} // end first_group_of_worker()
+
+
+// places an array of one slot per group, like the per-group results of reduce_intervals,
+// so that the slots of the groups worker_for_group assigns each worker are contiguous &
+// begin a cache line. workers never share a line, at the cost of at most a line per worker,
+// where padding every slot to a line costs a line per group
+class blocked_slot_layout
+{
+  public:
+    blocked_slot_layout(unsigned int num_groups, unsigned int num_workers, std::size_t slot_size, std::size_t line_size = 64)
+      : m_num_groups(num_groups),
+        m_num_workers(num_workers ? num_workers : 1),
+        m_slot_size(slot_size)
+    {
+      unsigned int quotient = m_num_groups / m_num_workers;
+
+      m_short_block_size = round_up(quotient * slot_size, line_size);
+      m_long_block_size  = round_up((quotient + 1) * slot_size, line_size);
+    }
+
+    // the offset in bytes of group's slot
+    std::size_t offset(unsigned int group) const
+    {
+      unsigned int worker = worker_for_group(group, m_num_groups, m_num_workers);
+
+      return block_offset(worker) + (group - first_group_of_worker(worker, m_num_groups, m_num_workers)) * m_slot_size;
+    } // end offset()
+
+    // the size in bytes of the array
+    std::size_t size() const
+    {
+      return block_offset(m_num_workers);
+    } // end size()
+
+  private:
+    static std::size_t round_up(std::size_t n, std::size_t line_size)
+    {
+      return (n + line_size - 1) / line_size * line_size;
+    } // end round_up()
+
+    // the first num_groups % num_workers workers' blocks hold one extra slot
+    std::size_t block_offset(unsigned int worker) const
+    {
+      unsigned int remainder = m_num_groups % m_num_workers;
+
+      if(worker < remainder)
+      {
+        return worker * m_long_block_size;
+      } // end if
+
+      return remainder * m_long_block_size + (worker - remainder) * m_short_block_size;
+    } // end block_offset()
+
+    unsigned int m_num_groups;
+    unsigned int m_num_workers;
+    std::size_t m_slot_size;
+    std::size_t m_short_block_size;
+    std::size_t m_long_block_size;
+}; // end blocked_slot_layout
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,401 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/atomic.hpp>
+#include <vector>
+#include <climits>
+#include <cstddef>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+
+// barriers for groups of agents which are backed by host threads
+//
+// each barrier spins on a private cache line for a while before parking the thread
+// in the kernel, so that a group whose threads all have their own core never pays for
+// a system call, while an oversubscribed group does not burn the cores its peers need
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace host_barrier_detail
+{
+
+
+inline void cpu_relax()
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+} // end cpu_relax()
+
+
+// blocks the calling thread while *word == expected
+inline void park(unsigned int *word, unsigned int expected)
+{
+#if defined(__linux__)
+  syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+#elif defined(_WIN32)
+  if(atomic_load(word) == expected) SwitchToThread();
+#else
+  if(atomic_load(word) == expected) sched_yield();
+#endif
+} // end park()
+
+
+inline void unpark_all(unsigned int *word)
+{
+#if defined(__linux__)
+  syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+#else
+  // nothing to do, parked threads poll
+  (void)word;
+#endif
+} // end unpark_all()
+
+
+inline unsigned int hardware_concurrency()
+{
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+#else
+  long result = sysconf(_SC_NPROCESSORS_ONLN);
+  return result > 0 ? static_cast<unsigned int>(result) : 1;
+#endif
+} // end hardware_concurrency()
+
+
+// a word alone on its cache line
+struct padded_word
+{
+  padded_word() : value(0) {}
+
+  unsigned int value;
+  char pad[64 - sizeof(unsigned int)];
+};
+
+
+// a set of words which threads spin on, plus a count of the threads parked on any of them
+// a signaler only pays for a system call when some thread has actually parked
+class spin_then_park
+{
+  public:
+    spin_then_park(unsigned int spin_limit)
+      : m_spin_limit(spin_limit)
+    {}
+
+    unsigned int spin_limit() const
+    {
+      return m_spin_limit;
+    }
+
+    // blocks until *word has advanced to at least target, modulo 2^32
+    void wait_until(unsigned int *word, unsigned int target)
+    {
+      unsigned int spins = 0;
+
+      while(true)
+      {
+        unsigned int current = atomic_load(word);
+
+        if(static_cast<int>(current - target) >= 0) return;
+
+        if(spins < m_spin_limit)
+        {
+          cpu_relax();
+          ++spins;
+        }
+        else
+        {
+          // announce ourself before re-checking the word inside the kernel
+          atomic_fetch_add(&m_num_parked.value, 1u);
+          park(word, current);
+          atomic_fetch_add(&m_num_parked.value, static_cast<unsigned int>(-1));
+        }
+      }
+    }
+
+    // advances *word by one and wakes any thread waiting on it
+    void signal(unsigned int *word)
+    {
+      atomic_fetch_add(word, 1u);
+      wake(word);
+    }
+
+    // wakes any thread waiting on *word after it has been modified
+    void wake(unsigned int *word)
+    {
+      // the fetch_add above is a full barrier, so either we observe the parked thread here
+      // or the parked thread observes our update before sleeping
+      if(atomic_load(&m_num_parked.value) != 0)
+      {
+        unpark_all(word);
+      }
+    }
+
+  private:
+    unsigned int m_spin_limit;
+    padded_word m_num_parked;
+};
+
+
+inline unsigned int default_spin_limit(unsigned int num_participants)
+{
+  // when the group does not fit on the machine, a spinning waiter is likely
+  // preventing the thread it waits on from running at all
+  return num_participants > hardware_concurrency() ? 64 : 16384;
+} // end default_spin_limit()
+
+
+} // end host_barrier_detail
+
+
+// a sense-reversing centralized barrier
+// the generation counter plays the role of the sense so that waiters need no private state
+// O(n) arrivals serialize on a single cache line, but the release is a single store
+class centralized_barrier
+{
+  public:
+    centralized_barrier(unsigned int num_participants)
+      : m_num_participants(num_participants),
+        m_spinner(host_barrier_detail::default_spin_limit(num_participants))
+    {}
+
+    unsigned int size() const
+    {
+      return m_num_participants;
+    }
+
+    void wait(unsigned int)
+    {
+      unsigned int generation = atomic_load(&m_generation.value);
+
+      if(atomic_fetch_add(&m_count.value, 1u) == m_num_participants - 1)
+      {
+        // the last to arrive resets the count and flips the sense
+        m_count.value = 0;
+        m_spinner.signal(&m_generation.value);
+      }
+      else
+      {
+        m_spinner.wait_until(&m_generation.value, generation + 1);
+      }
+    }
+
+  private:
+    unsigned int m_num_participants;
+    host_barrier_detail::spin_then_park m_spinner;
+    host_barrier_detail::padded_word m_count;
+    host_barrier_detail::padded_word m_generation;
+};
+
+
+// a dissemination barrier
+// in round r, participant i signals participant (i + 2^r) % n and waits for (i - 2^r) % n
+// there is no hot spot and no release phase, at the cost of n * ceil(log2(n)) signals
+class dissemination_barrier
+{
+  public:
+    dissemination_barrier(unsigned int num_participants)
+      : m_num_participants(num_participants),
+        m_num_rounds(0),
+        m_spinner(host_barrier_detail::default_spin_limit(num_participants))
+    {
+      while((1u << m_num_rounds) < m_num_participants) ++m_num_rounds;
+
+      m_flags.resize(m_num_rounds * m_num_participants);
+      m_episodes.resize(m_num_participants);
+    }
+
+    unsigned int size() const
+    {
+      return m_num_participants;
+    }
+
+    void wait(unsigned int participant)
+    {
+      // only participant touches its own episode
+      unsigned int episode = ++m_episodes[participant].value;
+
+      for(unsigned int r = 0; r < m_num_rounds; ++r)
+      {
+        unsigned int partner = (participant + (1u << r)) % m_num_participants;
+
+        m_spinner.signal(&flag(r, partner));
+        m_spinner.wait_until(&flag(r, participant), episode);
+      }
+    }
+
+  private:
+    unsigned int &flag(unsigned int round, unsigned int participant)
+    {
+      return m_flags[round * m_num_participants + participant].value;
+    }
+
+    unsigned int m_num_participants;
+    unsigned int m_num_rounds;
+    host_barrier_detail::spin_then_park m_spinner;
+    std::vector<host_barrier_detail::padded_word> m_flags;
+    std::vector<host_barrier_detail::padded_word> m_episodes;
+};
+
+
+// a combining tree barrier
+// arrivals propagate up a static tree with fan-in 4, each node spinning only on its own counter,
+// and the root releases everyone with a single store to a shared generation counter
+class tree_barrier
+{
+  public:
+    static const unsigned int fan_in = 4;
+
+    tree_barrier(unsigned int num_participants)
+      : m_num_participants(num_participants),
+        m_spinner(host_barrier_detail::default_spin_limit(num_participants)),
+        m_arrivals(num_participants),
+        m_episodes(num_participants)
+    {}
+
+    unsigned int size() const
+    {
+      return m_num_participants;
+    }
+
+    void wait(unsigned int participant)
+    {
+      unsigned int episode = ++m_episodes[participant].value;
+      unsigned int generation = atomic_load(&m_generation.value);
+
+      // wait for our subtree
+      unsigned int num_children = 0;
+      for(unsigned int c = fan_in * participant + 1; c <= fan_in * participant + fan_in && c < m_num_participants; ++c)
+      {
+        ++num_children;
+      }
+
+      if(num_children > 0)
+      {
+        m_spinner.wait_until(&m_arrivals[participant].value, episode * num_children);
+      }
+
+      if(participant == 0)
+      {
+        m_spinner.signal(&m_generation.value);
+      }
+      else
+      {
+        m_spinner.signal(&m_arrivals[(participant - 1) / fan_in].value);
+        m_spinner.wait_until(&m_generation.value, generation + 1);
+      }
+    }
+
+  private:
+    unsigned int m_num_participants;
+    host_barrier_detail::spin_then_park m_spinner;
+    std::vector<host_barrier_detail::padded_word> m_arrivals;
+    std::vector<host_barrier_detail::padded_word> m_episodes;
+    host_barrier_detail::padded_word m_generation;
+};
+
+
+// chooses among the barriers above by the size of the group and the machine
+class host_barrier
+{
+  public:
+    enum kind
+    {
+      automatic,
+      centralized,
+      dissemination,
+      tree
+    };
+
+    host_barrier(unsigned int num_participants, kind k = automatic)
+      : m_kind(k == automatic ? choose_kind(num_participants) : k),
+        m_centralized(m_kind == centralized ? num_participants : 1),
+        m_dissemination(m_kind == dissemination ? num_participants : 1),
+        m_tree(m_kind == tree ? num_participants : 1)
+    {}
+
+    static kind choose_kind(unsigned int num_participants)
+    {
+      // oversubscribed groups spend their time parked, and a single wakeup is cheapest
+      if(num_participants <= 4 || num_participants > host_barrier_detail::hardware_concurrency())
+      {
+        return centralized;
+      }
+
+      // dissemination avoids the release phase, but its signal count grows as n log n
+      return num_participants <= 32 ? dissemination : tree;
+    }
+
+    kind get_kind() const
+    {
+      return m_kind;
+    }
+
+    unsigned int size() const
+    {
+      switch(m_kind)
+      {
+        case dissemination: return m_dissemination.size();
+        case tree:          return m_tree.size();
+        default:            return m_centralized.size();
+      }
+    }
+
+    void wait(unsigned int participant)
+    {
+      switch(m_kind)
+      {
+        case dissemination: m_dissemination.wait(participant); break;
+        case tree:          m_tree.wait(participant);          break;
+        default:            m_centralized.wait(participant);   break;
+      }
+    }
+
+  private:
+    kind m_kind;
+    centralized_barrier   m_centralized;
+    dissemination_barrier m_dissemination;
+    tree_barrier          m_tree;
+};
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
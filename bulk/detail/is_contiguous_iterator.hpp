@@ -18,6 +18,8 @@
 
 #include <bulk/detail/config.hpp>
 #include <thrust/iterator/detail/is_trivial_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/tuple.h>
 
 BULK_NAMESPACE_PREFIX
 namespace bulk
@@ -32,6 +34,37 @@ template<typename T>
 {};
 
 
+template<typename IteratorTuple,
+         unsigned int i = 0,
+         unsigned int size = thrust::tuple_size<IteratorTuple>::value>
+  struct are_contiguous_iterators
+    : thrust::detail::integral_constant<
+        bool,
+        is_contiguous_iterator<typename thrust::tuple_element<i,IteratorTuple>::type>::value &&
+        are_contiguous_iterators<IteratorTuple,i+1,size>::value
+      >
+{};
+
+
+template<typename IteratorTuple, unsigned int size>
+  struct are_contiguous_iterators<IteratorTuple,size,size>
+    : thrust::detail::true_type
+{};
+
+
+// a zip_iterator whose fields are each stored contiguously, like a soa_vector's iterator
+template<typename Iterator>
+  struct is_contiguous_zip_iterator
+    : thrust::detail::false_type
+{};
+
+
+template<typename IteratorTuple>
+  struct is_contiguous_zip_iterator<thrust::zip_iterator<IteratorTuple> >
+    : are_contiguous_iterators<IteratorTuple>
+{};
+
+
 } // end detail
 } // end bulk
 BULK_NAMESPACE_SUFFIX
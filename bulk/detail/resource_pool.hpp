@@ -0,0 +1,377 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/atomic.hpp>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// a lock for short critical sections on the host
+class spin_lock
+{
+  public:
+    spin_lock()
+      : m_locked(0)
+    {}
+
+    void lock()
+    {
+      while(atomic_compare_and_swap(&m_locked, 0u, 1u) != 0u)
+      {
+        // wait for the lock to look free before retrying the CAS
+        while(atomic_load(&m_locked) != 0u) {}
+      } // end while
+    } // end lock()
+
+    void unlock()
+    {
+      atomic_store(&m_locked, 0u);
+    } // end unlock()
+
+  private:
+    unsigned int m_locked;
+}; // end spin_lock
+
+
+class scoped_spin_lock
+{
+  public:
+    scoped_spin_lock(spin_lock &l)
+      : m_lock(l)
+    {
+      m_lock.lock();
+    }
+
+    ~scoped_spin_lock()
+    {
+      m_lock.unlock();
+    }
+
+  private:
+    spin_lock &m_lock;
+}; // end scoped_spin_lock
+
+
+// the state of a pooled stream, as reported by a Runtime
+enum stream_status
+{
+  // the stream has finished its work & may be handed out
+  stream_idle,
+
+  // the stream still has work queued
+  stream_busy,
+
+  // the stream's query failed, so it may never be handed out again
+  stream_error
+}; // end stream_status
+
+
+struct resource_pool_statistics
+{
+  resource_pool_statistics()
+    : hits(0), misses(0), busy(0), releases(0), discards(0), evictions(0)
+  {}
+
+  // acquisitions satisfied from the pool
+  std::size_t hits;
+
+  // acquisitions which had to create a new resource
+  std::size_t misses;
+
+  // pooled streams passed over by an acquisition because they still had work queued
+  std::size_t busy;
+
+  // resources returned to the pool
+  std::size_t releases;
+
+  // resources destroyed because the pool was full
+  std::size_t discards;
+
+  // pooled streams destroyed because their status was stream_error
+  std::size_t evictions;
+}; // end resource_pool_statistics
+
+
+// recycles the streams & events created by a Runtime, which provides
+//
+//   typedef ... stream_type;
+//   typedef ... event_type;
+//   stream_type create_stream();
+//   void        destroy_stream(stream_type);
+//   stream_status status(stream_type);
+//   event_type  create_event();
+//   void        destroy_event(event_type);
+//
+// create_* may throw. at most capacity() idle resources of each kind are retained;
+// the rest are destroyed upon release
+//
+// a stream is released as soon as its owner is done enqueueing work, so it may still be
+// executing that work. acquire_stream hands out only streams which are stream_idle, so that new
+// work is never ordered after an unrelated owner's work, leaves busy streams pooled, and destroys
+// streams in stream_error, which a new stream replaces. it queries at most max_queried_streams
+// of the oldest pooled streams, and does so outside of the lock
+template<typename Runtime>
+class resource_pool
+{
+  public:
+    typedef Runtime                       runtime_type;
+    typedef typename Runtime::stream_type stream_type;
+    typedef typename Runtime::event_type  event_type;
+
+    static const std::size_t max_queried_streams = 4;
+
+    resource_pool(std::size_t capacity = 32, Runtime runtime = Runtime())
+      : m_capacity(capacity),
+        m_runtime(runtime)
+    {
+      // release is called from destructors, so make sure it never allocates
+      m_streams.reserve(m_capacity);
+      m_events.reserve(m_capacity);
+    } // end resource_pool()
+
+    ~resource_pool()
+    {
+      clear();
+    } // end ~resource_pool()
+
+    std::size_t capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+    void set_capacity(std::size_t capacity)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      m_capacity = capacity;
+      m_streams.reserve(m_capacity);
+      m_events.reserve(m_capacity);
+
+      while(m_streams.size() > m_capacity)
+      {
+        m_runtime.destroy_stream(m_streams.back());
+        m_streams.pop_back();
+        ++m_stream_statistics.discards;
+      } // end while
+
+      while(m_events.size() > m_capacity)
+      {
+        m_runtime.destroy_event(m_events.back());
+        m_events.pop_back();
+        ++m_event_statistics.discards;
+      } // end while
+    } // end set_capacity()
+
+    stream_type acquire_stream()
+    {
+      // take the streams released longest ago, which are the likeliest to be idle,
+      // out of the pool, so that they are queried outside of the lock
+      stream_type candidates[max_queried_streams];
+      std::size_t num_candidates = 0;
+
+      {
+        scoped_spin_lock guard(m_lock);
+
+        num_candidates = std::min<std::size_t>(max_queried_streams, m_streams.size());
+        std::copy(m_streams.begin(), m_streams.begin() + num_candidates, candidates);
+        m_streams.erase(m_streams.begin(), m_streams.begin() + num_candidates);
+      }
+
+      bool found = false;
+      stream_type result = stream_type();
+      std::size_t num_busy = 0, num_evicted = 0, num_kept = 0;
+
+      for(std::size_t i = 0; i < num_candidates; ++i)
+      {
+        if(!found)
+        {
+          stream_status status = m_runtime.status(candidates[i]);
+
+          if(status == stream_idle)
+          {
+            result = candidates[i];
+            found = true;
+            continue;
+          } // end if
+          else if(status == stream_error)
+          {
+            m_runtime.destroy_stream(candidates[i]);
+            ++num_evicted;
+            continue;
+          } // end else if
+
+          ++num_busy;
+        } // end if
+
+        // keep the busy & unqueried candidates in order
+        candidates[num_kept++] = candidates[i];
+      } // end for
+
+      std::size_t num_returned = 0;
+
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(found) ++m_stream_statistics.hits;
+        else      ++m_stream_statistics.misses;
+
+        m_stream_statistics.busy      += num_busy;
+        m_stream_statistics.evictions += num_evicted;
+
+        // put the kept candidates back at the front of the pool, in the room other releases have left
+        num_returned = std::min<std::size_t>(num_kept, m_capacity - std::min(m_capacity, m_streams.size()));
+        m_streams.insert(m_streams.begin(), candidates, candidates + num_returned);
+
+        m_stream_statistics.discards += num_kept - num_returned;
+      }
+
+      for(std::size_t i = num_returned; i < num_kept; ++i)
+      {
+        m_runtime.destroy_stream(candidates[i]);
+      } // end for
+
+      if(found) return result;
+
+      // create outside of the lock
+      return m_runtime.create_stream();
+    } // end acquire_stream()
+
+    void release_stream(stream_type s)
+    {
+      {
+        scoped_spin_lock guard(m_lock);
+
+        ++m_stream_statistics.releases;
+
+        if(m_streams.size() < m_capacity)
+        {
+          m_streams.push_back(s);
+          return;
+        } // end if
+
+        ++m_stream_statistics.discards;
+      }
+
+      m_runtime.destroy_stream(s);
+    } // end release_stream()
+
+    event_type acquire_event()
+    {
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(!m_events.empty())
+        {
+          event_type result = m_events.back();
+          m_events.pop_back();
+          ++m_event_statistics.hits;
+          return result;
+        } // end if
+
+        ++m_event_statistics.misses;
+      }
+
+      return m_runtime.create_event();
+    } // end acquire_event()
+
+    void release_event(event_type e)
+    {
+      {
+        scoped_spin_lock guard(m_lock);
+
+        ++m_event_statistics.releases;
+
+        if(m_events.size() < m_capacity)
+        {
+          m_events.push_back(e);
+          return;
+        } // end if
+
+        ++m_event_statistics.discards;
+      }
+
+      m_runtime.destroy_event(e);
+    } // end release_event()
+
+    // destroys all idle resources
+    void clear()
+    {
+      scoped_spin_lock guard(m_lock);
+
+      for(std::size_t i = 0; i < m_streams.size(); ++i)
+      {
+        m_runtime.destroy_stream(m_streams[i]);
+      } // end for
+      m_streams.clear();
+
+      for(std::size_t i = 0; i < m_events.size(); ++i)
+      {
+        m_runtime.destroy_event(m_events[i]);
+      } // end for
+      m_events.clear();
+    } // end clear()
+
+    resource_pool_statistics stream_statistics() const
+    {
+      scoped_spin_lock guard(m_lock);
+      return m_stream_statistics;
+    } // end stream_statistics()
+
+    resource_pool_statistics event_statistics() const
+    {
+      scoped_spin_lock guard(m_lock);
+      return m_event_statistics;
+    } // end event_statistics()
+
+    const Runtime &runtime() const
+    {
+      return m_runtime;
+    } // end runtime()
+
+  private:
+    // non-copyable
+    resource_pool(const resource_pool &);
+    resource_pool &operator=(const resource_pool &);
+
+    mutable spin_lock m_lock;
+    std::size_t m_capacity;
+    Runtime m_runtime;
+    std::vector<stream_type> m_streams;
+    std::vector<event_type> m_events;
+    resource_pool_statistics m_stream_statistics;
+    resource_pool_statistics m_event_statistics;
+}; // end resource_pool
+
+
+template<typename Runtime>
+const std::size_t resource_pool<Runtime>::max_queried_streams;
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/resource_pool.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+#if __BULK_HAS_CUDART__
+
+
+// the Runtime of resource_pool for the CUDA runtime
+struct cuda_runtime_resources
+{
+  typedef cudaStream_t stream_type;
+  typedef cudaEvent_t  event_type;
+
+  // XXX this combination makes the constructor expensive
+  //static const int event_flags = cudaEventDisableTiming | cudaEventBlockingSync;
+  static const int event_flags = cudaEventDisableTiming;
+
+  cudaStream_t create_stream()
+  {
+    cudaStream_t result;
+    bulk::detail::throw_on_error(cudaStreamCreate(&result), "cudaStreamCreate in cuda_runtime_resources::create_stream");
+    return result;
+  } // end create_stream()
+
+  // errors are swallowed because streams are destroyed from destructors
+  void destroy_stream(cudaStream_t s)
+  {
+    cudaStreamDestroy(s);
+  } // end destroy_stream()
+
+  // a stream whose query fails is destroyed by the pool & never handed out again
+  stream_status status(cudaStream_t s)
+  {
+    cudaError_t error = cudaStreamQuery(s);
+
+    if(error == cudaSuccess)       return stream_idle;
+    if(error == cudaErrorNotReady) return stream_busy;
+
+    return stream_error;
+  } // end status()
+
+  cudaEvent_t create_event()
+  {
+    cudaEvent_t result;
+    bulk::detail::throw_on_error(cudaEventCreateWithFlags(&result, event_flags), "cudaEventCreateWithFlags in cuda_runtime_resources::create_event");
+    return result;
+  } // end create_event()
+
+  void destroy_event(cudaEvent_t e)
+  {
+    cudaEventDestroy(e);
+  } // end destroy_event()
+}; // end cuda_runtime_resources
+
+
+typedef resource_pool<cuda_runtime_resources> cuda_stream_pool;
+
+
+// the pool used by bulk::async & bulk::future<void> in __host__ code
+// a recycled stream has finished the work of its previous owner
+inline cuda_stream_pool &stream_pool()
+{
+  static cuda_stream_pool pool;
+  return pool;
+} // end stream_pool()
+
+
+#endif // __BULK_HAS_CUDART__
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -49,6 +49,13 @@ void throw_on_error(cudaError_t e, const char *message)
 } // end throw_on_error()
 
 
+// the cudaError_t which throw_on_error threw as e
+inline cudaError_t error_of(const thrust::system_error &e)
+{
+  return static_cast<cudaError_t>(e.code().value());
+} // end error_of()
+
+
 } // end detail
 } // end bulk
 BULK_NAMESPACE_SUFFIX
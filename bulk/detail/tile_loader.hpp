@@ -0,0 +1,89 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// loads a tile of a group's input, [first, first + partition_size), into the agents' registers
+// in strided order, so that agent tid receives the elements tid, tid + groupsize, tid + 2 * groupsize, ...
+// and returns how many it received. partition_size is at most groupsize * grainsize
+//
+// the primary template loads each element through the iterator. iterators which decode their
+// elements, like bitpacked_iterator & delta_iterator, specialize it to decode a whole tile at a time
+// & set decodes_tiles, so every agent of the group must call load() together. staging<groupsize,grainsize>::footprint
+// is the bytes of the group's heap which load() stacks its scoped_buffers in, for bulk::heap_requirement
+template<typename RandomAccessIterator>
+struct tile_loader
+{
+  static const bool decodes_tiles = false;
+
+  template<std::size_t groupsize, std::size_t grainsize>
+  struct staging
+  {
+    static const std::size_t footprint = 0;
+  };
+
+  template<std::size_t groupsize, std::size_t grainsize, typename ConcurrentGroup, typename Size, typename T>
+  __thrust_forceinline__ __device__
+  static Size load(ConcurrentGroup &g, RandomAccessIterator first, Size partition_size, T *local_inputs)
+  {
+    Size tid = g.this_exec.index();
+
+    // XXX nvcc miscompiles these loops for counting_iterators when they step a strided_iterator
+    //     or call bulk::copy_n, so they step the underlying iterator by hand
+    RandomAccessIterator iter = first + tid;
+
+    // avoid conditional accesses when possible
+    if(partition_size < groupsize * grainsize)
+    {
+      Size local_size = 0;
+      Size index = tid;
+      for(Size i = 0; i < grainsize; ++i, index += groupsize, iter += groupsize)
+      {
+        if(index < partition_size)
+        {
+          local_inputs[i] = *iter;
+          ++local_size;
+        } // end if
+      } // end for
+
+      return local_size;
+    } // end if
+
+    for(Size i = 0; i < grainsize; ++i, iter += groupsize)
+    {
+      local_inputs[i] = *iter;
+    } // end for
+
+    return grainsize;
+  } // end load()
+}; // end tile_loader
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -324,6 +324,41 @@ inline async_launch<bulk::parallel_group<> > par(bulk::future<void> &before, siz
 }
 
 
+template<typename T> class scoped_buffer;
+
+
+namespace detail
+{
+
+template<typename ConcurrentGroup> struct private_heap;
+
+
+#if defined(BULK_BARRIER_INSTRUMENTATION)
+namespace
+{
+
+// the barriers every block of every launch in the process has waited at,
+// since the last reset_process_barrier_count()
+__device__ unsigned long long s_process_barrier_count;
+
+} // end anon namespace
+#endif
+
+
+// counts a barrier once per block when BULK_BARRIER_INSTRUMENTATION is defined
+inline __device__ void record_barrier()
+{
+#if defined(BULK_BARRIER_INSTRUMENTATION) && defined(__CUDA_ARCH__)
+  if(threadIdx.x == 0)
+  {
+    atomicAdd(&s_process_barrier_count, 1ull);
+  } // end if
+#endif
+} // end record_barrier()
+
+} // end detail
+
+
 // a group of concurrent ExecutionAgents which may synchronize
 template<typename ExecutionAgent      = agent<>,
          std::size_t size_      = dynamic_group_size>
@@ -346,7 +381,9 @@ class concurrent_group
                      agent_type exec = agent_type(),
                      size_type i = invalid_index)
       : super_t(exec,i),
-        m_heap_size(heap_size)
+        m_heap_size(heap_size),
+        m_heap_offset(-1),
+        m_stack_size(0)
     {}
 
     __device__
@@ -356,6 +393,8 @@ class concurrent_group
 #ifdef __CUDA_ARCH__
       __syncthreads();
 #endif
+
+      detail::record_barrier();
     }
 
     __host__ __device__
@@ -376,7 +415,18 @@ class concurrent_group
     } // end hardware_concurrency()
 
   private:
+    template<typename> friend class bulk::scoped_buffer;
+    template<typename> friend struct bulk::detail::private_heap;
+
     size_type m_heap_size;
+
+    // where a subgroup's private heap begins in its block's data segment,
+    // or -1 when the group's heap is its block's on-chip heap
+    size_type m_heap_offset;
+
+    // the bytes at the end of the heap occupied by scoped_buffers
+    // every agent keeps its own copy, so it need not be shared
+    size_type m_stack_size;
 };
 
 
@@ -402,7 +452,9 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
                      agent_type exec = agent_type(),
                      size_type i = invalid_index)
       : super_t(size,exec,i),
-        m_heap_size(heap_size)
+        m_heap_size(heap_size),
+        m_heap_offset(-1),
+        m_stack_size(0)
     {}
 
     __device__
@@ -412,6 +464,8 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
 #ifdef __CUDA_ARCH__
       __syncthreads();
 #endif
+
+      detail::record_barrier();
     }
 
     __host__ __device__
@@ -432,7 +486,18 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
     } // end hardware_concurrency()
 
   private:
+    template<typename> friend class bulk::scoped_buffer;
+    template<typename> friend struct bulk::detail::private_heap;
+
     size_type m_heap_size;
+
+    // where a subgroup's private heap begins in its block's data segment,
+    // or -1 when the group's heap is its block's on-chip heap
+    size_type m_heap_offset;
+
+    // the bytes at the end of the heap occupied by scoped_buffers
+    // every agent keeps its own copy, so it need not be shared
+    size_type m_stack_size;
 };
 
 
@@ -675,6 +740,29 @@ async_launch<
 }
 
 
+#if defined(BULK_BARRIER_INSTRUMENTATION)
+// returns the number of barriers which the blocks of every launch in the process have
+// waited at since the last reset_process_barrier_count(), counting each block's barrier once
+// the launches must be complete, e.g. after waiting on their futures
+inline unsigned long long read_process_barrier_count()
+{
+  unsigned long long result = 0;
+  bulk::detail::throw_on_error(cudaMemcpyFromSymbol(&result, bulk::detail::s_process_barrier_count, sizeof(result)),
+                               "read_process_barrier_count(): after cudaMemcpyFromSymbol");
+  return result;
+} // end read_process_barrier_count()
+
+
+// no launch may be in flight, or its barriers are partly counted
+inline void reset_process_barrier_count()
+{
+  unsigned long long zero = 0;
+  bulk::detail::throw_on_error(cudaMemcpyToSymbol(bulk::detail::s_process_barrier_count, &zero, sizeof(zero)),
+                               "reset_process_barrier_count(): after cudaMemcpyToSymbol");
+} // end reset_process_barrier_count()
+#endif // BULK_BARRIER_INSTRUMENTATION
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
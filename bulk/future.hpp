@@ -20,6 +20,7 @@
 #include <bulk/detail/guarded_cuda_runtime_api.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
 #include <thrust/detail/swap.h>
 #include <utility>
 #include <stdexcept>
@@ -48,11 +49,26 @@ class future<void>
     __host__ __device__
     ~future()
     {
-      if(valid())
-      {
+      // a future whose event could not be created still owns its stream
 #if __BULK_HAS_CUDART__
-        // swallow errors
-        cudaError_t e = cudaEventDestroy(m_event);
+#ifndef __CUDA_ARCH__
+      // recycle the stream & event
+      if(m_event)
+      {
+        bulk::detail::stream_pool().release_event(m_event);
+      } // end if
+
+      if(m_owns_stream)
+      {
+        bulk::detail::stream_pool().release_stream(m_stream);
+      } // end if
+#else
+      // swallow errors
+      cudaError_t e = cudaSuccess;
+
+      if(m_event)
+      {
+        e = cudaEventDestroy(m_event);
 
 #if __BULK_HAS_PRINTF__
         if(e)
@@ -60,22 +76,25 @@ class future<void>
           printf("CUDA error after cudaEventDestroy in future dtor: %s", cudaGetErrorString(e));
         } // end if
 #endif // __BULK_HAS_PRINTF__
+      } // end if
 
-        if(m_owns_stream)
-        {
-          e = cudaStreamDestroy(m_stream);
+      if(m_owns_stream)
+      {
+        e = cudaStreamDestroy(m_stream);
 
 #if __BULK_HAS_PRINTF__
-          if(e)
-          {
-            printf("CUDA error after cudaStreamDestroy in future dtor: %s", cudaGetErrorString(e));
-          } // end if
-#endif // __BULK_HAS_PRINTF__
+        if(e)
+        {
+          printf("CUDA error after cudaStreamDestroy in future dtor: %s", cudaGetErrorString(e));
         } // end if
-#endif
+#endif // __BULK_HAS_PRINTF__
       } // end if
+#endif // __CUDA_ARCH__
+#endif // __BULK_HAS_CUDART__
     } // end ~future()
 
+    // throws any error captured when the work was launched,
+    // or any error encountered while the work executed
     __host__ __device__
     void wait() const
     {
@@ -84,11 +103,19 @@ class future<void>
 #if __BULK_HAS_CUDART__
 
 #ifndef __CUDA_ARCH__
-      // XXX need to capture the error as an exception and then throw it in .get()
-      bulk::detail::throw_on_error(cudaEventSynchronize(m_event), "cudaEventSynchronize in future::wait");
+      // without an event, wait for everything on the stream
+      cudaError_t e = m_event ? cudaEventSynchronize(m_event) : cudaStreamSynchronize(m_stream);
 #else
-      // XXX need to capture the error as an exception and then throw it in .get()
-      bulk::detail::throw_on_error(cudaDeviceSynchronize(), "cudaDeviceSynchronize in future::wait");
+      cudaError_t e = cudaDeviceSynchronize();
+#endif // __CUDA_ARCH__
+
+      // the launch error is the root cause of any error after it
+      bulk::detail::throw_on_error(m_error, "launch in bulk::async");
+
+#ifndef __CUDA_ARCH__
+      bulk::detail::throw_on_error(e, "cudaEventSynchronize in future::wait");
+#else
+      bulk::detail::throw_on_error(e, "cudaDeviceSynchronize in future::wait");
 #endif // __CUDA_ARCH__
 
 #else
@@ -97,26 +124,34 @@ class future<void>
 #endif // __BULK_HAS_CUDART__
     } // end wait()
 
+    __host__ __device__
+    void get() const
+    {
+      wait();
+    } // end get()
+
+    // a future whose event could not be created is valid, and its wait() throws the error
     __host__ __device__
     bool valid() const
     {
-      return m_event != 0;
+      return m_event != 0 || m_error != cudaSuccess;
     } // end valid()
 
     __host__ __device__
     future()
-      : m_stream(0), m_event(0), m_owns_stream(false)
+      : m_stream(0), m_event(0), m_owns_stream(false), m_error(cudaSuccess)
     {}
 
     // simulate a move
     // XXX need to add rval_ref or something
     __host__ __device__
     future(const future &other)
-      : m_stream(0), m_event(0), m_owns_stream(false)
+      : m_stream(0), m_event(0), m_owns_stream(false), m_error(cudaSuccess)
     {
       thrust::swap(m_stream,      const_cast<future&>(other).m_stream);
       thrust::swap(m_event,       const_cast<future&>(other).m_event);
       thrust::swap(m_owns_stream, const_cast<future&>(other).m_owns_stream);
+      thrust::swap(m_error,       const_cast<future&>(other).m_error);
     } // end future()
 
     // simulate a move
@@ -127,19 +162,48 @@ class future<void>
       thrust::swap(m_stream,      const_cast<future&>(other).m_stream);
       thrust::swap(m_event,       const_cast<future&>(other).m_event);
       thrust::swap(m_owns_stream, const_cast<future&>(other).m_owns_stream);
+      thrust::swap(m_error,       const_cast<future&>(other).m_error);
       return *this;
     } // end operator=()
 
   private:
     friend struct detail::future_core_access;
 
+    // errors creating & recording the event are captured like the launch's, unless the launch failed first
     __host__ __device__
-    future(cudaStream_t s, bool owns_stream)
-      : m_stream(s),m_owns_stream(owns_stream)
+    future(cudaStream_t s, bool owns_stream, cudaError_t error)
+      : m_stream(s),m_event(0),m_owns_stream(owns_stream),m_error(error)
     {
 #if __BULK_HAS_CUDART__
-      bulk::detail::throw_on_error(cudaEventCreateWithFlags(&m_event, create_flags), "cudaEventCreateWithFlags in future ctor");
-      bulk::detail::throw_on_error(cudaEventRecord(m_event, m_stream), "cudaEventRecord in future ctor");
+      cudaError_t e = cudaSuccess;
+
+#ifndef __CUDA_ARCH__
+      try
+      {
+        m_event = bulk::detail::stream_pool().acquire_event();
+      } // end try
+      catch(thrust::system_error &exception)
+      {
+        e = bulk::detail::error_of(exception);
+      } // end catch
+#else
+      e = cudaEventCreateWithFlags(&m_event, create_flags);
+
+      if(e)
+      {
+        m_event = 0;
+      } // end if
+#endif
+
+      if(!e)
+      {
+        e = cudaEventRecord(m_event, m_stream);
+      } // end if
+
+      if(!m_error)
+      {
+        m_error = e;
+      } // end if
 #endif
     } // end future()
 
@@ -150,6 +214,9 @@ class future<void>
     cudaStream_t m_stream;
     cudaEvent_t m_event;
     bool m_owns_stream;
+
+    // the error, if any, which occurred when the work was launched
+    cudaError_t m_error;
 }; // end future<void>
 
 
@@ -160,9 +227,9 @@ namespace detail
 struct future_core_access
 {
   __host__ __device__
-  inline static future<void> create(cudaStream_t s, bool owns_stream)
+  inline static future<void> create(cudaStream_t s, bool owns_stream, cudaError_t error = cudaSuccess)
   {
-    return future<void>(s, owns_stream);
+    return future<void>(s, owns_stream, error);
   } // end create_in_stream()
 
   __host__ __device__
@@ -170,6 +237,12 @@ struct future_core_access
   {
     return f.m_event;
   } // end event()
+
+  __host__ __device__
+  inline static cudaError_t error(const future<void> &f)
+  {
+    return f.m_error;
+  } // end error()
 }; // end future_core_access
 
 
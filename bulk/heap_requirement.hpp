@@ -0,0 +1,296 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/scoped_buffer.hpp>
+#include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/detail/tile_loader.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <cstddef>
+
+
+// the bytes of heap a concurrent_group<agent<grainsize>,groupsize> needs for an algorithm
+// to keep its scratch on chip
+//
+//   typedef bulk::heap_requirement<bulk::reduce_by_key_tag, 256, 7, InputIterator2> requirement;
+//
+//   bulk::async(bulk::grid<256,7>(num_groups, requirement()), ...);
+//
+// the types which follow grainsize are those of the algorithm's arguments which determine
+// the size of its scratch, and are listed with each tag below. a kernel which calls
+// several algorithms one after another needs the largest of their requirements
+//
+// an input iterator which decodes whole tiles, like bitpacked_iterator, stages them in the heap,
+// so bulk::reduce & bulk::copy_n take their input's iterator type to include its staging
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// bulk::reduce                     <T, RandomAccessIterator>
+struct reduce_tag {};
+
+// bulk::accumulate                 <RandomAccessIterator, T>
+struct accumulate_tag {};
+
+// bulk::inclusive_scan             <RandomAccessIterator1, RandomAccessIterator2, BinaryFunction>
+struct inclusive_scan_tag {};
+
+// bulk::exclusive_scan             <RandomAccessIterator1, RandomAccessIterator2, BinaryFunction>
+struct exclusive_scan_tag {};
+
+// bulk::reduce_by_key              <InputIterator2>
+struct reduce_by_key_tag {};
+
+// bulk::merge                      <RandomAccessIterator3>
+struct merge_tag {};
+
+// bulk::merge_by_key               <RandomAccessIterator5>
+struct merge_by_key_tag {};
+
+// bulk::stable_sort_by_key         <RandomAccessIterator1, RandomAccessIterator2>
+struct stable_sort_by_key_tag {};
+
+// bulk::copy_n                     <RandomAccessIterator1>
+struct copy_tag {};
+
+// the algorithms which need no heap
+struct for_each_tag {};
+struct gather_tag {};
+struct scatter_tag {};
+struct adjacent_difference_tag {};
+
+
+template<typename Algorithm,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename Type1 = void,
+         typename Type2 = void,
+         typename Type3 = void>
+struct heap_requirement;
+
+
+namespace detail
+{
+namespace heap_requirement_detail
+{
+
+
+template<std::size_t value_>
+struct size_constant
+{
+  static const std::size_t value = value_;
+};
+
+
+template<std::size_t num_bytes>
+struct one_buffer
+  : size_constant<scoped_buffer_footprint<num_bytes>::value>
+{};
+
+
+template<std::size_t num_bytes1, std::size_t num_bytes2>
+struct two_buffers
+  : size_constant<scoped_buffer_footprint<num_bytes1>::value + scoped_buffer_footprint<num_bytes2>::value>
+{};
+
+
+template<std::size_t a, std::size_t b>
+struct static_max
+  : size_constant<(a < b) ? b : a>
+{};
+
+
+template<typename Iterator>
+struct value_size
+  : size_constant<sizeof(typename thrust::iterator_value<Iterator>::type)>
+{};
+
+
+// the bytes an iterator's tile_loader stacks on top of the algorithm's own buffers while it loads a tile
+template<std::size_t groupsize, std::size_t grainsize, typename Iterator>
+struct tile_staging
+  : size_constant<tile_loader<Iterator>::template staging<groupsize,grainsize>::footprint>
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+struct tile_staging<groupsize,grainsize,void>
+  : size_constant<0>
+{};
+
+
+} // end heap_requirement_detail
+} // end detail
+
+
+// reduce stages each tile before it allocates its buffer, so needs the larger of the two
+// the iterator may be omitted when it does not decode tiles
+template<std::size_t groupsize, std::size_t grainsize, typename T, typename RandomAccessIterator>
+struct heap_requirement<reduce_tag,groupsize,grainsize,T,RandomAccessIterator>
+  : detail::heap_requirement_detail::static_max<
+      detail::heap_requirement_detail::one_buffer<groupsize * sizeof(T)>::value,
+      detail::heap_requirement_detail::tile_staging<groupsize,grainsize,RandomAccessIterator>::value
+    >
+{};
+
+
+// accumulate stages each tile while its buffer is live, so needs both
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename T>
+struct heap_requirement<accumulate_tag,groupsize,grainsize,RandomAccessIterator,T>
+  : detail::heap_requirement_detail::size_constant<
+      detail::heap_requirement_detail::one_buffer<
+        sizeof(detail::accumulate_detail::buffer<groupsize,grainsize,RandomAccessIterator,T>)
+      >::value +
+      detail::heap_requirement_detail::tile_staging<groupsize,grainsize,RandomAccessIterator>::value
+    >
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename BinaryFunction>
+struct heap_requirement<inclusive_scan_tag,groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction>
+  : detail::heap_requirement_detail::one_buffer<
+      sizeof(detail::scan_detail::scan_buffer<groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction>)
+    >
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename BinaryFunction>
+struct heap_requirement<exclusive_scan_tag,groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction>
+  : heap_requirement<inclusive_scan_tag,groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction>
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename InputIterator2>
+struct heap_requirement<reduce_by_key_tag,groupsize,grainsize,InputIterator2>
+  : detail::heap_requirement_detail::two_buffers<
+      groupsize * grainsize * sizeof(int),
+      groupsize * grainsize * detail::heap_requirement_detail::value_size<InputIterator2>::value
+    >
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator3>
+struct heap_requirement<merge_tag,groupsize,grainsize,RandomAccessIterator3>
+  : detail::heap_requirement_detail::one_buffer<
+      groupsize * grainsize * detail::heap_requirement_detail::value_size<RandomAccessIterator3>::value
+    >
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator5>
+struct heap_requirement<merge_by_key_tag,groupsize,grainsize,RandomAccessIterator5>
+  : detail::heap_requirement_detail::one_buffer<
+      groupsize * grainsize * detail::heap_requirement_detail::static_max<
+        detail::heap_requirement_detail::value_size<RandomAccessIterator5>::value,
+        sizeof(int)
+      >::value
+    >
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct heap_requirement<stable_sort_by_key_tag,groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2>
+  : detail::heap_requirement_detail::one_buffer<
+      groupsize * grainsize * detail::heap_requirement_detail::static_max<
+        detail::heap_requirement_detail::value_size<RandomAccessIterator1>::value,
+        detail::heap_requirement_detail::value_size<RandomAccessIterator2>::value
+      >::value
+    >
+{};
+
+
+// the iterator may be omitted when it does not decode tiles
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1>
+struct heap_requirement<copy_tag,groupsize,grainsize,RandomAccessIterator1>
+  : detail::heap_requirement_detail::tile_staging<groupsize,grainsize,RandomAccessIterator1>
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+struct heap_requirement<for_each_tag,groupsize,grainsize>
+  : detail::heap_requirement_detail::size_constant<0>
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+struct heap_requirement<gather_tag,groupsize,grainsize>
+  : detail::heap_requirement_detail::size_constant<0>
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+struct heap_requirement<scatter_tag,groupsize,grainsize>
+  : detail::heap_requirement_detail::size_constant<0>
+{};
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+struct heap_requirement<adjacent_difference_tag,groupsize,grainsize>
+  : detail::heap_requirement_detail::size_constant<0>
+{};
+
+
+// shorthand for creating a concurrent_group of agents whose heap fits an algorithm
+template<std::size_t groupsize, std::size_t grainsize, typename Algorithm, typename Type1, typename Type2, typename Type3>
+__host__ __device__
+concurrent_group<bulk::agent<grainsize>,groupsize>
+con(heap_requirement<Algorithm,groupsize,grainsize,Type1,Type2,Type3>)
+{
+  return con<groupsize,grainsize>(heap_requirement<Algorithm,groupsize,grainsize,Type1,Type2,Type3>::value);
+}
+
+
+// shorthand for creating a grid of concurrent_groups whose heaps fit an algorithm
+template<std::size_t groupsize, std::size_t grainsize, typename Algorithm, typename Type1, typename Type2, typename Type3>
+__host__ __device__
+parallel_group<
+  concurrent_group<
+    bulk::agent<grainsize>,
+    groupsize
+  >
+>
+  grid(size_t num_groups, heap_requirement<Algorithm,groupsize,grainsize,Type1,Type2,Type3>)
+{
+  return grid<groupsize,grainsize>(num_groups, heap_requirement<Algorithm,groupsize,grainsize,Type1,Type2,Type3>::value);
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename Algorithm, typename Type1, typename Type2, typename Type3>
+__host__ __device__
+async_launch<
+  parallel_group<
+    concurrent_group<
+      bulk::agent<grainsize>,
+      groupsize
+    >
+  >
+>
+  grid(size_t num_groups, heap_requirement<Algorithm,groupsize,grainsize,Type1,Type2,Type3>, cudaStream_t stream)
+{
+  return grid<groupsize,grainsize>(num_groups, heap_requirement<Algorithm,groupsize,grainsize,Type1,Type2,Type3>::value, stream);
+}
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -18,4 +18,6 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/iterator/strided_iterator.hpp> 
+#include <bulk/iterator/bitpacked_iterator.hpp>
+#include <bulk/iterator/delta_iterator.hpp>
 
@@ -0,0 +1,328 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/tile_loader.hpp>
+#include <bulk/scoped_buffer.hpp>
+#include <bulk/uninitialized.hpp>
+#include <thrust/iterator/iterator_facade.h>
+#include <thrust/iterator/iterator_categories.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+template<unsigned int bits>
+struct low_bits_mask
+{
+  static const unsigned int value = (1u << bits) - 1;
+};
+
+
+template<>
+struct low_bits_mask<32>
+{
+  static const unsigned int value = ~0u;
+};
+
+
+// extracts the bits bits of an array of 32b words which begin at bit offset
+template<unsigned int bits>
+inline __host__ __device__
+unsigned int extract_bits(const unsigned int *words, std::size_t offset)
+{
+  std::size_t word = offset / 32;
+  unsigned int shift = offset % 32;
+
+  unsigned int result = words[word] >> shift;
+
+  // the field straddles two words
+  if(shift + bits > 32)
+  {
+    result |= words[word + 1] << (32 - shift);
+  } // end if
+
+  return result & low_bits_mask<bits>::value;
+} // end extract_bits()
+
+
+// appends fields of bits bits to an array of 32b words, beginning at bit 0
+template<unsigned int bits>
+class bit_packer
+{
+  public:
+    bit_packer(unsigned int *result)
+      : m_result(result),
+        m_buffer(0),
+        m_num_buffered(0)
+    {}
+
+    // returns false if x does not fit in bits bits, in which case only its low bits are kept
+    bool push_back(unsigned long long x)
+    {
+      m_buffer |= (x & low_bits_mask<bits>::value) << m_num_buffered;
+      m_num_buffered += bits;
+
+      if(m_num_buffered >= 32)
+      {
+        *m_result = static_cast<unsigned int>(m_buffer);
+        ++m_result;
+
+        m_buffer >>= 32;
+        m_num_buffered -= 32;
+      } // end if
+
+      return x <= low_bits_mask<bits>::value;
+    } // end push_back()
+
+    // writes the last partial word
+    void flush()
+    {
+      if(m_num_buffered > 0)
+      {
+        *m_result = static_cast<unsigned int>(m_buffer);
+        ++m_result;
+
+        m_buffer = 0;
+        m_num_buffered = 0;
+      } // end if
+    } // end flush()
+
+  private:
+    unsigned int *m_result;
+    unsigned long long m_buffer;
+    unsigned int m_num_buffered;
+}; // end bit_packer
+
+
+} // end detail
+
+
+// a random access iterator over a column of Ts which bitpack() has packed into Bits bits per element,
+// where element i is base plus the Bits bits which begin at bit i * Bits of an array of 32b words
+//
+// reading a packed column moves sizeof(T) * 8 / Bits times fewer bytes than reading the Ts. dereferencing
+// decodes a single element, but bulk::reduce & bulk::copy_n load whole tiles through tile_loader, which
+// stages each word of a tile in the group's heap once & decodes every element of the tile from there
+template<typename T, unsigned int Bits>
+class bitpacked_iterator
+  : public thrust::iterator_facade<
+      bitpacked_iterator<T,Bits>,
+      T,
+      thrust::device_system_tag,
+      thrust::random_access_traversal_tag,
+      T,
+      std::ptrdiff_t
+    >
+{
+  private:
+    typedef thrust::iterator_facade<
+      bitpacked_iterator<T,Bits>,
+      T,
+      thrust::device_system_tag,
+      thrust::random_access_traversal_tag,
+      T,
+      std::ptrdiff_t
+    > super_t;
+
+  public:
+    typedef typename super_t::difference_type difference_type;
+
+    static const unsigned int bits = Bits;
+
+    inline __host__ __device__
+    bitpacked_iterator()
+      : m_words(0), m_base(), m_index(0)
+    {}
+
+    inline __host__ __device__
+    bitpacked_iterator(const unsigned int *words, T base = T(), difference_type index = 0)
+      : m_words(words), m_base(base), m_index(index)
+    {}
+
+    inline __host__ __device__
+    const unsigned int *words() const
+    {
+      return m_words;
+    }
+
+    inline __host__ __device__
+    T base() const
+    {
+      return m_base;
+    }
+
+    // the position of this iterator in its column
+    inline __host__ __device__
+    difference_type index() const
+    {
+      return m_index;
+    }
+
+  private:
+    friend class thrust::iterator_core_access;
+
+    __host__ __device__
+    T dereference() const
+    {
+      return m_base + T(detail::extract_bits<Bits>(m_words, m_index * Bits));
+    }
+
+    __host__ __device__
+    bool equal(const bitpacked_iterator &other) const
+    {
+      return m_index == other.m_index;
+    }
+
+    __host__ __device__
+    void increment()
+    {
+      ++m_index;
+    }
+
+    __host__ __device__
+    void decrement()
+    {
+      --m_index;
+    }
+
+    __host__ __device__
+    void advance(difference_type n)
+    {
+      m_index += n;
+    }
+
+    __host__ __device__
+    difference_type distance_to(const bitpacked_iterator &other) const
+    {
+      return other.m_index - m_index;
+    }
+
+    const unsigned int *m_words;
+    T m_base;
+    difference_type m_index;
+};
+
+
+// the number of 32b words which hold n elements of bits bits each
+inline __host__ __device__
+std::size_t bitpacked_size(std::size_t n, unsigned int bits)
+{
+  return (n * bits + 31) / 32;
+} // end bitpacked_size()
+
+
+// packs [first, last) into result relative to base, Bits bits per element, as bitpacked_iterator<T,Bits>(result, base) reads it
+// result must hold bitpacked_size(last - first, Bits) words
+// returns false if some element is less than base or does not fit, in which case only its low Bits bits are kept
+template<unsigned int Bits, typename InputIterator, typename T>
+bool bitpack(InputIterator first, InputIterator last, T base, unsigned int *result)
+{
+  detail::bit_packer<Bits> packer(result);
+
+  bool fits = true;
+
+  for(; first != last; ++first)
+  {
+    T x = *first;
+
+    fits &= !(x < base);
+    fits &= packer.push_back(static_cast<unsigned long long>(x - base));
+  } // end for
+
+  packer.flush();
+
+  return fits;
+} // end bitpack()
+
+
+namespace detail
+{
+
+
+template<typename T, unsigned int Bits>
+struct tile_loader<bitpacked_iterator<T,Bits> >
+{
+  static const bool decodes_tiles = true;
+
+  template<std::size_t groupsize, std::size_t grainsize>
+  struct staging
+  {
+    // the words of a whole tile, plus one for a tile which does not begin on a word boundary
+    static const std::size_t max_num_words = (groupsize * grainsize * Bits + 31) / 32 + 1;
+
+    static const std::size_t footprint = scoped_buffer_footprint<max_num_words * sizeof(unsigned int)>::value;
+  };
+
+  template<std::size_t groupsize, std::size_t grainsize, typename ConcurrentGroup, typename Size, typename U>
+  __device__
+  static Size load(ConcurrentGroup &g, bitpacked_iterator<T,Bits> first, Size partition_size, U *local_inputs)
+  {
+    const std::size_t max_num_words = staging<groupsize,grainsize>::max_num_words;
+
+#if __CUDA_ARCH__ >= 200
+    bulk::scoped_buffer<unsigned int> s_words_impl(g, max_num_words);
+#else
+    __shared__ uninitialized_array<unsigned int, max_num_words> s_words_impl;
+#endif
+    unsigned int *s_words = s_words_impl.data();
+
+    Size tid = g.this_exec.index();
+
+    std::size_t first_bit = first.index() * Bits;
+    unsigned int offset = first_bit % 32;
+
+    const unsigned int *words = first.words() + first_bit / 32;
+    Size num_words = (offset + partition_size * Bits + 31) / 32;
+
+    // each word of the tile is loaded once & consecutive agents load consecutive words
+    for(Size i = tid; i < num_words; i += groupsize)
+    {
+      s_words[i] = words[i];
+    } // end for
+
+    g.wait();
+
+    Size local_size = 0;
+    Size index = tid;
+    for(Size i = 0; i < grainsize; ++i, index += groupsize)
+    {
+      if(index < partition_size)
+      {
+        local_inputs[i] = first.base() + T(extract_bits<Bits>(s_words, offset + index * Bits));
+        ++local_size;
+      } // end if
+    } // end for
+
+    // the next tile overwrites s_words
+    g.wait();
+
+    return local_size;
+  } // end load()
+}; // end tile_loader
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,326 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/tile_loader.hpp>
+#include <bulk/iterator/bitpacked_iterator.hpp>
+#include <bulk/scoped_buffer.hpp>
+#include <bulk/uninitialized.hpp>
+#include <thrust/iterator/iterator_facade.h>
+#include <thrust/iterator/iterator_categories.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a random access iterator over a sorted column of Ts which delta_encode() has encoded in frames of FrameSize
+// elements. each frame keeps its first element, its anchor, as a T, & the difference between each of its other
+// elements & the element before, packed into Bits bits at bit i * Bits of an array of 32b words like
+// bitpacked_iterator, so element i is the anchor of its frame plus the deltas of its frame up to i
+//
+// dereferencing decodes the element's frame up to the element, but bulk::reduce & bulk::copy_n load whole
+// tiles through tile_loader, which stages the deltas of a tile in the group's heap & decodes its frames with
+// a scan of each frame which the whole group shares
+template<typename T, unsigned int Bits, unsigned int FrameSize = 32>
+class delta_iterator
+  : public thrust::iterator_facade<
+      delta_iterator<T,Bits,FrameSize>,
+      T,
+      thrust::device_system_tag,
+      thrust::random_access_traversal_tag,
+      T,
+      std::ptrdiff_t
+    >
+{
+  private:
+    typedef thrust::iterator_facade<
+      delta_iterator<T,Bits,FrameSize>,
+      T,
+      thrust::device_system_tag,
+      thrust::random_access_traversal_tag,
+      T,
+      std::ptrdiff_t
+    > super_t;
+
+  public:
+    typedef typename super_t::difference_type difference_type;
+
+    static const unsigned int bits = Bits;
+    static const unsigned int frame_size = FrameSize;
+
+    inline __host__ __device__
+    delta_iterator()
+      : m_anchors(0), m_deltas(0), m_index(0)
+    {}
+
+    inline __host__ __device__
+    delta_iterator(const T *anchors, const unsigned int *deltas, difference_type index = 0)
+      : m_anchors(anchors), m_deltas(deltas), m_index(index)
+    {}
+
+    inline __host__ __device__
+    const T *anchors() const
+    {
+      return m_anchors;
+    }
+
+    inline __host__ __device__
+    const unsigned int *deltas() const
+    {
+      return m_deltas;
+    }
+
+    // the position of this iterator in its column
+    inline __host__ __device__
+    difference_type index() const
+    {
+      return m_index;
+    }
+
+  private:
+    friend class thrust::iterator_core_access;
+
+    __host__ __device__
+    T dereference() const
+    {
+      difference_type frame = m_index / FrameSize;
+
+      T result = m_anchors[frame];
+
+      for(difference_type j = frame * FrameSize + 1; j <= m_index; ++j)
+      {
+        result += T(detail::extract_bits<Bits>(m_deltas, j * Bits));
+      }
+
+      return result;
+    }
+
+    __host__ __device__
+    bool equal(const delta_iterator &other) const
+    {
+      return m_index == other.m_index;
+    }
+
+    __host__ __device__
+    void increment()
+    {
+      ++m_index;
+    }
+
+    __host__ __device__
+    void decrement()
+    {
+      --m_index;
+    }
+
+    __host__ __device__
+    void advance(difference_type n)
+    {
+      m_index += n;
+    }
+
+    __host__ __device__
+    difference_type distance_to(const delta_iterator &other) const
+    {
+      return other.m_index - m_index;
+    }
+
+    const T *m_anchors;
+    const unsigned int *m_deltas;
+    difference_type m_index;
+};
+
+
+// the number of anchors of a column of n elements encoded in frames of frame_size elements
+inline __host__ __device__
+std::size_t delta_num_frames(std::size_t n, unsigned int frame_size)
+{
+  return (n + frame_size - 1) / frame_size;
+} // end delta_num_frames()
+
+
+// encodes [first, last) as delta_iterator<T,Bits,FrameSize>(anchors, deltas) reads it
+// anchors must hold delta_num_frames(last - first, FrameSize) Ts & deltas must hold bitpacked_size(last - first, Bits) words
+// returns false if some element is less than the one before it or differs from it by too much to fit in Bits bits,
+// in which case only the low Bits bits of the difference are kept
+template<unsigned int Bits, unsigned int FrameSize, typename InputIterator, typename T>
+bool delta_encode(InputIterator first, InputIterator last, T *anchors, unsigned int *deltas)
+{
+  detail::bit_packer<Bits> packer(deltas);
+
+  bool fits = true;
+
+  T previous = T();
+
+  for(std::size_t i = 0; first != last; ++first, ++i)
+  {
+    T x = *first;
+
+    if(i % FrameSize == 0)
+    {
+      *anchors = x;
+      ++anchors;
+
+      // the first slot of each frame is unused, so that element i's delta begins at bit i * Bits
+      packer.push_back(0);
+    } // end if
+    else
+    {
+      fits &= !(x < previous);
+      fits &= packer.push_back(static_cast<unsigned long long>(x - previous));
+    } // end else
+
+    previous = x;
+  } // end for
+
+  packer.flush();
+
+  return fits;
+} // end delta_encode()
+
+
+namespace detail
+{
+
+
+template<typename T, unsigned int Bits, unsigned int FrameSize>
+struct tile_loader<delta_iterator<T,Bits,FrameSize> >
+{
+  static const bool decodes_tiles = true;
+
+  template<std::size_t groupsize, std::size_t grainsize>
+  struct staging
+  {
+    // the elements from the beginning of the tile's first frame to the end of the tile
+    static const std::size_t max_span = groupsize * grainsize + FrameSize - 1;
+
+    // the deltas of the span, plus one word for a frame which does not begin on a word boundary
+    static const std::size_t max_num_words = (max_span * Bits + 31) / 32 + 1;
+
+    static const std::size_t footprint =
+      scoped_buffer_footprint<max_num_words * sizeof(unsigned int)>::value +
+      scoped_buffer_footprint<max_span * sizeof(T)>::value;
+  };
+
+  template<std::size_t groupsize, std::size_t grainsize, typename ConcurrentGroup, typename Size, typename U>
+  __device__
+  static Size load(ConcurrentGroup &g, delta_iterator<T,Bits,FrameSize> first, Size partition_size, U *local_inputs)
+  {
+    const std::size_t max_span = staging<groupsize,grainsize>::max_span;
+    const std::size_t max_span_per_agent = (max_span + groupsize - 1) / groupsize;
+    const std::size_t max_num_words = staging<groupsize,grainsize>::max_num_words;
+
+#if __CUDA_ARCH__ >= 200
+    bulk::scoped_buffer<unsigned int> s_words_impl(g, max_num_words);
+    bulk::scoped_buffer<T> s_values_impl(g, max_span);
+#else
+    __shared__ uninitialized_array<unsigned int, max_num_words> s_words_impl;
+    __shared__ uninitialized_array<T, max_span> s_values_impl;
+#endif
+    unsigned int *s_words = s_words_impl.data();
+    T *s_values = s_values_impl.data();
+
+    typedef typename delta_iterator<T,Bits,FrameSize>::difference_type difference_type;
+
+    Size tid = g.this_exec.index();
+
+    difference_type tile_begin = first.index();
+    difference_type tile_end = tile_begin + partition_size;
+
+    difference_type first_frame = tile_begin / FrameSize;
+    difference_type span_begin = first_frame * FrameSize;
+    Size span = partition_size ? tile_end - span_begin : 0;
+
+    std::size_t first_bit = span_begin * Bits;
+    unsigned int offset = first_bit % 32;
+
+    const unsigned int *words = first.deltas() + first_bit / 32;
+    Size num_words = (offset + span * Bits + 31) / 32;
+
+    // each word of the tile is loaded once & consecutive agents load consecutive words
+    for(Size i = tid; i < num_words; i += groupsize)
+    {
+      s_words[i] = words[i];
+    } // end for
+
+    g.wait();
+
+    // each frame begins with its anchor & continues with its deltas
+    for(Size i = tid; i < span; i += groupsize)
+    {
+      s_values[i] = (i % FrameSize == 0) ?
+        first.anchors()[first_frame + i / FrameSize] :
+        T(extract_bits<Bits>(s_words, offset + i * Bits));
+    } // end for
+
+    g.wait();
+
+    // an inclusive scan of each frame decodes it, and the agents share the work of every frame
+    for(Size stride = 1; stride < FrameSize; stride *= 2)
+    {
+      T addends[max_span_per_agent];
+
+      Size i = tid;
+      for(Size j = 0; j < max_span_per_agent; ++j, i += groupsize)
+      {
+        if(i < span && i % FrameSize >= stride)
+        {
+          addends[j] = s_values[i - stride];
+        } // end if
+      } // end for
+
+      g.wait();
+
+      i = tid;
+      for(Size j = 0; j < max_span_per_agent; ++j, i += groupsize)
+      {
+        if(i < span && i % FrameSize >= stride)
+        {
+          s_values[i] += addends[j];
+        } // end if
+      } // end for
+
+      g.wait();
+    } // end for
+
+    Size local_size = 0;
+    Size index = tid;
+    for(Size i = 0; i < grainsize; ++i, index += groupsize)
+    {
+      if(index < partition_size)
+      {
+        local_inputs[i] = s_values[tile_begin - span_begin + index];
+        ++local_size;
+      } // end if
+    } // end for
+
+    // the next tile overwrites s_words & s_values
+    g.wait();
+
+    return local_size;
+  } // end load()
+}; // end tile_loader
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -19,16 +19,56 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/detail/pointer_traits.hpp>
 #include <bulk/detail/alignment.hpp>
+#include <bulk/detail/atomic.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/detail/config.h>
 #include <cstdlib>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(BULK_HEAP_INSTRUMENTATION)
+#include <bulk/detail/throw_on_error.hpp>
+#endif
+
 
 BULK_NAMESPACE_PREFIX
 namespace bulk
 {
 
 
+// the heap use of the launches since the last reset_process_heap_statistics()
+// which is recorded only when BULK_HEAP_INSTRUMENTATION is defined
+//
+// the statistics are process-wide, not per launch: every launch on the device, from every
+// stream & host thread, counts into the same statistics, so to attribute them to a single
+// launch, reset them before it & read them after it with no other launch in flight
+struct heap_statistics
+{
+  // allocations served by groups' on-chip heaps
+  unsigned long long num_on_chip_allocations;
+  unsigned long long num_on_chip_bytes;
+
+  // allocations which fell back to a group's slice of the launch's overflow heap
+  // because its on-chip heap was exhausted
+  unsigned long long num_overflow_allocations;
+  unsigned long long num_overflow_bytes;
+
+  // allocations which fell back to the global heap because
+  // both a group's on-chip heap & its overflow slice were exhausted
+  unsigned long long num_global_allocations;
+  unsigned long long num_global_bytes;
+
+  unsigned long long largest_allocation;
+
+  // the most bytes of any one group's heap in use at once,
+  // which is the least heap_size that avoids falling back to the overflow or global heaps
+  unsigned long long high_water_mark;
+};
+
+
+
 inline __device__ bool is_on_chip(void *ptr)
 {
   return bulk::detail::is_shared(ptr);
@@ -50,9 +90,9 @@ inline __device__ T *on_chip_cast(T *ptr)
   // Some of this UB causes clang to miscompile this function.  Since it's just
   // an optimization, enable it only for nvcc for now.  We can revisit this if
   // the performance impact is large.
-  extern __shared__ char s_begin[];		    extern __shared__ char s_begin[];
-  void *result = (reinterpret_cast<char*>(ptr) - s_begin) + s_begin;		    void *result = (reinterpret_cast<char*>(ptr) - s_begin) + s_begin;
-  return reinterpret_cast<T*>(result);		    return reinterpret_cast<T*>(result);
+  extern __shared__ char s_begin[];
+  void *result = (reinterpret_cast<char*>(ptr) - s_begin) + s_begin;
+  return reinterpret_cast<T*>(result);
 #else
   return ptr;
 #endif
@@ -66,17 +106,21 @@ namespace detail
 extern __shared__ int s_data_segment_begin[];
 
 
+// manages the program break of an arena beginning at data_segment_begin
+// the arena is usually the CTA's dynamic shared memory, but it may be any memory,
+// which allows the allocators below to be exercised on the host
 class os
 {
   public:
-    __device__ inline os(size_t max_data_segment_size)
-      : m_program_break(s_data_segment_begin),
+    __host__ __device__ inline os(void *data_segment_begin, size_t max_data_segment_size)
+      : m_data_segment_begin(data_segment_begin),
+        m_program_break(data_segment_begin),
         m_max_data_segment_size(max_data_segment_size)
     {
     }
 
 
-    __device__ inline int brk(void *end_data_segment)
+    __host__ __device__ inline int brk(void *end_data_segment)
     {
       if(end_data_segment <= m_program_break)
       {
@@ -88,7 +132,7 @@ class os
     }
 
 
-    __device__ inline void *sbrk(size_t increment)
+    __host__ __device__ inline void *sbrk(size_t increment)
     {
       if(data_segment_size() + increment <= m_max_data_segment_size)
       {
@@ -103,25 +147,33 @@ class os
     }
 
 
-    __device__ inline void *program_break() const
+    __host__ __device__ inline void *program_break() const
     {
       return m_program_break;
     }
 
     
-    __device__ inline void *data_segment_begin() const
+    __host__ __device__ inline void *data_segment_begin() const
+    {
+      return m_data_segment_begin;
+    }
+
+
+    __host__ __device__ inline void set_max_data_segment_size(size_t max_data_segment_size)
     {
-      return s_data_segment_begin;
+      m_max_data_segment_size = max_data_segment_size;
     }
 
 
   private:
-    __device__ inline size_t data_segment_size()
+    __host__ __device__ inline size_t data_segment_size()
     {
-      return reinterpret_cast<char*>(m_program_break) - reinterpret_cast<char*>(s_data_segment_begin);
+      return reinterpret_cast<char*>(m_program_break) - reinterpret_cast<char*>(m_data_segment_begin);
     } // end data_segment_size()
 
 
+    void *m_data_segment_begin;
+
     void *m_program_break;
 
     // XXX this can safely be uint32
@@ -129,23 +181,51 @@ class os
 };
 
 
-// only one instance of this class can logically exist per CTA, and its use is thread-unsafe
-class singleton_unsafe_on_chip_allocator
+inline __host__ __device__ int find_first_set(unsigned int x)
+{
+#if defined(__CUDA_ARCH__)
+  return __ffs(static_cast<int>(x));
+#elif defined(_MSC_VER)
+  unsigned long index;
+  return _BitScanForward(&index, x) ? static_cast<int>(index) + 1 : 0;
+#else
+  return __builtin_ffs(static_cast<int>(x));
+#endif
+} // end find_first_set()
+
+
+// requires x > 0
+inline __host__ __device__ int floor_log2(unsigned int x)
+{
+#if defined(__CUDA_ARCH__)
+  return 31 - __clz(static_cast<int>(x));
+#elif defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse(&index, x);
+  return static_cast<int>(index);
+#else
+  return 31 - __builtin_clz(x);
+#endif
+} // end floor_log2()
+
+
+// a first-fit allocator whose allocate walks the list of every block in the heap
+// its use is thread-unsafe
+class first_fit_allocator
 {
   public:
-    __device__ inline singleton_unsafe_on_chip_allocator(size_t max_data_segment_size)
-      : m_os(max_data_segment_size)
+    __host__ __device__ inline first_fit_allocator(void *data_segment_begin, size_t max_data_segment_size)
+      : m_os(data_segment_begin, max_data_segment_size)
     {}
   
-    __device__ inline void *allocate(size_t size)
+    __host__ __device__ inline void *allocate(size_t size)
     {
       size_t aligned_size = align8(size);
     
-      block *prev = find_first_free_insertion_point(heap_begin(), heap_end(), aligned_size);
-    
-      block *b;
+      block *prev = 0;
+      block *b = find_first_fit(heap_begin(), heap_end(), aligned_size, prev);
     
-      if(prev != heap_end() && (b = prev->next()) != heap_end())
+      if(b != heap_end())
       {
         // can we split?
         if((b->size() - aligned_size) >= sizeof(block))
@@ -157,7 +237,7 @@ class singleton_unsafe_on_chip_allocator
       } // end if
       else
       {
-        // nothing fits, extend the heap
+        // nothing fits, extend the heap after its last block
         b = extend_heap(prev, aligned_size);
         if(b == heap_end())
         {
@@ -169,7 +249,7 @@ class singleton_unsafe_on_chip_allocator
     } // end allocate()
   
   
-    __device__ inline void deallocate(void *ptr)
+    __host__ __device__ inline void deallocate(void *ptr)
     {
       if(ptr != 0)
       {
@@ -204,48 +284,48 @@ class singleton_unsafe_on_chip_allocator
     class block : public bulk::detail::aligned_type<sizeof(size_t) + sizeof(block*)>::type
     {
       public:
-        __device__ inline size_t size() const
+        __host__ __device__ inline size_t size() const
         {
           return m_size;
         } // end size()
 
-        __device__ void set_size(size_t sz)
+        __host__ __device__ void set_size(size_t sz)
         {
           m_size = sz;
         } // end set_size()
 
-        __device__ inline block *prev() const
+        __host__ __device__ inline block *prev() const
         {
           return m_prev;
         } // end prev()
 
-        __device__ void set_prev(block *p)
+        __host__ __device__ void set_prev(block *p)
         {
           m_prev = p;
         } // end set_prev()
 
         // returns a pointer to the indexth byte within this block's data
-        __device__ inline void *byte_at(size_t index) const
+        __host__ __device__ inline void *byte_at(size_t index) const
         {
           return reinterpret_cast<char*>(data()) + index;
         } // end byte_at()
 
-        __device__ inline block *next() const
+        __host__ __device__ inline block *next() const
         {
           return reinterpret_cast<block*>(byte_at(size()));
         } // end next()
 
-        __device__ inline bool is_free() const
+        __host__ __device__ inline bool is_free() const
         {
           return m_is_free;
         } // end is_free()
 
-        __device__ inline void set_is_free(bool f)
+        __host__ __device__ inline void set_is_free(bool f)
         {
           m_is_free = f;
         } // end set_is_free()
 
-        __device__ inline void *data() const
+        __host__ __device__ inline void *data() const
         {
           return reinterpret_cast<char*>(const_cast<block*>(this)) + sizeof(block);
         } // end data()
@@ -262,19 +342,19 @@ class singleton_unsafe_on_chip_allocator
   
     os     m_os;
 
-    __device__ inline block *heap_begin() const
+    __host__ __device__ inline block *heap_begin() const
     {
       return reinterpret_cast<block*>(m_os.data_segment_begin());
     } // end heap_begin()
 
 
-    __device__ inline block *heap_end() const
+    __host__ __device__ inline block *heap_end() const
     {
       return reinterpret_cast<block*>(m_os.program_break());
     } // end heap_end();
   
   
-    __device__ inline void split_block(block *b, size_t size)
+    __host__ __device__ inline void split_block(block *b, size_t size)
     {
       block *new_block;
     
@@ -298,7 +378,7 @@ class singleton_unsafe_on_chip_allocator
     } // end split_block()
   
   
-    __device__ inline bool fuse_block(block *b)
+    __host__ __device__ inline bool fuse_block(block *b)
     {
       if(b->next() != heap_end() && b->next()->is_free())
       {
@@ -317,7 +397,7 @@ class singleton_unsafe_on_chip_allocator
     } // end fuse_block()
   
   
-    __device__ inline static block *get_block(void *data)
+    __host__ __device__ inline static block *get_block(void *data)
     {
       // the block metadata lives sizeof(block) bytes to the left of data
       void *ptr = reinterpret_cast<char*>(data) - sizeof(block);
@@ -325,9 +405,11 @@ class singleton_unsafe_on_chip_allocator
     } // end get_block()
   
   
-    __device__ inline static block *find_first_free_insertion_point(block *first, block *last, size_t size)
+    // returns the first free block of at least size bytes, or last if there is none,
+    // and sets prev to the block before it, or to null if it is the first block
+    __host__ __device__ inline static block *find_first_fit(block *first, block *last, size_t size, block *&prev)
     {
-      block *prev = last;
+      prev = 0;
     
       while(first != last && !(first->is_free() && first->size() >= size))
       {
@@ -335,11 +417,11 @@ class singleton_unsafe_on_chip_allocator
         first = first->next();
       }
     
-      return prev;
-    } // end find_first_free_insertion_point()
+      return first;
+    } // end find_first_fit()
   
   
-    __device__ inline block *extend_heap(block *prev, size_t size)
+    __host__ __device__ inline block *extend_heap(block *prev, size_t size)
     {
       // the new block goes at the current end of the heap
       block *new_block = heap_end();
@@ -351,21 +433,611 @@ class singleton_unsafe_on_chip_allocator
         return new_block;
       }
     
-      on_chip_cast(new_block)->set_size(size);
-      on_chip_cast(new_block)->set_prev(prev);
-      on_chip_cast(new_block)->set_is_free(false);
+      new_block->set_size(size);
+      new_block->set_prev(prev);
+      new_block->set_is_free(false);
     
       return new_block;
     } // end extend_heap()
   
   
-    __device__ inline static size_t align8(size_t size)
+    __host__ __device__ inline static size_t align8(size_t size)
     {
       return ((((size - 1) >> 3) << 3) + 8);
     } // end align4()
-}; // end singleton_unsafe_on_chip_allocator
+}; // end first_fit_allocator
+
+
+// a segregated-fit allocator whose allocate & deallocate take constant time
+//
+// free blocks are kept in doubly-linked lists by size class, where class k holds
+// blocks of [2^k, 2^(k+1)) bytes, and a bitmap records which lists are non-empty.
+// allocate takes a block from the smallest non-empty class guaranteed to fit and
+// splits off the remainder, or else bumps the program break. deallocate fuses a
+// block with its free neighbors and returns it to the os if it ends the heap.
+//
+// blocks are named by their 32-bit offset from the beginning of the data segment,
+// which keeps the list heads small enough to live in shared memory
+// its use is thread-unsafe
+class size_class_allocator
+{
+  private:
+    typedef unsigned int offset_type;
+
+    static const unsigned int num_size_classes = 32;
+
+
+  public:
+    __host__ __device__ inline size_class_allocator(void *data_segment_begin, size_t max_data_segment_size)
+      : m_os(data_segment_begin, max_data_segment_size),
+        m_last_block(null_offset()),
+        m_nonempty_size_classes(0)
+    {
+      for(unsigned int i = 0; i < num_size_classes; ++i)
+      {
+        m_free_lists[i] = null_offset();
+      } // end for
+    }
+
+
+    __host__ __device__ inline void *allocate(size_t size)
+    {
+      size = align8(size);
+
+      offset_type block = null_offset();
+
+      int size_class = floor_log2(static_cast<offset_type>(size));
+
+      // the head of the request's own class often fits, so try it first
+      if(is_nonempty(size_class) && block_size(m_free_lists[size_class]) >= size)
+      {
+        block = m_free_lists[size_class];
+      } // end if
+      else if(size_class + 1 < static_cast<int>(num_size_classes))
+      {
+        // every block of a larger class fits
+        offset_type larger_classes = m_nonempty_size_classes & (~offset_type(0) << (size_class + 1));
+
+        if(larger_classes)
+        {
+          block = m_free_lists[find_first_set(larger_classes) - 1];
+        } // end if
+      } // end else if
+
+      if(block == null_offset())
+      {
+        return extend_heap(size);
+      } // end if
+
+      unlink(block);
+      split_block(block, size);
+      set_is_free(block, false);
+
+      return data(block);
+    } // end allocate()
+
+
+    __host__ __device__ inline void deallocate(void *ptr)
+    {
+      if(ptr == 0) return;
+
+      offset_type block = offset_of(reinterpret_cast<block_header*>(ptr) - 1);
+
+      // fuse with the previous block
+      offset_type prev = header(block).prev;
+      if(prev != null_offset() && is_free(prev))
+      {
+        unlink(prev);
+        set_block_size(prev, block_size(prev) + sizeof(block_header) + block_size(block));
+        block = prev;
+      } // end if
+
+      // fuse with the next block
+      offset_type next = next_block(block);
+      if(next != program_break_offset() && is_free(next))
+      {
+        unlink(next);
+        set_block_size(block, block_size(block) + sizeof(block_header) + block_size(next));
+        next = next_block(block);
+      } // end if
+
+      if(next == program_break_offset())
+      {
+        // the block ends the heap, so give it back to the os
+        m_last_block = header(block).prev;
+        m_os.brk(&header(block));
+      } // end if
+      else
+      {
+        header(next).prev = block;
+        set_is_free(block, true);
+        link(block);
+      } // end else
+    } // end deallocate()
+
+
+    // grows the allocation at ptr to size bytes, which succeeds only when it ends the heap
+    // & the program break can rise to accomodate it
+    __host__ __device__ inline bool extend(void *ptr, size_t size)
+    {
+      size = align8(size);
+
+      offset_type block = offset_of(reinterpret_cast<block_header*>(ptr) - 1);
+
+      if(next_block(block) != program_break_offset() || size < block_size(block)) return false;
+
+      if(size - block_size(block) >= null_offset() - program_break_offset()) return false;
+
+      if(m_os.sbrk(size - block_size(block)) == reinterpret_cast<void*>(-1))
+      {
+        return false;
+      } // end if
+
+      set_block_size(block, static_cast<offset_type>(size));
+
+      return true;
+    } // end extend()
+
+
+    // shrinks the allocation at ptr to size bytes & frees the rest, which fails when the rest is too small to be a block
+    __host__ __device__ inline bool shrink(void *ptr, size_t size)
+    {
+      size = align8(size);
+
+      offset_type block = offset_of(reinterpret_cast<block_header*>(ptr) - 1);
+
+      if(size > block_size(block) || block_size(block) - size < sizeof(block_header) + sizeof(free_list_links))
+      {
+        return false;
+      } // end if
+
+      offset_type next = next_block(block);
+
+      // split off the rest as an allocated block & free it, which fuses it with the next block or returns it to the os
+      set_block_size(block, static_cast<offset_type>(size));
+
+      offset_type rest = next_block(block);
+      header(rest).size_and_is_free = next - rest - sizeof(block_header);
+      header(rest).prev = block;
+
+      if(next == program_break_offset())
+      {
+        m_last_block = rest;
+      } // end if
+      else
+      {
+        header(next).prev = rest;
+      } // end else
+
+      deallocate(data(rest));
+
+      return true;
+    } // end shrink()
+
+
+    // the bytes below the program break
+    __host__ __device__ inline size_t heap_size() const
+    {
+      return program_break_offset();
+    } // end heap_size()
+
+
+    // the program break may not rise past limit bytes
+    __host__ __device__ inline void set_heap_limit(size_t limit)
+    {
+      m_os.set_max_data_segment_size(limit);
+    } // end set_heap_limit()
+
+
+  private:
+    // the low bit of size_and_is_free holds is_free, because sizes are multiples of 8
+    struct block_header
+    {
+      offset_type size_and_is_free;
+      offset_type prev;
+    };
+
+
+    // a free block stores the links of its size class's list in its data
+    struct free_list_links
+    {
+      offset_type next;
+      offset_type prev;
+    };
+
+
+    os m_os;
+    offset_type m_last_block;
+    offset_type m_nonempty_size_classes;
+    offset_type m_free_lists[num_size_classes];
+
 
+    __host__ __device__ inline static offset_type null_offset()
+    {
+      return ~offset_type(0);
+    } // end null_offset()
+
+
+    __host__ __device__ inline static size_t align8(size_t size)
+    {
+      // a free block must be able to hold its list links
+      return size ? ((((size - 1) >> 3) << 3) + 8) : 8;
+    } // end align8()
+
+
+    __host__ __device__ inline char *data_segment_begin() const
+    {
+      return reinterpret_cast<char*>(m_os.data_segment_begin());
+    } // end data_segment_begin()
+
+
+    __host__ __device__ inline offset_type program_break_offset() const
+    {
+      return static_cast<offset_type>(reinterpret_cast<char*>(m_os.program_break()) - data_segment_begin());
+    } // end program_break_offset()
+
+
+    __host__ __device__ inline offset_type offset_of(block_header *b) const
+    {
+      return static_cast<offset_type>(reinterpret_cast<char*>(b) - data_segment_begin());
+    } // end offset_of()
+
+
+    __host__ __device__ inline block_header &header(offset_type block) const
+    {
+      return *reinterpret_cast<block_header*>(data_segment_begin() + block);
+    } // end header()
+
+
+    __host__ __device__ inline void *data(offset_type block) const
+    {
+      return &header(block) + 1;
+    } // end data()
+
+
+    __host__ __device__ inline free_list_links &links(offset_type block) const
+    {
+      return *reinterpret_cast<free_list_links*>(data(block));
+    } // end links()
+
+
+    __host__ __device__ inline offset_type block_size(offset_type block) const
+    {
+      return header(block).size_and_is_free & ~offset_type(1);
+    } // end block_size()
+
+
+    __host__ __device__ inline void set_block_size(offset_type block, offset_type size)
+    {
+      header(block).size_and_is_free = size | (header(block).size_and_is_free & 1);
+    } // end set_block_size()
+
+
+    __host__ __device__ inline bool is_free(offset_type block) const
+    {
+      return header(block).size_and_is_free & 1;
+    } // end is_free()
+
+
+    __host__ __device__ inline void set_is_free(offset_type block, bool is_free)
+    {
+      header(block).size_and_is_free = block_size(block) | (is_free ? 1 : 0);
+    } // end set_is_free()
+
+
+    __host__ __device__ inline offset_type next_block(offset_type block) const
+    {
+      return block + sizeof(block_header) + block_size(block);
+    } // end next_block()
+
+
+    __host__ __device__ inline bool is_nonempty(int size_class) const
+    {
+      return (m_nonempty_size_classes >> size_class) & 1;
+    } // end is_nonempty()
+
+
+    __host__ __device__ inline void link(offset_type block)
+    {
+      int size_class = floor_log2(block_size(block));
+
+      links(block).next = m_free_lists[size_class];
+      links(block).prev = null_offset();
+
+      if(m_free_lists[size_class] != null_offset())
+      {
+        links(m_free_lists[size_class]).prev = block;
+      } // end if
+
+      m_free_lists[size_class] = block;
+      m_nonempty_size_classes |= offset_type(1) << size_class;
+    } // end link()
+
+
+    __host__ __device__ inline void unlink(offset_type block)
+    {
+      int size_class = floor_log2(block_size(block));
+
+      free_list_links l = links(block);
+
+      if(l.prev != null_offset())
+      {
+        links(l.prev).next = l.next;
+      } // end if
+      else
+      {
+        m_free_lists[size_class] = l.next;
+      } // end else
+
+      if(l.next != null_offset())
+      {
+        links(l.next).prev = l.prev;
+      } // end if
+
+      if(m_free_lists[size_class] == null_offset())
+      {
+        m_nonempty_size_classes &= ~(offset_type(1) << size_class);
+      } // end if
+    } // end unlink()
+
+
+    // shrinks block to size bytes and frees the remainder, if it is large enough to be a block
+    __host__ __device__ inline void split_block(offset_type block, size_t size)
+    {
+      size_t remainder_size = block_size(block) - size;
+
+      if(remainder_size >= sizeof(block_header) + sizeof(free_list_links))
+      {
+        set_block_size(block, static_cast<offset_type>(size));
+
+        offset_type remainder = next_block(block);
+        header(remainder).size_and_is_free = static_cast<offset_type>(remainder_size - sizeof(block_header)) | 1;
+        header(remainder).prev = block;
+
+        // a free block never ends the heap, so the remainder has a next block,
+        // and it is not free, because free neighbors are always fused
+        header(next_block(remainder)).prev = remainder;
+
+        link(remainder);
+      } // end if
+    } // end split_block()
+
+
+    __host__ __device__ inline void *extend_heap(size_t size)
+    {
+      // the offset of the new block must be representable
+      if(size >= null_offset() - program_break_offset()) return 0;
+
+      offset_type block = program_break_offset();
+
+      if(m_os.sbrk(sizeof(block_header) + size) == reinterpret_cast<void*>(-1))
+      {
+        return 0;
+      } // end if
+
+      header(block).size_and_is_free = static_cast<offset_type>(size);
+      header(block).prev = m_last_block;
+      m_last_block = block;
+
+      return data(block);
+    } // end extend_heap()
+}; // end size_class_allocator
+
+
+// a bump allocator whose allocate & deallocate are lock-free
+//
+// the offset of the next allocation & the number of live allocations share
+// one 64-bit word, so each operation is a single compare-and-swap. memory is
+// reclaimed all at once when the last live allocation is deallocated
+class concurrent_bump_arena
+{
+  public:
+    __host__ __device__ inline concurrent_bump_arena()
+      : m_begin(0),
+        m_capacity(0),
+        m_state(0)
+    {}
+
+
+    // not thread-safe
+    __host__ __device__ inline void reset(void *begin, unsigned int capacity)
+    {
+      m_begin = reinterpret_cast<char*>(begin);
+      m_state = 0;
+      atomic_store(&m_capacity, capacity);
+    } // end reset()
+
+
+    __host__ __device__ inline void *allocate(size_t size)
+    {
+      unsigned int capacity = atomic_load(&m_capacity);
+
+      size = size ? ((((size - 1) >> 3) << 3) + 8) : 8;
+
+      if(size > capacity) return 0;
+
+      unsigned long long old_state = atomic_load(&m_state);
+
+      while(true)
+      {
+        unsigned int top = offset(old_state);
+
+        if(size > capacity - top) return 0;
+
+        unsigned long long new_state = make_state(top + static_cast<unsigned int>(size), num_live(old_state) + 1);
+
+        unsigned long long observed = atomic_compare_and_swap(&m_state, old_state, new_state);
+
+        if(observed == old_state)
+        {
+          return m_begin + top;
+        } // end if
+
+        old_state = observed;
+      } // end while
+    } // end allocate()
+
+
+    __host__ __device__ inline void deallocate(void *)
+    {
+      unsigned long long old_state = atomic_load(&m_state);
+
+      while(true)
+      {
+        unsigned int live = num_live(old_state) - 1;
+
+        // the last deallocation rewinds the arena
+        unsigned long long new_state = make_state(live ? offset(old_state) : 0, live);
+
+        unsigned long long observed = atomic_compare_and_swap(&m_state, old_state, new_state);
+
+        if(observed == old_state) return;
+
+        old_state = observed;
+      } // end while
+    } // end deallocate()
 
+
+    __host__ __device__ inline bool owns(void *ptr) const
+    {
+      char *p = reinterpret_cast<char*>(ptr);
+      return m_begin <= p && p < m_begin + atomic_load(&m_capacity);
+    } // end owns()
+
+
+    __host__ __device__ inline void *begin() const
+    {
+      return m_begin;
+    } // end begin()
+
+
+    __host__ __device__ inline unsigned int capacity() const
+    {
+      return atomic_load(&m_capacity);
+    } // end capacity()
+
+
+    // the capacity may grow while agents allocate, but may shrink only
+    // to no less than size(), & only while no agent allocates
+    __host__ __device__ inline void set_capacity(unsigned int capacity)
+    {
+      atomic_store(&m_capacity, capacity);
+    } // end set_capacity()
+
+
+    // the bytes below the next allocation
+    __host__ __device__ inline unsigned int size() const
+    {
+      return offset(atomic_load(&m_state));
+    } // end size()
+
+
+    __host__ __device__ inline bool empty() const
+    {
+      return num_live(atomic_load(&m_state)) == 0;
+    } // end empty()
+
+
+  private:
+    __host__ __device__ inline static unsigned long long make_state(unsigned int offset, unsigned int num_live)
+    {
+      return (static_cast<unsigned long long>(num_live) << 32) | offset;
+    } // end make_state()
+
+
+    __host__ __device__ inline static unsigned int offset(unsigned long long state)
+    {
+      return static_cast<unsigned int>(state);
+    } // end offset()
+
+
+    __host__ __device__ inline static unsigned int num_live(unsigned long long state)
+    {
+      return static_cast<unsigned int>(state >> 32);
+    } // end num_live()
+
+
+    char *m_begin;
+    unsigned int m_capacity;
+    unsigned long long m_state;
+}; // end concurrent_bump_arena
+
+
+// the global memory which catches a launch's allocations once its groups' on-chip heaps are exhausted
+//
+// the launcher reserves one buffer of equal slices, one per group, each as large as the heap
+// the group requested beyond the heap it was granted. group i bump allocates from slice i,
+// so an allocation which overflows its on-chip heap needs neither the device's malloc nor
+// any synchronization with other groups
+class overflow_heap
+{
+  public:
+    static const size_t slice_alignment = 16;
+
+    // concurrent_bump_arena addresses its slice with 32-bit offsets
+    static const size_t max_slice_size = size_t(1) << 31;
+
+
+    __host__ __device__ inline overflow_heap()
+      : m_buffer(0),
+        m_slice_size(0)
+    {}
+
+
+    __host__ __device__ inline overflow_heap(void *buffer, size_t slice_size)
+      : m_buffer(reinterpret_cast<char*>(buffer)),
+        m_slice_size(buffer ? slice_size : 0)
+    {}
+
+
+    // the size of each group's slice, which is 0 when the request was granted in full
+    __host__ __device__ inline static size_t choose_slice_size(size_t requested_heap_size, size_t granted_heap_size)
+    {
+      if(requested_heap_size <= granted_heap_size) return 0;
+
+      size_t result = (requested_heap_size - granted_heap_size + slice_alignment - 1) / slice_alignment * slice_alignment;
+
+      return result < max_slice_size ? result : max_slice_size;
+    } // end choose_slice_size()
+
+
+    // the size of the buffer which holds num_groups slices
+    __host__ __device__ inline static size_t buffer_size(size_t slice_size, size_t num_groups)
+    {
+      return slice_size * num_groups;
+    } // end buffer_size()
+
+
+    // returns 0 when the heap has no buffer
+    __host__ __device__ inline void *slice(size_t group_index) const
+    {
+      return m_buffer ? m_buffer + group_index * m_slice_size : 0;
+    } // end slice()
+
+
+    __host__ __device__ inline size_t slice_size() const
+    {
+      return m_slice_size;
+    } // end slice_size()
+
+
+  private:
+    char *m_buffer;
+    size_t m_slice_size;
+}; // end overflow_heap
+
+
+// the allocator of a CTA's on-chip heap
+//
+// agents which allocate individually first bump through an arena carved from the heap,
+// which needs no lock, and otherwise serialize through a mutex around the heap.
+// the arena begins as a slab of 1/32 of the heap & grows by a slab at a time, up to 1/4
+// of the heap, while it ends the heap. the unsafe_ functions, which are used while the
+// group allocates collectively, go straight to the heap, give an empty arena back to it,
+// and take back the unused tail of the arena when the heap is otherwise exhausted
+//
+// the group's slice of its launch's overflow_heap, if any, is bump allocated
+// without a lock once the heap is exhausted
 class singleton_on_chip_allocator
 {
   public:
@@ -374,90 +1046,190 @@ class singleton_on_chip_allocator
     // XXX eliminate this WAR after CUDA 8 is released
     inline __device__ __host__
 #else
-    inline __device__
+    inline __host__ __device__
 #endif
-    singleton_on_chip_allocator(size_t max_data_segment_size)
+    singleton_on_chip_allocator(void *data_segment_begin, size_t max_data_segment_size, void *overflow_slice = 0, size_t overflow_slice_size = 0)
       : m_mutex(),
-        m_alloc(max_data_segment_size)
-    {}
+        m_arena(),
+        m_arena_slab_size(((max_data_segment_size / 32) >> 3) << 3),
+        m_max_arena_size(((max_data_segment_size / 4) >> 3) << 3),
+        m_alloc(data_segment_begin, max_data_segment_size),
+        m_overflow()
+    {
+      if(overflow_slice)
+      {
+        m_overflow.reset(overflow_slice, static_cast<unsigned int>(overflow_slice_size));
+      } // end if
+    }
 
 
-    inline __device__
+    inline __host__ __device__
     void *unsafe_allocate(size_t size)
     {
-      return m_alloc.allocate(size);
+      release_empty_arena();
+
+      void *result = m_alloc.allocate(size);
+
+      if(!result && trim_arena())
+      {
+        result = m_alloc.allocate(size);
+      } // end if
+
+      return result;
     }
 
 
-    inline __device__
+    inline __host__ __device__
     void *allocate(size_t size)
     {
-      void *result;
+      void *result = m_arena.allocate(size);
 
-      m_mutex.lock();
+      if(!result)
       {
-        result = unsafe_allocate(size);
-      } // end critical section
-      m_mutex.unlock();
+        m_mutex.lock();
+        {
+          if(m_arena.capacity() == 0)
+          {
+            carve_arena();
+          } // end if
+
+          // another agent may have carved or grown the arena since we tried it
+          result = m_arena.allocate(size);
+
+          if(!result && grow_arena(size))
+          {
+            result = m_arena.allocate(size);
+          } // end if
+
+          if(!result)
+          {
+            result = m_alloc.allocate(size);
+          } // end if
+        } // end critical section
+        m_mutex.unlock();
+      } // end if
 
       return result;
     } // end allocate()
 
 
-    inline __device__
+    inline __host__ __device__
     void unsafe_deallocate(void *ptr)
     {
-      m_alloc.deallocate(ptr);
+      if(m_arena.owns(ptr))
+      {
+        m_arena.deallocate(ptr);
+      } // end if
+      else
+      {
+        m_alloc.deallocate(ptr);
+      } // end else
     } // end unsafe_deallocate()
 
 
-    inline __device__
+    inline __host__ __device__
     void deallocate(void *ptr)
     {
+      if(m_arena.owns(ptr))
+      {
+        m_arena.deallocate(ptr);
+      } // end if
+      else
+      {
+        m_mutex.lock();
+        {
+          m_alloc.deallocate(ptr);
+        } // end critical section
+        m_mutex.unlock();
+      } // end else
+    } // end deallocate()
+
+
+    // returns 0 when the overflow slice is exhausted or absent
+    inline __host__ __device__
+    void *overflow_allocate(size_t size)
+    {
+      return m_overflow.allocate(size);
+    } // end overflow_allocate()
+
+
+    // returns false when ptr did not come from overflow_allocate()
+    inline __host__ __device__
+    bool overflow_deallocate(void *ptr)
+    {
+      if(m_overflow.owns(ptr))
+      {
+        m_overflow.deallocate(ptr);
+        return true;
+      } // end if
+
+      return false;
+    } // end overflow_deallocate()
+
+
+    inline __host__ __device__
+    size_t unsafe_heap_size() const
+    {
+      return m_alloc.heap_size();
+    } // end unsafe_heap_size()
+
+
+    // the program break moves under the mutex, so agents which allocate individually read it there
+    inline __host__ __device__
+    size_t heap_size()
+    {
+      size_t result;
+
       m_mutex.lock();
       {
-        unsafe_deallocate(ptr);
+        result = m_alloc.heap_size();
       } // end critical section
       m_mutex.unlock();
-    } // end deallocate()
+
+      return result;
+    } // end heap_size()
+
+
+    inline __host__ __device__
+    void unsafe_set_heap_limit(size_t limit)
+    {
+      m_alloc.set_heap_limit(limit);
+    } // end unsafe_set_heap_limit()
 
 
   private:
     class mutex
     {
       public:
-        inline __device__
+        inline __host__ __device__
         mutex()
           : m_in_use(0)
         {}
 
 
-        inline __device__
+        // returns true if the lock was acquired
+        inline __host__ __device__
         bool try_lock()
         {
-#if __CUDA_ARCH__ >= 110
-          return atomicCAS(&m_in_use, 0, 1) != 0;
-#else
-          return false;
-#endif
+          return atomic_compare_and_swap(&m_in_use, 0u, 1u) == 0;
         } // end try_lock()
 
 
-        inline __device__
+        inline __host__ __device__
         void lock()
         {
           // spin while waiting
-          while(try_lock())
+          while(!try_lock())
           {
             ;
           }
         } // end lock()
 
 
-        inline __device__
+        inline __host__ __device__
         void unlock()
         {
-          m_in_use = 0;
+          atomic_store(&m_in_use, 0u);
         } // end unlock()
 
 
@@ -466,8 +1238,81 @@ class singleton_on_chip_allocator
     }; // end mutex
 
 
+    // requires the lock
+    inline __host__ __device__
+    void carve_arena()
+    {
+      if(m_arena_slab_size == 0) return;
+
+      void *ptr = m_alloc.allocate(m_arena_slab_size);
+
+      if(ptr)
+      {
+        m_arena.reset(ptr, static_cast<unsigned int>(m_arena_slab_size));
+      } // end if
+    } // end carve_arena()
+
+
+    // grows the arena by enough slabs to fit an allocation of size bytes, when the arena ends the heap
+    // requires the lock
+    inline __host__ __device__
+    bool grow_arena(size_t size)
+    {
+      size_t capacity = m_arena.capacity();
+
+      if(capacity == 0) return false;
+
+      size_t num_slabs = (size + m_arena_slab_size - 1) / m_arena_slab_size;
+      size_t new_capacity = capacity + (num_slabs ? num_slabs : 1) * m_arena_slab_size;
+
+      if(new_capacity > m_max_arena_size || !m_alloc.extend(m_arena.begin(), new_capacity))
+      {
+        return false;
+      } // end if
+
+      m_arena.set_capacity(static_cast<unsigned int>(new_capacity));
+
+      return true;
+    } // end grow_arena()
+
+
+    // gives the arena's unused tail back to the heap
+    // requires that no agent allocates concurrently
+    inline __host__ __device__
+    bool trim_arena()
+    {
+      unsigned int size = m_arena.size();
+
+      if(m_arena.capacity() == 0 || !m_alloc.shrink(m_arena.begin(), size))
+      {
+        return false;
+      } // end if
+
+      m_arena.set_capacity(size);
+
+      return true;
+    } // end trim_arena()
+
+
+    // requires that no agent allocates concurrently
+    inline __host__ __device__
+    void release_empty_arena()
+    {
+      if(m_arena.capacity() > 0 && m_arena.empty())
+      {
+        void *ptr = m_arena.begin();
+        m_arena.reset(0, 0);
+        m_alloc.deallocate(ptr);
+      } // end if
+    } // end release_empty_arena()
+
+
     mutex m_mutex;
-    singleton_unsafe_on_chip_allocator m_alloc;
+    concurrent_bump_arena m_arena;
+    size_t m_arena_slab_size;
+    size_t m_max_arena_size;
+    size_class_allocator m_alloc;
+    concurrent_bump_arena m_overflow;
 }; // end singleton_on_chip_allocator
 
 
@@ -480,15 +1325,90 @@ __shared__  uninitialized<singleton_on_chip_allocator> s_on_chip_allocator;
 } // end anon namespace
 
 
-inline __device__ void init_on_chip_malloc(size_t max_data_segment_size)
+// the bytes of the on-chip heap below its program break
+inline __device__ size_t on_chip_heap_size()
+{
+  return s_on_chip_allocator.get().unsafe_heap_size();
+} // end on_chip_heap_size()
+
+
+// keeps the on-chip heap below limit bytes
+inline __device__ void set_on_chip_heap_limit(size_t limit)
+{
+  s_on_chip_allocator.get().unsafe_set_heap_limit(limit);
+} // end set_on_chip_heap_limit()
+
+
+#if defined(BULK_HEAP_INSTRUMENTATION)
+namespace
+{
+
+// one for the whole process, shared by every launch
+__device__ heap_statistics s_process_heap_statistics;
+
+} // end anon namespace
+#endif
+
+
+// counts an allocation of size bytes from the on-chip heap, after which bytes_in_use of it are in use
+inline __device__ void record_on_chip_allocation(size_t size, size_t bytes_in_use)
+{
+#if defined(BULK_HEAP_INSTRUMENTATION) && defined(__CUDA_ARCH__)
+  atomic_fetch_add(&s_process_heap_statistics.num_on_chip_allocations, 1ull);
+  atomic_fetch_add(&s_process_heap_statistics.num_on_chip_bytes, static_cast<unsigned long long>(size));
+  atomic_fetch_max(&s_process_heap_statistics.largest_allocation, static_cast<unsigned long long>(size));
+  atomic_fetch_max(&s_process_heap_statistics.high_water_mark, static_cast<unsigned long long>(bytes_in_use));
+#else
+  (void)size;
+  (void)bytes_in_use;
+#endif
+} // end record_on_chip_allocation()
+
+
+// counts an allocation of size bytes which fell back to the overflow heap
+inline __device__ void record_overflow_allocation(size_t size)
+{
+#if defined(BULK_HEAP_INSTRUMENTATION) && defined(__CUDA_ARCH__)
+  atomic_fetch_add(&s_process_heap_statistics.num_overflow_allocations, 1ull);
+  atomic_fetch_add(&s_process_heap_statistics.num_overflow_bytes, static_cast<unsigned long long>(size));
+  atomic_fetch_max(&s_process_heap_statistics.largest_allocation, static_cast<unsigned long long>(size));
+#else
+  (void)size;
+#endif
+} // end record_overflow_allocation()
+
+
+// counts an allocation of size bytes which fell back to the global heap
+inline __device__ void record_global_allocation(size_t size)
 {
-  s_on_chip_allocator.construct(max_data_segment_size);
+#if defined(BULK_HEAP_INSTRUMENTATION) && defined(__CUDA_ARCH__)
+  atomic_fetch_add(&s_process_heap_statistics.num_global_allocations, 1ull);
+  atomic_fetch_add(&s_process_heap_statistics.num_global_bytes, static_cast<unsigned long long>(size));
+  atomic_fetch_max(&s_process_heap_statistics.largest_allocation, static_cast<unsigned long long>(size));
+#else
+  (void)size;
+#endif
+} // end record_global_allocation()
+
+
+inline __device__ void init_on_chip_malloc(size_t max_data_segment_size, void *overflow_slice = 0, size_t overflow_slice_size = 0)
+{
+  s_on_chip_allocator.construct(static_cast<void*>(s_data_segment_begin), max_data_segment_size, overflow_slice, overflow_slice_size);
 } // end init_on_chip_malloc()
 
 
 inline __device__ void *on_chip_malloc(size_t size)
 {
   void *result = s_on_chip_allocator.get().allocate(size);
+
+#if defined(BULK_HEAP_INSTRUMENTATION)
+  if(result)
+  {
+    // other agents may be allocating, so read the heap's size under its lock
+    record_on_chip_allocation(size, s_on_chip_allocator.get().heap_size());
+  } // end if
+#endif
+
   return on_chip_cast(result);
 } // end on_chip_malloc()
 
@@ -502,6 +1422,12 @@ inline __device__ void on_chip_free(void *ptr)
 inline __device__ void *unsafe_on_chip_malloc(size_t size)
 {
   void *result = s_on_chip_allocator.get().unsafe_allocate(size);
+
+  if(result)
+  {
+    record_on_chip_allocation(size, on_chip_heap_size());
+  } // end if
+
   return on_chip_cast(result);
 } // end unsafe_on_chip_malloc()
 
@@ -512,6 +1438,26 @@ inline __device__ void unsafe_on_chip_free(void *ptr)
 } // end unsafe_on_chip_free()
 
 
+inline __device__ void *overflow_malloc(size_t size)
+{
+  void *result = s_on_chip_allocator.get().overflow_allocate(size);
+
+  if(result)
+  {
+    record_overflow_allocation(size);
+  } // end if
+
+  return result;
+} // end overflow_malloc()
+
+
+// returns false when ptr did not come from overflow_malloc()
+inline __device__ bool overflow_free(void *ptr)
+{
+  return s_on_chip_allocator.get().overflow_deallocate(ptr);
+} // end overflow_free()
+
+
 } // end detail
 
 
@@ -521,9 +1467,17 @@ inline __device__ void *shmalloc(size_t num_bytes)
   void *result = detail::on_chip_malloc(num_bytes);
   
 #if __CUDA_ARCH__ >= 200
+  if(!result)
+  {
+    // next try the group's slice of the overflow heap
+    result = detail::overflow_malloc(num_bytes);
+  } // end if
+
   if(!result)
   {
     result = std::malloc(num_bytes);
+
+    detail::record_global_allocation(num_bytes);
   } // end if
 #endif // __CUDA_ARCH__
 
@@ -537,9 +1491,17 @@ inline __device__ void *unsafe_shmalloc(size_t num_bytes)
   void *result = detail::unsafe_on_chip_malloc(num_bytes);
   
 #if __CUDA_ARCH__ >= 200
+  if(!result)
+  {
+    // next try the group's slice of the overflow heap
+    result = detail::overflow_malloc(num_bytes);
+  } // end if
+
   if(!result)
   {
     result = std::malloc(num_bytes);
+
+    detail::record_global_allocation(num_bytes);
   } // end if
 #endif // __CUDA_ARCH__
 
@@ -554,7 +1516,7 @@ inline __device__ void shfree(void *ptr)
   {
     bulk::detail::on_chip_free(bulk::on_chip_cast(ptr));
   } // end if
-  else
+  else if(!bulk::detail::overflow_free(ptr))
   {
     std::free(ptr);
   } // end else
@@ -571,7 +1533,7 @@ inline __device__ void unsafe_shfree(void *ptr)
   {
     bulk::detail::unsafe_on_chip_free(bulk::on_chip_cast(ptr));
   } // end if
-  else
+  else if(!bulk::detail::overflow_free(ptr))
   {
     std::free(ptr);
   } // end else
@@ -581,24 +1543,82 @@ inline __device__ void unsafe_shfree(void *ptr)
 } // end unsafe_shfree()
 
 
+namespace detail
+{
+
+
+// a subgroup's heap is a private slice of its block's data segment, which the on-chip allocator does not manage.
+// its first bytes broadcast the result of bulk::malloc to the subgroup's agents, and scoped_buffers are stacked
+// down from its end, so sibling subgroups never share a stack or a broadcast
+template<typename ConcurrentGroup>
+struct private_heap
+{
+  typedef typename ConcurrentGroup::size_type size_type;
+
+  // the broadcast occupies as many bytes as keep the stack aligned like the heap
+  static const size_type header_size = 16;
+
+  __host__ __device__
+  static void make(ConcurrentGroup &g, size_type offset, size_type size)
+  {
+    g.m_heap_offset = offset;
+    g.m_heap_size = size;
+  }
+
+  __host__ __device__
+  static bool exists(const ConcurrentGroup &g)
+  {
+    return g.m_heap_offset >= 0;
+  }
+
+  // the offset of the end of the slice in the data segment
+  __host__ __device__
+  static size_type end(const ConcurrentGroup &g)
+  {
+    return g.m_heap_offset + g.m_heap_size;
+  }
+
+  // the bytes of the slice available to scoped_buffers
+  __host__ __device__
+  static size_type stack_capacity(const ConcurrentGroup &g)
+  {
+    return g.m_heap_size - header_size;
+  }
+
+  __device__
+  static void **broadcast(const ConcurrentGroup &g)
+  {
+    return bulk::on_chip_cast(reinterpret_cast<void**>(reinterpret_cast<char*>(s_data_segment_begin) + g.m_heap_offset));
+  }
+}; // end private_heap
+
+
+} // end detail
+
+
 template<typename ConcurrentGroup>
 __device__
 inline void *malloc(ConcurrentGroup &g, size_t num_bytes)
 {
   __shared__ void *s_result;
 
-  // we need to guard access to s_result from other
+  // a subgroup's siblings call malloc at the same time, so each
+  // subgroup broadcasts through its private heap & allocates with the lock
+  bool is_subgroup = detail::private_heap<ConcurrentGroup>::exists(g);
+  void **result = is_subgroup ? detail::private_heap<ConcurrentGroup>::broadcast(g) : &s_result;
+
+  // we need to guard access to the result from other
   // invocations of malloc, so we put a wait at the beginning
   g.wait();
 
   if(g.this_exec.index() == 0)
   {
-    s_result = bulk::unsafe_shmalloc(num_bytes);
+    *result = is_subgroup ? bulk::shmalloc(num_bytes) : bulk::unsafe_shmalloc(num_bytes);
   } // end if
 
   g.wait();
 
-  return s_result;
+  return *result;
 } // end malloc()
 
 
@@ -608,13 +1628,42 @@ inline void free(ConcurrentGroup &g, void *ptr)
 {
   if(g.this_exec.index() == 0)
   {
-    bulk::unsafe_shfree(ptr);
+    if(detail::private_heap<ConcurrentGroup>::exists(g))
+    {
+      bulk::shfree(ptr);
+    } // end if
+    else
+    {
+      bulk::unsafe_shfree(ptr);
+    } // end else
   } // end if
 
   g.wait();
 } // end free()
 
 
+#if defined(BULK_HEAP_INSTRUMENTATION)
+// returns the heap use of every launch in the process since the last reset_process_heap_statistics()
+// the launches must be complete, e.g. after waiting on their futures
+inline heap_statistics read_process_heap_statistics()
+{
+  heap_statistics result;
+  bulk::detail::throw_on_error(cudaMemcpyFromSymbol(&result, bulk::detail::s_process_heap_statistics, sizeof(heap_statistics)),
+                               "read_process_heap_statistics(): after cudaMemcpyFromSymbol");
+  return result;
+} // end read_process_heap_statistics()
+
+
+// no launch may be in flight, or its heap use is partly counted
+inline void reset_process_heap_statistics()
+{
+  heap_statistics zero = heap_statistics();
+  bulk::detail::throw_on_error(cudaMemcpyToSymbol(bulk::detail::s_process_heap_statistics, &zero, sizeof(heap_statistics)),
+                               "reset_process_heap_statistics(): after cudaMemcpyToSymbol");
+} // end reset_process_heap_statistics()
+#endif // BULK_HEAP_INSTRUMENTATION
+
+
 } // end namespace bulk
 BULK_NAMESPACE_SUFFIX
 
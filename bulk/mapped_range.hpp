@@ -0,0 +1,304 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/device_ptr.h>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// mapped_range is POSIX-only, so bulk.hpp does not include it
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// an array of Ts backed by a memory-mapped binary file, like a column of a table
+//
+// the range's host iterators are pointers into the mapping, and its device iterators
+// point to the same pages, which are pinned & mapped into the device's address space
+// on first use, so algorithms launched with them read & write the file in place without
+// staging it in a vector. pinning faults in every page, so prefetch() the pages first
+//
+// the mapping is advised to be read sequentially, and prefetch() begins reading ahead
+// the pages of a decomposition's groups, rounded out to whole pages, so that a group's
+// first tile does not wait on the disk
+template<typename T>
+class mapped_range
+{
+  public:
+    typedef T                     value_type;
+    typedef T&                    reference;
+    typedef T*                    iterator;
+    typedef thrust::device_ptr<T> device_iterator;
+    typedef std::ptrdiff_t        size_type;
+
+    enum mode
+    {
+      // writes are not allowed
+      read_only,
+
+      // writes go to private copies of their pages and never reach the file
+      copy_on_write,
+
+      // writes reach the file, which is created if need be, and resized to hold n elements if n is given
+      read_write
+    };
+
+
+    // maps all of filename, or for read_write with n > 0, exactly n elements of it
+    // a read_write range of n == 0 elements keeps the file's length, so opening a file to modify it does not erase it
+    mapped_range(const char *filename, mode m = read_only, size_type n = 0)
+      : m_mode(m),
+        m_data(0),
+        m_size(0),
+        m_device_data(0)
+    {
+      int fd = ::open(filename, m == read_write ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+
+      if(fd < 0)
+      {
+        throw std::runtime_error(std::string("mapped_range: couldn't open ") + filename);
+      } // end if
+
+      std::size_t num_bytes = 0;
+
+      if(m == read_write && n > 0)
+      {
+        num_bytes = n * sizeof(T);
+
+        if(::ftruncate(fd, num_bytes) != 0)
+        {
+          ::close(fd);
+          throw std::runtime_error(std::string("mapped_range: couldn't resize ") + filename);
+        } // end if
+      } // end if
+      else
+      {
+        struct stat s;
+
+        if(::fstat(fd, &s) != 0)
+        {
+          ::close(fd);
+          throw std::runtime_error(std::string("mapped_range: couldn't stat ") + filename);
+        } // end if
+
+        // a trailing partial element is ignored
+        num_bytes = s.st_size / sizeof(T) * sizeof(T);
+      } // end else
+
+      m_size = num_bytes / sizeof(T);
+
+      if(num_bytes > 0)
+      {
+        int protection = m == read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+        int flags      = m == copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+
+        void *ptr = ::mmap(0, num_bytes, protection, flags, fd, 0);
+
+        if(ptr == MAP_FAILED)
+        {
+          ::close(fd);
+          throw std::runtime_error(std::string("mapped_range: couldn't map ") + filename);
+        } // end if
+
+        m_data = reinterpret_cast<T*>(ptr);
+
+        // the group algorithms stream through their inputs
+        ::madvise(ptr, num_bytes, MADV_SEQUENTIAL);
+      } // end if
+
+      // the mapping holds its own reference to the file
+      ::close(fd);
+    } // end mapped_range()
+
+
+    ~mapped_range()
+    {
+#if __BULK_HAS_CUDART__
+      if(m_device_data)
+      {
+        // errors are swallowed because destructors must not throw
+        cudaHostUnregister(m_data);
+      } // end if
+#endif
+
+      if(m_data)
+      {
+        ::munmap(m_data, m_size * sizeof(T));
+      } // end if
+    } // end ~mapped_range()
+
+
+    iterator begin() const
+    {
+      return m_data;
+    } // end begin()
+
+
+    iterator end() const
+    {
+      return m_data + m_size;
+    } // end end()
+
+
+    T *data() const
+    {
+      return m_data;
+    } // end data()
+
+
+    size_type size() const
+    {
+      return m_size;
+    } // end size()
+
+
+    bool empty() const
+    {
+      return m_size == 0;
+    } // end empty()
+
+
+    reference operator[](size_type i) const
+    {
+      return m_data[i];
+    } // end operator[]
+
+
+    mode get_mode() const
+    {
+      return m_mode;
+    } // end get_mode()
+
+
+    // the first time it is called, pins the mapping & maps it into the device's address space
+    device_iterator device_begin()
+    {
+      if(m_data && !m_device_data)
+      {
+        register_with_device();
+      } // end if
+
+      return device_iterator(m_device_data);
+    } // end device_begin()
+
+
+    device_iterator device_end()
+    {
+      return device_begin() + m_size;
+    } // end device_end()
+
+
+    // begins reading ahead the pages which hold the ranges of groups [first_group, last_group) of decomp
+    template<typename Decomposition>
+    void prefetch(const Decomposition &decomp, typename Decomposition::size_type first_group, typename Decomposition::size_type last_group) const
+    {
+      if(!m_data || first_group >= last_group) return;
+
+      std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+
+      std::size_t first_byte = decomp[first_group].first * sizeof(T);
+      std::size_t last_byte  = decomp[last_group - 1].second * sizeof(T);
+
+      // madvise requires a page-aligned address
+      first_byte = first_byte / page_size * page_size;
+      last_byte  = (last_byte + page_size - 1) / page_size * page_size;
+
+      std::size_t num_bytes = m_size * sizeof(T);
+      if(last_byte > num_bytes) last_byte = num_bytes;
+
+      if(first_byte < last_byte)
+      {
+        ::madvise(reinterpret_cast<char*>(m_data) + first_byte, last_byte - first_byte, MADV_WILLNEED);
+      } // end if
+    } // end prefetch()
+
+
+    // begins reading ahead the pages of every group of decomp
+    template<typename Decomposition>
+    void prefetch(const Decomposition &decomp) const
+    {
+      prefetch(decomp, 0, decomp.size());
+    } // end prefetch()
+
+
+    // for read_write ranges, writes modified pages back to the file before returning
+    void flush() const
+    {
+      if(m_data && m_mode == read_write)
+      {
+        ::msync(m_data, m_size * sizeof(T), MS_SYNC);
+      } // end if
+    } // end flush()
+
+
+  private:
+    // XXX delete these unless we find a need for them
+    mapped_range(const mapped_range &);
+    mapped_range &operator=(const mapped_range &);
+
+
+    void register_with_device()
+    {
+#if __BULK_HAS_CUDART__
+      unsigned int flags = cudaHostRegisterMapped;
+
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 11010)
+      // pages mapped without PROT_WRITE can only be pinned for reading
+      if(m_mode == read_only) flags |= cudaHostRegisterReadOnly;
+#  endif
+
+      bulk::detail::throw_on_error(cudaHostRegister(m_data, m_size * sizeof(T), flags),
+                                   "mapped_range::register_with_device(): after cudaHostRegister");
+
+      void *ptr = 0;
+      cudaError_t error = cudaHostGetDevicePointer(&ptr, m_data, 0);
+
+      if(error)
+      {
+        cudaHostUnregister(m_data);
+        bulk::detail::throw_on_error(error, "mapped_range::register_with_device(): after cudaHostGetDevicePointer");
+      } // end if
+
+      m_device_data = reinterpret_cast<T*>(ptr);
+#else
+      throw std::runtime_error("mapped_range::device_begin(): requires CUDART");
+#endif
+    } // end register_with_device()
+
+
+    mode m_mode;
+    T *m_data;
+    size_type m_size;
+    T *m_device_data;
+}; // end mapped_range
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
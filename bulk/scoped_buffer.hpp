@@ -0,0 +1,207 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// scoped_buffers are aligned to, and occupy a multiple of, this many bytes
+static const std::size_t scoped_buffer_alignment = 16;
+
+
+// the bytes of heap occupied by a scoped_buffer of num_bytes
+template<std::size_t num_bytes>
+struct scoped_buffer_footprint
+{
+  static const std::size_t value = (num_bytes + scoped_buffer_alignment - 1) / scoped_buffer_alignment * scoped_buffer_alignment;
+};
+
+
+} // end detail
+
+
+// an array of n Ts in a concurrent_group's heap which lives until the end of its scope
+//
+// scoped_buffers are stacked down from the end of the group's heap. each agent computes
+// the position of a new buffer from its own copy of the stack's size, so unlike
+// bulk::malloc & bulk::free, constructing & destroying a scoped_buffer does not wait.
+// if the stack would run into the heap, the buffer is allocated with bulk::malloc & freed with bulk::free instead.
+// a subgroup's buffers are stacked in its private slice of its block's heap.
+//
+// every agent of the group must construct & destroy the group's scoped_buffers together,
+// and the group must wait between the last access to a buffer and its destruction.
+// like bulk::malloc, a scoped_buffer may not be constructed while agents call shmalloc.
+// the elements are not constructed
+template<typename T>
+class scoped_buffer
+{
+  public:
+    typedef T   value_type;
+    typedef T*  iterator;
+    typedef int size_type;
+
+    template<typename ConcurrentGroup>
+    __device__
+    scoped_buffer(ConcurrentGroup &g, size_type n)
+      : m_size(n),
+        m_stack_size(&g.m_stack_size),
+        m_previous_stack_size(g.m_stack_size),
+        m_is_leader(g.this_exec.index() == 0),
+        m_in_private_heap(detail::private_heap<ConcurrentGroup>::exists(g))
+    {
+      const size_type alignment = detail::scoped_buffer_alignment;
+
+      // keep each buffer aligned like the beginning of the heap
+      size_type stack_end = m_in_private_heap ? detail::private_heap<ConcurrentGroup>::end(g) : g.heap_size() / alignment * alignment;
+      size_type new_stack_size = m_previous_stack_size + (n * sizeof(T) + alignment - 1) / alignment * alignment;
+
+      if(m_in_private_heap)
+      {
+        // nothing but the stack lives in a private heap
+        m_on_stack = new_stack_size <= detail::private_heap<ConcurrentGroup>::stack_capacity(g);
+      } // end if
+      else
+      {
+        // every agent reads the same program break, because the heap changes only between waits
+        m_on_stack = new_stack_size <= stack_end &&
+                     static_cast<size_t>(stack_end - new_stack_size) >= detail::on_chip_heap_size();
+      } // end else
+
+      if(m_on_stack)
+      {
+        *m_stack_size = new_stack_size;
+
+        if(!m_in_private_heap)
+        {
+          m_previous_heap_limit = m_previous_stack_size ? stack_end - m_previous_stack_size : g.heap_size();
+
+          // every agent stores the same limit
+          detail::set_on_chip_heap_limit(stack_end - new_stack_size);
+        } // end if
+
+        m_data = bulk::on_chip_cast(reinterpret_cast<T*>(reinterpret_cast<char*>(detail::s_data_segment_begin) + stack_end - new_stack_size));
+
+        if(m_is_leader)
+        {
+          detail::record_on_chip_allocation(n * sizeof(T), detail::on_chip_heap_size() + new_stack_size);
+        } // end if
+      } // end if
+      else
+      {
+        m_data = reinterpret_cast<T*>(bulk::malloc(g, n * sizeof(T)));
+
+        // remember the group, so that the destructor frees the buffer as the group's bulk::free would
+        m_group = &g;
+        m_free = &free_from<ConcurrentGroup>;
+      } // end else
+    } // end scoped_buffer()
+
+
+    __device__
+    ~scoped_buffer()
+    {
+      if(m_on_stack)
+      {
+        *m_stack_size = m_previous_stack_size;
+
+        if(!m_in_private_heap)
+        {
+          detail::set_on_chip_heap_limit(m_previous_heap_limit);
+        } // end if
+      } // end if
+      else
+      {
+        m_free(m_group, m_data);
+      } // end else
+    } // end ~scoped_buffer()
+
+
+    __device__
+    T *data() const
+    {
+      return m_data;
+    }
+
+
+    __device__
+    size_type size() const
+    {
+      return m_size;
+    }
+
+
+    __device__
+    iterator begin() const
+    {
+      return m_data;
+    }
+
+
+    __device__
+    iterator end() const
+    {
+      return m_data + m_size;
+    }
+
+
+    __device__
+    T &operator[](size_type i) const
+    {
+      return m_data[i];
+    }
+
+
+  private:
+    // XXX delete these unless we find a need for them
+    scoped_buffer(const scoped_buffer &);
+    scoped_buffer &operator=(const scoped_buffer &);
+
+    template<typename ConcurrentGroup>
+    __device__
+    static void free_from(void *g, void *ptr)
+    {
+      bulk::free(*static_cast<ConcurrentGroup*>(g), ptr);
+    } // end free_from()
+
+    T *m_data;
+    size_type m_size;
+    size_type *m_stack_size;
+    size_type m_previous_stack_size;
+    size_type m_previous_heap_limit;
+    bool m_is_leader;
+    bool m_in_private_heap;
+    bool m_on_stack;
+
+    // the group & its bulk::free, for a buffer which is not on the stack
+    void *m_group;
+    void (*m_free)(void *, void *);
+}; // end scoped_buffer
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
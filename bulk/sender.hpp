@@ -0,0 +1,382 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/stream_pool.hpp>
+
+// lazy descriptions of launches which may be composed before they are started
+//
+// a sender describes work to do on an execution group. nothing is launched until the
+// sender is started, at which point the whole chain is enqueued at once. each launch
+// waits on the event of its predecessor, so no link of the chain blocks the host:
+//
+//   bulk::future<void> f =
+//     bulk::start(
+//       bulk::then(
+//         bulk::when_all(
+//           bulk::then(bulk::schedule(bulk::grid()), reduce_kernel(), ...),
+//           bulk::then(bulk::schedule(bulk::par(n)), fill_kernel(), ...)
+//         ),
+//         scan_kernel(), ...
+//       )
+//     );
+//
+// senders hold their closures by value, so composing them does not allocate
+//
+// every sender S provides
+//
+//   typedef ... group_type;
+//   group_type group() const;
+//   future<void> submit(cudaEvent_t before) const; // enqueue the work after before
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// returns a future which becomes ready after both e1 and e2
+// either may be 0
+inline future<void> join_events(cudaEvent_t e1, cudaEvent_t e2)
+{
+  cudaError_t error = cudaSuccess;
+
+#if __BULK_HAS_CUDART__
+  cudaStream_t s = bulk::detail::stream_pool().acquire_stream();
+
+  if(e1 != 0) error = cudaStreamWaitEvent(s, e1, 0);
+  if(!error && e2 != 0) error = cudaStreamWaitEvent(s, e2, 0);
+#else
+  cudaStream_t s = 0;
+  bulk::detail::terminate_with_message("join_events(): cudaStreamWaitEvent requires CUDART");
+#endif
+
+  return future_core_access::create(s, true, error);
+} // end join_events()
+
+
+} // end detail
+
+
+// completes immediately on g
+template<typename ExecutionGroup>
+class schedule_sender
+{
+  public:
+    typedef ExecutionGroup group_type;
+
+    schedule_sender(group_type g)
+      : m_group(g)
+    {}
+
+    group_type group() const
+    {
+      return m_group;
+    }
+
+    future<void> submit(cudaEvent_t before) const
+    {
+      return detail::join_events(before, 0);
+    }
+
+  private:
+    group_type m_group;
+}; // end schedule_sender
+
+
+template<typename ExecutionGroup>
+schedule_sender<ExecutionGroup> schedule(ExecutionGroup g)
+{
+  return schedule_sender<ExecutionGroup>(g);
+} // end schedule()
+
+
+// launches a closure on its predecessor's group after its predecessor completes
+template<typename Predecessor, typename Closure>
+class bulk_sender
+{
+  public:
+    typedef typename Predecessor::group_type group_type;
+
+    bulk_sender(const Predecessor &predecessor, const Closure &c)
+      : m_predecessor(predecessor), m_closure(c)
+    {}
+
+    group_type group() const
+    {
+      return m_predecessor.group();
+    }
+
+    future<void> submit(cudaEvent_t before) const
+    {
+      future<void> predecessor = m_predecessor.submit(before);
+
+      // don't launch after a failed predecessor; pass its error along
+      cudaError_t error = detail::future_core_access::error(predecessor);
+      if(error)
+      {
+        return detail::future_core_access::create(0, false, error);
+      } // end if
+
+      return detail::async(async_launch<group_type>(group(), detail::future_core_access::event(predecessor)), m_closure);
+    }
+
+  private:
+    Predecessor m_predecessor;
+    Closure m_closure;
+}; // end bulk_sender
+
+
+// schedule_sender adds nothing but a group, so launch directly after before
+template<typename ExecutionGroup, typename Closure>
+class bulk_sender<schedule_sender<ExecutionGroup>, Closure>
+{
+  public:
+    typedef ExecutionGroup group_type;
+
+    bulk_sender(const schedule_sender<ExecutionGroup> &predecessor, const Closure &c)
+      : m_group(predecessor.group()), m_closure(c)
+    {}
+
+    group_type group() const
+    {
+      return m_group;
+    }
+
+    future<void> submit(cudaEvent_t before) const
+    {
+      return detail::async(async_launch<group_type>(m_group, before), m_closure);
+    }
+
+  private:
+    group_type m_group;
+    Closure m_closure;
+}; // end bulk_sender
+
+
+// completes on g after its predecessor completes
+template<typename Predecessor, typename ExecutionGroup>
+class transfer_sender
+{
+  public:
+    typedef ExecutionGroup group_type;
+
+    transfer_sender(const Predecessor &predecessor, group_type g)
+      : m_predecessor(predecessor), m_group(g)
+    {}
+
+    group_type group() const
+    {
+      return m_group;
+    }
+
+    future<void> submit(cudaEvent_t before) const
+    {
+      return m_predecessor.submit(before);
+    }
+
+  private:
+    Predecessor m_predecessor;
+    group_type m_group;
+}; // end transfer_sender
+
+
+template<typename Sender, typename ExecutionGroup>
+transfer_sender<Sender,ExecutionGroup> transfer(const Sender &s, ExecutionGroup g)
+{
+  return transfer_sender<Sender,ExecutionGroup>(s, g);
+} // end transfer()
+
+
+// starts both of its predecessors concurrently and completes once both have
+// completes on the group of the first
+template<typename Sender1, typename Sender2>
+class when_all_sender
+{
+  public:
+    typedef typename Sender1::group_type group_type;
+
+    when_all_sender(const Sender1 &s1, const Sender2 &s2)
+      : m_sender1(s1), m_sender2(s2)
+    {}
+
+    group_type group() const
+    {
+      return m_sender1.group();
+    }
+
+    future<void> submit(cudaEvent_t before) const
+    {
+      future<void> f1 = m_sender1.submit(before);
+      future<void> f2 = m_sender2.submit(before);
+
+      cudaError_t error = detail::future_core_access::error(f1);
+      if(!error) error = detail::future_core_access::error(f2);
+
+      if(error)
+      {
+        return detail::future_core_access::create(0, false, error);
+      } // end if
+
+      return detail::join_events(detail::future_core_access::event(f1), detail::future_core_access::event(f2));
+    }
+
+  private:
+    Sender1 m_sender1;
+    Sender2 m_sender2;
+}; // end when_all_sender
+
+
+template<typename Sender1, typename Sender2>
+when_all_sender<Sender1,Sender2> when_all(const Sender1 &s1, const Sender2 &s2)
+{
+  return when_all_sender<Sender1,Sender2>(s1, s2);
+} // end when_all()
+
+
+template<typename Sender1, typename Sender2, typename Sender3>
+when_all_sender<when_all_sender<Sender1,Sender2>,Sender3> when_all(const Sender1 &s1, const Sender2 &s2, const Sender3 &s3)
+{
+  return bulk::when_all(bulk::when_all(s1, s2), s3);
+} // end when_all()
+
+
+// enqueues all of s's work without blocking
+template<typename Sender>
+future<void> start(const Sender &s)
+{
+  return s.submit(0);
+} // end start()
+
+
+// enqueues all of s's work and waits for it to complete
+template<typename Sender>
+void sync_wait(const Sender &s)
+{
+  bulk::start(s).wait();
+} // end sync_wait()
+
+
+template<typename Sender, typename Function>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<> > >
+  then(const Sender &s, Function f)
+{
+  typedef detail::closure<Function, thrust::tuple<> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1> > >
+  then(const Sender &s, Function f, Arg1 arg1)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8,Arg9> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8,Arg9> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9));
+} // end then()
+
+
+template<typename Sender, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+bulk_sender<Sender, detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8,Arg9,Arg10> > >
+  then(const Sender &s, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10)
+{
+  typedef detail::closure<Function, thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8,Arg9,Arg10> > closure_type;
+  return bulk_sender<Sender, closure_type>(s, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9,arg10));
+} // end then()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,226 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/tuple_meta_transform.hpp>
+#include <thrust/device_ptr.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/tuple.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+template<typename T>
+struct soa_field_pointer
+{
+  typedef thrust::device_ptr<T> type;
+};
+
+
+template<typename T>
+struct soa_const_field_pointer
+{
+  typedef thrust::device_ptr<const T> type;
+};
+
+
+// each field begins on a boundary this large, so that copies of whole fields can be vectorized
+const std::size_t soa_field_alignment = 256;
+
+
+inline std::size_t soa_field_bytes(std::size_t n, std::size_t element_size)
+{
+  std::size_t num_bytes = n * element_size;
+
+  return (num_bytes + soa_field_alignment - 1) / soa_field_alignment * soa_field_alignment;
+} // end soa_field_bytes()
+
+
+// lays out the fields [i, size) of the tuple of element types Tuple one after another in a single allocation
+template<typename Tuple,
+         unsigned int i = 0,
+         unsigned int size = thrust::tuple_size<Tuple>::value>
+struct soa_layout
+{
+  typedef typename thrust::tuple_element<i,Tuple>::type field_type;
+
+  static std::size_t num_bytes(std::size_t n)
+  {
+    return soa_field_bytes(n, sizeof(field_type)) + soa_layout<Tuple,i+1,size>::num_bytes(n);
+  } // end num_bytes()
+
+  template<typename PointerTuple>
+  static void point_to_fields(char *storage, std::size_t n, PointerTuple &fields)
+  {
+    typedef typename thrust::tuple_element<i,PointerTuple>::type pointer;
+
+    thrust::get<i>(fields) = pointer(reinterpret_cast<field_type*>(storage));
+
+    soa_layout<Tuple,i+1,size>::point_to_fields(storage + soa_field_bytes(n, sizeof(field_type)), n, fields);
+  } // end point_to_fields()
+}; // end soa_layout
+
+
+template<typename Tuple, unsigned int size>
+struct soa_layout<Tuple,size,size>
+{
+  static std::size_t num_bytes(std::size_t)
+  {
+    return 0;
+  } // end num_bytes()
+
+  template<typename PointerTuple>
+  static void point_to_fields(char *, std::size_t, PointerTuple &)
+  {
+  } // end point_to_fields()
+}; // end soa_layout
+
+
+} // end detail
+
+
+// a fixed-size array of records in device memory, stored as a structure of arrays:
+// field k of every record is stored contiguously, in an array of Tk
+//
+// the vector's iterator is a zip_iterator of the fields' device_ptrs, so each element is a tuple
+// of references. bulk::copy_n recognizes a pair of such iterators & copies each field with
+// contiguous, vectorized loads & stores rather than assigning a tuple per element. the fields
+// share a single allocation & each begins on a 256B boundary
+template<typename T0,
+         typename T1 = thrust::null_type,
+         typename T2 = thrust::null_type,
+         typename T3 = thrust::null_type,
+         typename T4 = thrust::null_type,
+         typename T5 = thrust::null_type,
+         typename T6 = thrust::null_type,
+         typename T7 = thrust::null_type,
+         typename T8 = thrust::null_type,
+         typename T9 = thrust::null_type>
+class soa_vector
+{
+  public:
+    typedef thrust::tuple<T0,T1,T2,T3,T4,T5,T6,T7,T8,T9> value_type;
+    typedef std::size_t                                  size_type;
+
+    typedef typename detail::tuple_meta_transform<value_type,detail::soa_field_pointer>::type       pointer_tuple;
+    typedef typename detail::tuple_meta_transform<value_type,detail::soa_const_field_pointer>::type const_pointer_tuple;
+
+    typedef thrust::zip_iterator<pointer_tuple>       iterator;
+    typedef thrust::zip_iterator<const_pointer_tuple> const_iterator;
+
+
+    // allocates uninitialized storage for n records
+    explicit soa_vector(size_type n)
+      : m_storage(0),
+        m_size(n)
+    {
+      if(n > 0)
+      {
+        void *ptr = 0;
+        bulk::detail::throw_on_error(cudaMalloc(&ptr, layout::num_bytes(n)), "soa_vector(): after cudaMalloc");
+
+        m_storage = reinterpret_cast<char*>(ptr);
+      } // end if
+    } // end soa_vector()
+
+
+    ~soa_vector()
+    {
+      if(m_storage)
+      {
+        // errors are swallowed because destructors must not throw
+        cudaFree(m_storage);
+      } // end if
+    } // end ~soa_vector()
+
+
+    size_type size() const
+    {
+      return m_size;
+    } // end size()
+
+
+    bool empty() const
+    {
+      return m_size == 0;
+    } // end empty()
+
+
+    // the beginning of each field
+    pointer_tuple fields()
+    {
+      pointer_tuple result;
+      layout::point_to_fields(m_storage, m_size, result);
+      return result;
+    } // end fields()
+
+
+    const_pointer_tuple fields() const
+    {
+      const_pointer_tuple result;
+      layout::point_to_fields(m_storage, m_size, result);
+      return result;
+    } // end fields()
+
+
+    iterator begin()
+    {
+      return iterator(fields());
+    } // end begin()
+
+
+    iterator end()
+    {
+      return begin() + m_size;
+    } // end end()
+
+
+    const_iterator begin() const
+    {
+      return const_iterator(fields());
+    } // end begin()
+
+
+    const_iterator end() const
+    {
+      return begin() + m_size;
+    } // end end()
+
+  private:
+    typedef detail::soa_layout<value_type> layout;
+
+    // XXX delete these unless we find a need for them
+    soa_vector(const soa_vector &);
+    soa_vector &operator=(const soa_vector &);
+
+    char *m_storage;
+    size_type m_size;
+};
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
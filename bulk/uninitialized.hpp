@@ -181,8 +181,53 @@ template<typename T>
 };
 
 
+// the layouts of an uninitialized_array's elements
+//
+// contiguous_layout packs the elements like a built-in array
+struct contiguous_layout {};
+
+
+// padded_layout gives each element cache lines of its own, so that agents on different
+// cores which each write their own element, like the partial sums of a reduction, do not
+// pass a line back & forth between them. the elements are not contiguous, so an array
+// with this layout provides element access but no data() or iterators
+template<std::size_t line_size = 64>
+struct padded_layout {};
+
+
+// the execution spaces whose agents an array of slots may serve
+struct host_space {};
+struct device_space {};
+
+
+// the layout of an array of one element per agent or group of an ExecutionSpace, which is padded
+// on the host, whose cores contend for shared lines, and contiguous on the device, where the
+// neighboring accesses of a group's threads coalesce
+//
+// the space is named explicitly, rather than chosen by __CUDA_ARCH__, so that an array's size &
+// its elements' offsets agree between the host & device compilation passes, which matters
+// whenever the array is a member of a __host__ __device__ type or of a kernel's parameters
+template<typename ExecutionSpace> struct slot_layout;
+
+template<>
+struct slot_layout<host_space>
+{
+  typedef padded_layout<> type;
+};
+
+template<>
+struct slot_layout<device_space>
+{
+  typedef contiguous_layout type;
+};
+
+
+template<typename T, std::size_t N, typename Layout = contiguous_layout>
+  class uninitialized_array;
+
+
 template<typename T, std::size_t N>
-  class uninitialized_array
+  class uninitialized_array<T,N,contiguous_layout>
 {
   public:
     typedef T             value_type; 
@@ -296,6 +341,77 @@ template<typename T, std::size_t N>
 };
 
 
+template<typename T, std::size_t N, std::size_t line_size>
+  class uninitialized_array<T,N,padded_layout<line_size> >
+{
+  public:
+    typedef T             value_type; 
+    typedef T&            reference;
+    typedef const T&      const_reference;
+    typedef std::size_t   size_type;
+
+    // the distance in bytes between consecutive elements
+    static const size_type stride = (sizeof(T) + line_size - 1) / line_size * line_size;
+
+    __thrust_forceinline__ __host__ __device__
+    size_type size() const
+    {
+      return N;
+    }
+
+    __thrust_forceinline__ __host__ __device__
+    bool empty() const
+    {
+      return false;
+    }
+
+    // element access
+    __thrust_forceinline__ __host__ __device__
+    reference operator[](size_type n)
+    {
+      void *result = storage.data + n * stride;
+      return *reinterpret_cast<T*>(result);
+    }
+
+    __thrust_forceinline__ __host__ __device__
+    const_reference operator[](size_type n) const
+    {
+      const void *result = storage.data + n * stride;
+      return *reinterpret_cast<const T*>(result);
+    }
+
+    __thrust_forceinline__ __host__ __device__
+    reference front()
+    {
+      return (*this)[0];
+    }
+
+    __thrust_forceinline__ __host__ __device__
+    const_reference front() const
+    {
+      return (*this)[0];
+    }
+
+    __thrust_forceinline__ __host__ __device__
+    reference back()
+    {
+      return (*this)[size() - size_type(1)];
+    }
+
+    __thrust_forceinline__ __host__ __device__
+    const_reference back() const
+    {
+      return (*this)[size() - size_type(1)];
+    }
+
+  private:
+    typename bulk::detail::aligned_storage<
+      N * stride,
+      line_size
+    >::type storage;
+};
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
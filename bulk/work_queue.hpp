@@ -0,0 +1,444 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/atomic.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <bulk/malloc.hpp>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// work_queue is a bounded multi-producer/multi-consumer queue whose storage
+// lives in a concurrent_group's heap.
+//
+// agents reserve slots for a batch of items with a single atomic operation.
+// pushes which do not fit in the queue's on-chip storage spill into an optional
+// overflow ring in global memory, much like shmalloc falls back to std::malloc.
+//
+// each slot carries a sequence number which says whether its item has been published
+// by its producer or released by its consumer, as in Vyukov's bounded MPMC queue.
+// a pop only reserves slots whose pushes have been published and a push only reserves
+// slots whose pops have finished reading, so pushes and pops may be freely mixed, and
+// the queue may also be shared between host threads when its storage is provided by
+// the caller. a push or pop which finds a slot still in flight reserves fewer items
+// rather than waiting for it, so neither ever blocks.
+//
+// drain() consumes a snapshot of the queue between two g.wait()s and allows the
+// consumed items to push new work, but no agent may pop concurrently with it.
+//
+// a released slot's sequence number is its position plus the capacity, which must differ from
+// a published slot's position plus one, so each ring's capacity must be at least 2
+//
+// XXX positions wrap at 2^32, so capacities should be powers of two
+template<typename T>
+class work_queue
+{
+  public:
+    typedef T            value_type;
+    typedef unsigned int size_type;
+
+    __host__ __device__
+    work_queue()
+      : m_state(0),
+        m_sequence(0),
+        m_items(0),
+        m_capacity(0),
+        m_overflow_sequence(0),
+        m_overflow(0),
+        m_overflow_capacity(0)
+    {}
+
+    // storage must point to at least storage_size(capacity) bytes
+    // overflow_storage, if any, must point to at least overflow_storage_size(overflow_capacity) bytes
+    // the queue is empty only after clear()
+    __host__ __device__
+    work_queue(void *storage, size_type capacity, void *overflow_storage = 0, size_type overflow_capacity = 0)
+      : m_state(reinterpret_cast<state*>(storage)),
+        m_sequence(reinterpret_cast<size_type*>(reinterpret_cast<char*>(storage) + sizeof(state))),
+        m_items(reinterpret_cast<T*>(reinterpret_cast<char*>(storage) + items_offset(sizeof(state), capacity))),
+        m_capacity(capacity),
+        m_overflow_sequence(reinterpret_cast<size_type*>(overflow_storage)),
+        m_overflow(overflow_storage ? reinterpret_cast<T*>(reinterpret_cast<char*>(overflow_storage) + items_offset(0, overflow_capacity)) : 0),
+        m_overflow_capacity(overflow_storage ? overflow_capacity : 0)
+    {}
+
+    __host__ __device__
+    static std::size_t storage_size(size_type capacity)
+    {
+      return items_offset(sizeof(state), capacity) + capacity * sizeof(T);
+    } // end storage_size()
+
+    __host__ __device__
+    static std::size_t overflow_storage_size(size_type overflow_capacity)
+    {
+      return items_offset(0, overflow_capacity) + overflow_capacity * sizeof(T);
+    } // end overflow_storage_size()
+
+    __host__ __device__
+    void *storage() const
+    {
+      return m_state;
+    } // end storage()
+
+    __host__ __device__
+    size_type capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+    // empties the queue
+    // only a single agent should call clear()
+    __host__ __device__
+    void clear()
+    {
+      clear_sequences(0, 1);
+      clear_state();
+    } // end clear()
+
+    // empties the queue
+    // every agent of g must participate
+    template<typename ConcurrentGroup>
+    __device__
+    void clear(ConcurrentGroup &g)
+    {
+      clear_sequences(g.this_exec.index(), g.size());
+
+      if(g.this_exec.index() == 0)
+      {
+        clear_state();
+      } // end if
+
+      g.wait();
+    } // end clear()
+
+    // counts items which are reserved but not yet published or released
+    __host__ __device__
+    size_type size() const
+    {
+      return (bulk::detail::atomic_load(&m_state->tail)          - bulk::detail::atomic_load(&m_state->head)) +
+             (bulk::detail::atomic_load(&m_state->overflow_tail) - bulk::detail::atomic_load(&m_state->overflow_head));
+    } // end size()
+
+    // the number of items which have spilled into the overflow ring
+    __host__ __device__
+    size_type overflow_size() const
+    {
+      return bulk::detail::atomic_load(&m_state->overflow_tail) - bulk::detail::atomic_load(&m_state->overflow_head);
+    } // end overflow_size()
+
+    __host__ __device__
+    bool push(const T &x)
+    {
+      return push_n(&x, 1) == 1;
+    } // end push()
+
+    // returns the number of items actually pushed, which is less than n
+    // only when both the queue and its overflow ring are full
+    template<typename InputIterator>
+    __host__ __device__
+    size_type push_n(InputIterator first, size_type n)
+    {
+      size_type idx = 0;
+
+      // reserve a batch of on-chip slots with a single atomic
+      size_type num_reserved = reserve(&m_state->tail, m_sequence, m_capacity, 0, n, idx);
+
+      for(size_type i = 0; i < num_reserved; ++i, ++first)
+      {
+        m_items[(idx + i) % m_capacity] = *first;
+      } // end for
+
+      publish(m_sequence, m_capacity, idx, num_reserved, 1);
+
+      size_type result = num_reserved;
+
+      if(result < n && m_overflow_capacity > 0)
+      {
+        // spill the rest into global memory
+        num_reserved = reserve(&m_state->overflow_tail, m_overflow_sequence, m_overflow_capacity, 0, n - result, idx);
+
+        for(size_type i = 0; i < num_reserved; ++i, ++first)
+        {
+          m_overflow[(idx + i) % m_overflow_capacity] = *first;
+        } // end for
+
+        publish(m_overflow_sequence, m_overflow_capacity, idx, num_reserved, 1);
+
+        result += num_reserved;
+      } // end if
+
+      return result;
+    } // end push_n()
+
+    __host__ __device__
+    bool pop(T &x)
+    {
+      return pop_n(&x, 1) == 1;
+    } // end pop()
+
+    // returns the number of items actually popped
+    template<typename OutputIterator>
+    __host__ __device__
+    size_type pop_n(OutputIterator result, size_type n)
+    {
+      size_type idx = 0;
+
+      size_type num_reserved = reserve(&m_state->head, m_sequence, m_capacity, 1, n, idx);
+
+      for(size_type i = 0; i < num_reserved; ++i, ++result)
+      {
+        *result = m_items[(idx + i) % m_capacity];
+      } // end for
+
+      // hand the slots back to producers for the next lap
+      publish(m_sequence, m_capacity, idx, num_reserved, m_capacity);
+
+      size_type num_popped = num_reserved;
+
+      if(num_popped < n && m_overflow_capacity > 0)
+      {
+        num_reserved = reserve(&m_state->overflow_head, m_overflow_sequence, m_overflow_capacity, 1, n - num_popped, idx);
+
+        for(size_type i = 0; i < num_reserved; ++i, ++result)
+        {
+          *result = m_overflow[(idx + i) % m_overflow_capacity];
+        } // end for
+
+        publish(m_overflow_sequence, m_overflow_capacity, idx, num_reserved, m_overflow_capacity);
+
+        num_popped += num_reserved;
+      } // end if
+
+      return num_popped;
+    } // end pop_n()
+
+    // cooperatively consumes every item in the queue at the time of the call
+    // each agent of g invokes f on a strided subset of the items
+    // f may push new items to the queue, but they will not be consumed until the next drain()
+    // returns the number of items consumed
+    template<typename ConcurrentGroup, typename Function>
+    __device__
+    size_type drain(ConcurrentGroup &g, Function f)
+    {
+      // wait for pending pushes to land
+      g.wait();
+
+      size_type first          = m_state->head;
+      size_type n              = m_state->tail - first;
+      size_type overflow_first = m_state->overflow_head;
+      size_type overflow_n     = m_state->overflow_tail - overflow_first;
+
+      // every agent must observe the same snapshot before f is allowed to push
+      g.wait();
+
+      for(size_type i = g.this_exec.index(); i < n; i += g.size())
+      {
+        T x = m_items[(first + i) % m_capacity];
+        f(x);
+      } // end for
+
+      for(size_type i = g.this_exec.index(); i < overflow_n; i += g.size())
+      {
+        T x = m_overflow[(overflow_first + i) % m_overflow_capacity];
+        f(x);
+      } // end for
+
+      g.wait();
+
+      // release the consumed slots
+      bulk::detail::atomic_thread_fence();
+
+      for(size_type i = g.this_exec.index(); i < n; i += g.size())
+      {
+        store_sequence(m_sequence, m_capacity, first + i, first + i + m_capacity);
+      } // end for
+
+      for(size_type i = g.this_exec.index(); i < overflow_n; i += g.size())
+      {
+        store_sequence(m_overflow_sequence, m_overflow_capacity, overflow_first + i, overflow_first + i + m_overflow_capacity);
+      } // end for
+
+      if(g.this_exec.index() == 0)
+      {
+        m_state->head          = first + n;
+        m_state->overflow_head = overflow_first + overflow_n;
+      } // end if
+
+      g.wait();
+
+      return n + overflow_n;
+    } // end drain()
+
+  private:
+    struct state
+    {
+      size_type head;
+      size_type tail;
+      size_type overflow_head;
+      size_type overflow_tail;
+    };
+
+    // a ring's items follow its capacity sequence numbers, which follow a header of header_size bytes
+    __host__ __device__
+    static std::size_t items_offset(std::size_t header_size, size_type capacity)
+    {
+      const std::size_t alignment = bulk::detail::alignment_of<T>::value;
+      std::size_t offset = header_size + capacity * sizeof(size_type);
+      return ((offset + alignment - 1) / alignment) * alignment;
+    } // end items_offset()
+
+    __host__ __device__
+    void clear_state()
+    {
+      m_state->head          = 0;
+      m_state->tail          = 0;
+      m_state->overflow_head = 0;
+      m_state->overflow_tail = 0;
+    } // end clear_state()
+
+    // slot i begins free for the push at position i
+    __host__ __device__
+    void clear_sequences(size_type first, size_type stride)
+    {
+      for(size_type i = first; i < m_capacity; i += stride)
+      {
+        m_sequence[i] = i;
+      } // end for
+
+      for(size_type i = first; i < m_overflow_capacity; i += stride)
+      {
+        m_overflow_sequence[i] = i;
+      } // end for
+    } // end clear_sequences()
+
+    __host__ __device__
+    static void store_sequence(size_type *sequence, size_type capacity, size_type position, size_type value)
+    {
+      *const_cast<volatile size_type*>(&sequence[position % capacity]) = value;
+    } // end store_sequence()
+
+    // after accessing the items at positions [first, first + n), marks each slot with its position plus offset:
+    // 1 publishes a pushed item to pops, and capacity releases a popped slot to the pushes of the next lap
+    __host__ __device__
+    static void publish(size_type *sequence, size_type capacity, size_type first, size_type n, size_type offset)
+    {
+      if(n == 0) return;
+
+      // the items must land before their sequence numbers
+      bulk::detail::atomic_thread_fence();
+
+      for(size_type i = 0; i < n; ++i)
+      {
+        store_sequence(sequence, capacity, first + i, first + i + offset);
+      } // end for
+    } // end publish()
+
+    // reserves up to n slots beginning at *position, which is a ring's tail for pushes (offset 0)
+    // or its head for pops (offset 1). only the leading slots whose sequence numbers equal their
+    // positions plus offset are ready, so the reservation stops at the first slot still in flight
+    // returns the number of slots reserved, the first of which is returned through first
+    __host__ __device__
+    static size_type reserve(size_type *position, const size_type *sequence, size_type capacity, size_type offset, size_type n, size_type &first)
+    {
+      size_type old_position = bulk::detail::atomic_load(position);
+
+      while(true)
+      {
+        size_type k = 0;
+
+        while(k < thrust::min<size_type>(n, capacity) &&
+              *const_cast<const volatile size_type*>(&sequence[(old_position + k) % capacity]) == old_position + k + offset)
+        {
+          ++k;
+        } // end while
+
+        // accesses to the items must not begin before their sequence numbers are observed
+        bulk::detail::atomic_thread_fence();
+
+        if(k == 0)
+        {
+          // either the ring is empty (full, for pushes) or another agent has moved *position since we read it
+          size_type current = bulk::detail::atomic_load(position);
+
+          if(current == old_position) return 0;
+
+          old_position = current;
+          continue;
+        } // end if
+
+        size_type prev = bulk::detail::atomic_compare_and_swap(position, old_position, old_position + k);
+
+        if(prev == old_position)
+        {
+          first = old_position;
+          return k;
+        } // end if
+
+        old_position = prev;
+      } // end while
+    } // end reserve()
+
+    state     *m_state;
+    size_type *m_sequence;
+    T         *m_items;
+    size_type  m_capacity;
+    size_type *m_overflow_sequence;
+    T         *m_overflow;
+    size_type  m_overflow_capacity;
+}; // end work_queue
+
+
+// creates an empty work_queue in g's heap whose pushes spill into overflow_storage,
+// which must point to at least work_queue<T>::overflow_storage_size(overflow_capacity) bytes
+// every agent of g must participate
+template<typename T, typename ConcurrentGroup>
+__device__
+work_queue<T> make_work_queue(ConcurrentGroup &g,
+                              typename work_queue<T>::size_type capacity,
+                              void *overflow_storage = 0,
+                              typename work_queue<T>::size_type overflow_capacity = 0)
+{
+  void *storage = bulk::malloc(g, work_queue<T>::storage_size(capacity));
+
+  work_queue<T> result(storage, capacity, overflow_storage, overflow_capacity);
+
+  result.clear(g);
+
+  return result;
+} // end make_work_queue()
+
+
+// returns q's storage to g's heap
+// every agent of g must participate
+template<typename ConcurrentGroup, typename T>
+__device__
+void free(ConcurrentGroup &g, work_queue<T> &q)
+{
+  bulk::free(g, q.storage());
+} // end free()
+
+
+} // end namespace bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <cuda_runtime_api.h>
+#include <thrust/device_ptr.h>
+#include <thrust/device_reference.h>
+
+
+// allocates device memory directly from the CUDA runtime
+//
+// cuda_allocator & caching_allocator satisfy the contract thrust::cuda::par(alloc)
+// expects of an allocator of temporary storage, so the drivers pass them to thrust
+// algorithms as well as to temporary_buffer
+class cuda_allocator
+{
+  public:
+    typedef char value_type;
+
+    char *allocate(std::ptrdiff_t num_bytes)
+    {
+      void *result = 0;
+
+      if(cudaMalloc(&result, num_bytes) != cudaSuccess)
+      {
+        // clear the error
+        cudaGetLastError();
+
+        throw std::bad_alloc();
+      }
+
+      return reinterpret_cast<char*>(result);
+    }
+
+    void deallocate(char *ptr, std::size_t)
+    {
+      cudaFree(ptr);
+    }
+};
+
+
+struct caching_allocator_statistics
+{
+  // allocations served from a free list
+  std::size_t num_cache_hits;
+
+  // allocations & deallocations which went to the upstream allocator
+  std::size_t num_upstream_allocations;
+  std::size_t num_upstream_deallocations;
+
+  // bytes held in free lists & bytes handed out, counted in whole bins
+  std::size_t bytes_cached;
+  std::size_t bytes_in_use;
+};
+
+
+// keeps deallocated blocks in free lists binned by power-of-two size & reuses them, so a
+// driver called repeatedly with the same problem size makes no upstream allocations after
+// its first call
+//
+// at most max_cached_bytes are kept; a block which would exceed the cap is returned upstream
+//
+// a reused block may still be in use by kernels launched before its deallocation on the streams
+// bulk::async creates. those are blocking streams, so reusing a block records an event on the
+// legacy default stream, which orders all work launched afterwards behind that earlier work.
+// work on non-blocking streams is not ordered this way
+//
+// caching_allocator is not thread safe
+template<typename Upstream = cuda_allocator>
+class caching_allocator
+{
+  public:
+    typedef char value_type;
+
+    // 256B is cudaMalloc's alignment, so smaller blocks gain nothing
+    static const std::size_t min_bin = 8;
+    static const std::size_t num_bins = 8 * sizeof(std::size_t);
+
+    caching_allocator(std::size_t max_cached_bytes = std::size_t(1) << 30,
+                      Upstream upstream = Upstream())
+      : m_upstream(upstream),
+        m_max_cached_bytes(max_cached_bytes),
+        m_fence(0)
+    {
+      m_stats.num_cache_hits = 0;
+      m_stats.num_upstream_allocations = 0;
+      m_stats.num_upstream_deallocations = 0;
+      m_stats.bytes_cached = 0;
+      m_stats.bytes_in_use = 0;
+    }
+
+    ~caching_allocator()
+    {
+      free_all();
+
+      if(m_fence)
+      {
+        cudaEventDestroy(m_fence);
+      }
+    }
+
+    char *allocate(std::ptrdiff_t num_bytes)
+    {
+      std::size_t bin = bin_of(num_bytes);
+      std::size_t bin_bytes = std::size_t(1) << bin;
+
+      char *result = 0;
+
+      if(!m_free_lists[bin].empty())
+      {
+        result = m_free_lists[bin].back();
+        m_free_lists[bin].pop_back();
+
+        m_stats.bytes_cached -= bin_bytes;
+        ++m_stats.num_cache_hits;
+
+        fence();
+      }
+      else
+      {
+        try
+        {
+          result = m_upstream.allocate(bin_bytes);
+        }
+        catch(std::bad_alloc &)
+        {
+          // give the cache back & try again
+          free_all();
+          result = m_upstream.allocate(bin_bytes);
+        }
+
+        ++m_stats.num_upstream_allocations;
+      }
+
+      m_stats.bytes_in_use += bin_bytes;
+
+      return result;
+    }
+
+    void deallocate(char *ptr, std::size_t num_bytes)
+    {
+      std::size_t bin = bin_of(num_bytes);
+      std::size_t bin_bytes = std::size_t(1) << bin;
+
+      m_stats.bytes_in_use -= bin_bytes;
+
+      if(m_stats.bytes_cached + bin_bytes <= m_max_cached_bytes)
+      {
+        m_free_lists[bin].push_back(ptr);
+        m_stats.bytes_cached += bin_bytes;
+      }
+      else
+      {
+        m_upstream.deallocate(ptr, bin_bytes);
+        ++m_stats.num_upstream_deallocations;
+      }
+    }
+
+    // returns every cached block upstream
+    void free_all()
+    {
+      trim(0);
+    }
+
+    std::size_t max_cached_bytes() const
+    {
+      return m_max_cached_bytes;
+    }
+
+    // returns cached blocks upstream, largest first, until the cache fits the new cap
+    void set_max_cached_bytes(std::size_t max_cached_bytes)
+    {
+      m_max_cached_bytes = max_cached_bytes;
+      trim(max_cached_bytes);
+    }
+
+    const caching_allocator_statistics &statistics() const
+    {
+      return m_stats;
+    }
+
+  private:
+    // XXX delete these unless we find a need for them
+    caching_allocator(const caching_allocator &);
+    caching_allocator &operator=(const caching_allocator &);
+
+    static std::size_t bin_of(std::ptrdiff_t num_bytes)
+    {
+      std::size_t bin = min_bin;
+
+      while((std::size_t(1) << bin) < static_cast<std::size_t>(num_bytes))
+      {
+        ++bin;
+      }
+
+      return bin;
+    }
+
+    void trim(std::size_t max_cached_bytes)
+    {
+      for(std::size_t bin = num_bins; bin-- > 0 && m_stats.bytes_cached > max_cached_bytes; )
+      {
+        std::size_t bin_bytes = std::size_t(1) << bin;
+
+        while(!m_free_lists[bin].empty() && m_stats.bytes_cached > max_cached_bytes)
+        {
+          m_upstream.deallocate(m_free_lists[bin].back(), bin_bytes);
+          m_free_lists[bin].pop_back();
+
+          m_stats.bytes_cached -= bin_bytes;
+          ++m_stats.num_upstream_deallocations;
+        }
+      }
+    }
+
+    void fence()
+    {
+      if(!m_fence)
+      {
+        cudaEventCreateWithFlags(&m_fence, cudaEventDisableTiming);
+      }
+
+      cudaEventRecord(m_fence, 0);
+    }
+
+    Upstream m_upstream;
+    std::size_t m_max_cached_bytes;
+    std::vector<char*> m_free_lists[num_bins];
+    caching_allocator_statistics m_stats;
+    cudaEvent_t m_fence;
+};
+
+
+// an uninitialized array of n Ts in device memory from an allocator, which lives until the
+// end of its scope. the drivers use it instead of thrust::detail::temporary_array so that
+// their temporary storage comes from the caller's allocator
+template<typename T, typename Allocator>
+class temporary_buffer
+{
+  public:
+    typedef T                           value_type;
+    typedef thrust::device_ptr<T>       iterator;
+    typedef thrust::device_reference<T> reference;
+    typedef std::size_t                 size_type;
+
+    temporary_buffer(Allocator &alloc, size_type n)
+      : m_alloc(alloc),
+        m_data(reinterpret_cast<T*>(alloc.allocate(n * sizeof(T)))),
+        m_size(n)
+    {}
+
+    ~temporary_buffer()
+    {
+      m_alloc.deallocate(reinterpret_cast<char*>(m_data.get()), m_size * sizeof(T));
+    }
+
+    iterator begin() const
+    {
+      return m_data;
+    }
+
+    iterator end() const
+    {
+      return m_data + m_size;
+    }
+
+    size_type size() const
+    {
+      return m_size;
+    }
+
+    reference operator[](size_type i) const
+    {
+      return m_data[i];
+    }
+
+  private:
+    // XXX delete these unless we find a need for them
+    temporary_buffer(const temporary_buffer &);
+    temporary_buffer &operator=(const temporary_buffer &);
+
+    Allocator &m_alloc;
+    iterator m_data;
+    size_type m_size;
+};
+
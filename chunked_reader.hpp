@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <new>
+#include <stdexcept>
+#include <cuda_runtime_api.h>
+#include <thrust/device_ptr.h>
+#include <pthread.h>
+
+
+// reads a stream of elements too large for memory in fixed-size chunks & stages each chunk on the device
+//
+// a reader thread fills one of two pinned host buffers from the source & copies it to the matching
+// device buffer on a non-blocking stream, while the caller computes on the other device buffer, so
+// that reading & copying chunk k+1 overlaps computing on chunk k
+//
+// Source is a functor with a nested value_type & std::size_t operator()(value_type *buffer, std::size_t max_n),
+// which writes at most max_n elements to buffer & returns how many it wrote. like fread, a source returns max_n
+// elements until it is exhausted, so a short chunk is the last one & two readers of streams with the same
+// length, like keys & values, stay in step. the source is called from the reader thread & must not throw
+template<typename Source>
+class chunked_reader
+{
+  public:
+    typedef typename Source::value_type  value_type;
+    typedef thrust::device_ptr<value_type> iterator;
+
+    chunked_reader(Source source, std::size_t chunk_size)
+      : m_source(source),
+        m_chunk_size(chunk_size),
+        m_num_produced(0),
+        m_num_consumed(0),
+        m_num_released(0),
+        m_exhausted(false),
+        m_stop(false),
+        m_error(cudaSuccess),
+        m_current(0)
+    {
+      cudaGetDevice(&m_device);
+
+      for(int i = 0; i < 2; ++i)
+      {
+        m_host_buffers[i] = 0;
+        m_device_buffers[i] = 0;
+        m_sizes[i] = 0;
+      }
+
+      if(cudaMallocHost(&m_host_buffers[0],  chunk_size * sizeof(value_type)) != cudaSuccess ||
+         cudaMallocHost(&m_host_buffers[1],  chunk_size * sizeof(value_type)) != cudaSuccess ||
+         cudaMalloc(&m_device_buffers[0], chunk_size * sizeof(value_type)) != cudaSuccess ||
+         cudaMalloc(&m_device_buffers[1], chunk_size * sizeof(value_type)) != cudaSuccess)
+      {
+        // clear the error
+        cudaGetLastError();
+
+        free_buffers();
+        throw std::bad_alloc();
+      }
+
+      // the drivers launch on blocking streams, which a copy on a blocking stream would serialize behind
+      cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking);
+
+      pthread_mutex_init(&m_mutex, 0);
+      pthread_cond_init(&m_cond, 0);
+
+      pthread_create(&m_thread, 0, run_reader, this);
+    }
+
+    ~chunked_reader()
+    {
+      pthread_mutex_lock(&m_mutex);
+      m_stop = true;
+      pthread_cond_broadcast(&m_cond);
+      pthread_mutex_unlock(&m_mutex);
+
+      pthread_join(m_thread, 0);
+
+      pthread_cond_destroy(&m_cond);
+      pthread_mutex_destroy(&m_mutex);
+
+      cudaStreamDestroy(m_stream);
+      free_buffers();
+    }
+
+    // hands the current chunk's buffers back to the reader & waits for the next chunk to reach the device
+    // returns the size of the next chunk, or 0 once the stream is exhausted
+    // the caller must be done with the current chunk, including work it launched asynchronously
+    std::size_t next()
+    {
+      pthread_mutex_lock(&m_mutex);
+
+      if(m_num_consumed > m_num_released)
+      {
+        ++m_num_released;
+        pthread_cond_broadcast(&m_cond);
+      }
+
+      while(m_num_consumed == m_num_produced && !m_exhausted)
+      {
+        pthread_cond_wait(&m_cond, &m_mutex);
+      }
+
+      std::size_t result = 0;
+
+      if(m_num_consumed < m_num_produced)
+      {
+        m_current = m_num_consumed % 2;
+        ++m_num_consumed;
+        result = m_sizes[m_current];
+      }
+
+      cudaError_t error = m_error;
+
+      pthread_mutex_unlock(&m_mutex);
+
+      if(error)
+      {
+        throw std::runtime_error(cudaGetErrorString(error));
+      }
+
+      return result;
+    }
+
+    // the device buffer of the chunk most recently returned by next()
+    iterator begin() const
+    {
+      return iterator(m_device_buffers[m_current]);
+    }
+
+    iterator end() const
+    {
+      return begin() + m_sizes[m_current];
+    }
+
+    std::size_t chunk_size() const
+    {
+      return m_chunk_size;
+    }
+
+  private:
+    // XXX delete these unless we find a need for them
+    chunked_reader(const chunked_reader &);
+    chunked_reader &operator=(const chunked_reader &);
+
+    static void *run_reader(void *arg)
+    {
+      reinterpret_cast<chunked_reader*>(arg)->read_chunks();
+      return 0;
+    }
+
+    void read_chunks()
+    {
+      cudaSetDevice(m_device);
+
+      for(std::size_t k = 0; ; ++k)
+      {
+        int slot = k % 2;
+
+        // wait for the consumer to hand back this slot's chunk from two chunks ago
+        pthread_mutex_lock(&m_mutex);
+
+        while(m_num_produced - m_num_released == 2 && !m_stop)
+        {
+          pthread_cond_wait(&m_cond, &m_mutex);
+        }
+
+        bool stop = m_stop;
+
+        pthread_mutex_unlock(&m_mutex);
+
+        if(stop) return;
+
+        std::size_t n = m_source(m_host_buffers[slot], m_chunk_size);
+
+        cudaError_t error = cudaSuccess;
+
+        if(n > 0)
+        {
+          error = cudaMemcpyAsync(m_device_buffers[slot], m_host_buffers[slot], n * sizeof(value_type), cudaMemcpyHostToDevice, m_stream);
+
+          if(!error) error = cudaStreamSynchronize(m_stream);
+        }
+
+        pthread_mutex_lock(&m_mutex);
+
+        if(error)
+        {
+          m_error = error;
+          n = 0;
+        }
+
+        if(n > 0)
+        {
+          m_sizes[slot] = n;
+          ++m_num_produced;
+        }
+
+        if(n < m_chunk_size)
+        {
+          m_exhausted = true;
+        }
+
+        pthread_cond_broadcast(&m_cond);
+
+        pthread_mutex_unlock(&m_mutex);
+
+        if(n < m_chunk_size) return;
+      }
+    }
+
+    void free_buffers()
+    {
+      for(int i = 0; i < 2; ++i)
+      {
+        if(m_host_buffers[i])   cudaFreeHost(m_host_buffers[i]);
+        if(m_device_buffers[i]) cudaFree(m_device_buffers[i]);
+      }
+    }
+
+    Source m_source;
+    std::size_t m_chunk_size;
+
+    int m_device;
+    cudaStream_t m_stream;
+    value_type *m_host_buffers[2];
+    value_type *m_device_buffers[2];
+    std::size_t m_sizes[2];
+
+    // guarded by m_mutex
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    std::size_t m_num_produced;
+    std::size_t m_num_consumed;
+    std::size_t m_num_released;
+    bool m_exhausted;
+    bool m_stop;
+    cudaError_t m_error;
+
+    // touched only by the consumer
+    int m_current;
+
+    pthread_t m_thread;
+};
+
+
+// reads the binary elements of a file, like a column of a table, for chunked_reader
+template<typename T>
+struct file_source
+{
+  typedef T value_type;
+
+  // the file is borrowed, not owned
+  file_source(std::FILE *file)
+    : m_file(file)
+  {}
+
+  std::size_t operator()(T *buffer, std::size_t max_n)
+  {
+    // fread returns short only at the end of the file or on error
+    return std::fread(buffer, sizeof(T), max_n, m_file);
+  }
+
+  std::FILE *m_file;
+};
+
+
+// writes each chunk of a result to a file as binary elements
+template<typename T>
+struct file_sink
+{
+  // the file is borrowed, not owned
+  file_sink(std::FILE *file)
+    : m_file(file)
+  {}
+
+  void operator()(const T *data, std::size_t n)
+  {
+    if(std::fwrite(data, sizeof(T), n, m_file) != n)
+    {
+      throw std::runtime_error("file_sink: couldn't write");
+    }
+  }
+
+  std::FILE *m_file;
+};
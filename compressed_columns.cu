@@ -0,0 +1,163 @@
+#include <thrust/device_vector.h>
+#include <thrust/reduce.h>
+#include <thrust/equal.h>
+#include <thrust/functional.h>
+#include <bulk/bulk.hpp>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <vector>
+#include "time_invocation_cuda.hpp"
+#include "decomposition.hpp"
+
+// compares reducing & decompressing columns stored as 32b ints with the same columns bit-packed
+// into 12 bits per element & delta-encoded into 8 bits per element: compressed_columns [number of elements]
+//
+// the effective bandwidth counts the bytes of the decoded ints, so a compressed column read at the
+// device's raw bandwidth has an effective bandwidth roughly 32 / Bits times higher
+
+typedef unsigned int T;
+
+const int groupsize = 128;
+const int grainsize = 7;
+
+typedef bulk::bitpacked_iterator<T,12> packed_iterator;
+typedef bulk::delta_iterator<T,8>      delta_iterator;
+
+
+struct reduce_tiles
+{
+  template<typename ConcurrentGroup, typename Iterator, typename Decomposition, typename Pointer>
+  __device__
+  void operator()(ConcurrentGroup &this_group, Iterator first, Decomposition decomp, Pointer result)
+  {
+    typename Decomposition::range range = decomp[this_group.index()];
+
+    T sum = bulk::reduce(this_group, first + range.first, first + range.second, T(0), thrust::plus<T>());
+
+    if(this_group.this_exec.index() == 0)
+    {
+      result[this_group.index()] = sum;
+    }
+  }
+};
+
+
+struct copy_tiles
+{
+  template<typename ConcurrentGroup, typename Iterator, typename Decomposition, typename Pointer>
+  __device__
+  void operator()(ConcurrentGroup &this_group, Iterator first, Decomposition decomp, Pointer result)
+  {
+    typename Decomposition::range range = decomp[this_group.index()];
+
+    bulk::copy_n(this_group, first + range.first, range.second - range.first, result + range.first);
+  }
+};
+
+
+aligned_decomposition<int> decompose(size_t n)
+{
+  const int subscription = 10;
+
+  return make_tiled_decomposition<int>(n, groupsize * grainsize, subscription * bulk::concurrent_group<>::hardware_concurrency());
+}
+
+
+// the compressed iterators stage each tile in the group's heap, so the groups are sized for them
+template<typename Iterator>
+T reduce_column(Iterator first, size_t n)
+{
+  bulk::heap_requirement<bulk::reduce_tag,groupsize,grainsize,T,Iterator> heap_size;
+
+  aligned_decomposition<int> decomp = decompose(n);
+
+  thrust::device_vector<T> partial_sums(decomp.size());
+
+  bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(), heap_size), reduce_tiles(), bulk::root.this_exec, first, decomp, partial_sums.begin());
+
+  return thrust::reduce(partial_sums.begin(), partial_sums.end());
+}
+
+
+template<typename Iterator>
+void decompress_column(Iterator first, size_t n, thrust::device_vector<T> *result)
+{
+  bulk::heap_requirement<bulk::copy_tag,groupsize,grainsize,Iterator> heap_size;
+
+  aligned_decomposition<int> decomp = decompose(n);
+
+  bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(), heap_size), copy_tiles(), bulk::root.this_exec, first, decomp, result->begin());
+}
+
+
+template<typename Iterator>
+void compare(const char *name, Iterator first, size_t n, size_t compressed_bytes, const std::vector<T> &reference)
+{
+  T expected = std::accumulate(reference.begin(), reference.end(), T(0));
+
+  assert(reduce_column(first, n) == expected);
+  double reduce_msecs = time_invocation_cuda(20, reduce_column<Iterator>, first, n);
+
+  thrust::device_vector<T> decompressed(n);
+  decompress_column(first, n, &decompressed);
+  assert(thrust::equal(decompressed.begin(), decompressed.end(), thrust::device_vector<T>(reference.begin(), reference.end()).begin()));
+  double copy_msecs = time_invocation_cuda(20, decompress_column<Iterator>, first, n, &decompressed);
+
+  double decoded_gigabytes = double(n * sizeof(T)) / (1 << 30);
+  double read_gigabytes = double(compressed_bytes) / (1 << 30);
+
+  std::cout << name << ": " << compressed_bytes / double(n) << " bytes per element" << std::endl;
+  std::cout << "  reduce: " << reduce_msecs << " ms, effective " << decoded_gigabytes / (reduce_msecs / 1000) << " GB/s, read " << read_gigabytes / (reduce_msecs / 1000) << " GB/s" << std::endl;
+  std::cout << "  copy:   " << copy_msecs   << " ms, effective " << decoded_gigabytes / (copy_msecs / 1000)   << " GB/s, read " << read_gigabytes / (copy_msecs / 1000)   << " GB/s" << std::endl;
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t n = 1 << 26;
+  if(argc > 1) n = std::atol(argv[1]);
+
+  // a column whose values fit in 12 bits & a sorted column whose neighbors differ by less than 2^8
+  std::vector<T> small(n), sorted(n);
+
+  T x = 0;
+  for(size_t i = 0; i < n; ++i)
+  {
+    small[i] = std::rand() % (1 << 12);
+
+    x += std::rand() % (1 << 8);
+    sorted[i] = x;
+  }
+
+  std::vector<unsigned int> packed(bulk::bitpacked_size(n, 12));
+  bool small_fits = bulk::bitpack<12>(small.begin(), small.end(), T(0), &packed[0]);
+  assert(small_fits);
+
+  std::vector<T> anchors(bulk::delta_num_frames(n, delta_iterator::frame_size));
+  std::vector<unsigned int> deltas(bulk::bitpacked_size(n, 8));
+  bool sorted_fits = bulk::delta_encode<8,delta_iterator::frame_size>(sorted.begin(), sorted.end(), &anchors[0], &deltas[0]);
+  assert(sorted_fits);
+
+  thrust::device_vector<T> d_small(small.begin(), small.end());
+  thrust::device_vector<T> d_sorted(sorted.begin(), sorted.end());
+  thrust::device_vector<unsigned int> d_packed(packed.begin(), packed.end());
+  thrust::device_vector<T> d_anchors(anchors.begin(), anchors.end());
+  thrust::device_vector<unsigned int> d_deltas(deltas.begin(), deltas.end());
+
+  std::cout << "N: " << n << std::endl;
+
+  compare("32b ints, 12b values", thrust::raw_pointer_cast(d_small.data()), n, n * sizeof(T), small);
+  compare("bit-packed, 12b",      packed_iterator(thrust::raw_pointer_cast(d_packed.data())), n, packed.size() * sizeof(unsigned int), small);
+
+  compare("32b ints, sorted",     thrust::raw_pointer_cast(d_sorted.data()), n, n * sizeof(T), sorted);
+  compare("delta-encoded, 8b",
+          delta_iterator(thrust::raw_pointer_cast(d_anchors.data()), thrust::raw_pointer_cast(d_deltas.data())),
+          n,
+          anchors.size() * sizeof(T) + deltas.size() * sizeof(unsigned int),
+          sorted);
+
+  return 0;
+}
+
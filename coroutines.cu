@@ -0,0 +1,100 @@
+#include <bulk/bulk.hpp>
+#include <bulk/coroutine.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <cassert>
+#include <cstdio>
+#include <exception>
+
+// two coroutines co_await chains of bulk::async launches while this thread multiplexes them
+// through bulk::default_reactor(), and each checks what its launches computed: coroutines
+//
+// bulk/coroutine.hpp needs C++20 coroutines, so build this with e.g. nvcc -std=c++20 coroutines.cu
+
+#if !defined(__cpp_impl_coroutine)
+#error "coroutines.cu requires C++20 coroutines; build it with -std=c++20"
+#endif
+
+
+// a coroutine which begins eagerly & whose frame is destroyed when it finishes
+struct detached_task
+{
+  struct promise_type
+  {
+    detached_task get_return_object() { return detached_task(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+
+struct fill
+{
+  __device__
+  void operator()(bulk::agent<> &self, int *x, int value)
+  {
+    x[self.index()] = value;
+  }
+};
+
+
+struct scale_and_add
+{
+  __device__
+  void operator()(bulk::agent<> &self, int *x, int a, int b)
+  {
+    int i = self.index();
+    x[i] = a * x[i] + b;
+  }
+};
+
+
+detached_task compute(thrust::device_vector<int> &x, int value, int a, int b, int *num_finished)
+{
+  int *ptr = thrust::raw_pointer_cast(x.data());
+  int n = x.size();
+
+  // await a temporary future
+  co_await bulk::async(bulk::par(n), fill(), bulk::root.this_exec, ptr, value);
+
+  // the fill has finished, so the next launch sees its result without an explicit dependency
+  bulk::future<void> f = bulk::async(bulk::par(n), scale_and_add(), bulk::root.this_exec, ptr, a, b);
+
+  // await a future this coroutine still owns
+  co_await f;
+
+  thrust::host_vector<int> h_x = x;
+
+  for(int i = 0; i < n; ++i)
+  {
+    assert(h_x[i] == a * value + b);
+  }
+
+  ++*num_finished;
+}
+
+
+int main()
+{
+  const int n = 1 << 20;
+
+  thrust::device_vector<int> x(n), y(n);
+
+  int num_finished = 0;
+
+  // each coroutine runs until it first suspends, so both sets of launches are in flight at once
+  compute(x, 7, 3, 1, &num_finished);
+  compute(y, -2, 5, 13, &num_finished);
+
+  // resume the coroutines from this thread as their launches complete
+  bulk::default_reactor().run();
+
+  assert(num_finished == 2);
+  assert(bulk::default_reactor().num_pending() == 0);
+
+  std::printf("both coroutines awaited their launches\n");
+
+  return 0;
+}
@@ -217,3 +217,16 @@ aligned_decomposition<Size> make_aligned_decomposition(Size n, Size num_partitio
   return aligned_decomposition<Size>(n,num_partitions,aligned_size);
 }
 
+
+
+// deals the tiles of n elements, of tile_size elements each, to max_num_partitions partitions,
+// or to one partition per tile if there are fewer tiles
+template<typename Size>
+__host__ __device__
+aligned_decomposition<Size> make_tiled_decomposition(Size n, Size tile_size, Size max_num_partitions)
+{
+  Size num_tiles = (n + tile_size - 1) / tile_size;
+
+  return aligned_decomposition<Size>(n, thrust::min<Size>(max_num_partitions, num_tiles), tile_size);
+}
+
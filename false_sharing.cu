@@ -0,0 +1,218 @@
+#include <bulk/uninitialized.hpp>
+#include <bulk/detail/host_affinity.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <pthread.h>
+#include "time_invocation_cuda.hpp"
+
+// compares the layouts of arrays with one slot per worker or per group on the host, where
+// neighboring slots written by different cores share a cache line: false_sharing [number of rounds]
+//
+//   per-agent slots, like the partial sums bulk::reduce stores to buffer[tid]:
+//     contiguous_layout & padded_layout uninitialized_arrays
+//   per-group slots, like result[this_group.index()] in reduce_intervals_kernel or is_carry in reduce_by_key:
+//     contiguous, padded & blocked_slot_layout
+
+const unsigned int max_num_workers = 256;
+const unsigned int interval_size = 64;
+
+
+struct worker
+{
+  const int *data;
+  const bulk::detail::affinity *placement;
+  unsigned int index, num_workers;
+  unsigned int num_rounds;
+
+  // per-agent slots
+  volatile long long *slot;
+
+  // per-group slots
+  char *results;
+  const std::vector<std::size_t> *offsets;
+};
+
+
+// stores the running sum of the worker's interval to its slot after every element
+void *accumulate_to_slot(void *arg)
+{
+  worker *w = reinterpret_cast<worker*>(arg);
+
+  bulk::detail::pin_this_thread(w->placement->cpu_for_worker(w->index));
+
+  const int *data = w->data + w->index * interval_size;
+
+  for(unsigned int round = 0; round < w->num_rounds; ++round)
+  {
+    *w->slot = 0;
+
+    for(unsigned int i = 0; i < interval_size; ++i)
+    {
+      *w->slot = *w->slot + data[i];
+    }
+  }
+
+  return 0;
+}
+
+
+// reduces the interval of each group worker_for_group assigns the worker & stores each sum to its group's slot
+void *reduce_groups(void *arg)
+{
+  worker *w = reinterpret_cast<worker*>(arg);
+
+  bulk::detail::pin_this_thread(w->placement->cpu_for_worker(w->index));
+
+  unsigned int num_groups = w->offsets->size();
+  unsigned int first = bulk::detail::first_group_of_worker(w->index, num_groups, w->num_workers);
+  unsigned int last  = bulk::detail::first_group_of_worker(w->index + 1, num_groups, w->num_workers);
+
+  for(unsigned int round = 0; round < w->num_rounds; ++round)
+  {
+    for(unsigned int g = first; g < last; ++g)
+    {
+      volatile long long *result = reinterpret_cast<volatile long long*>(w->results + (*w->offsets)[g]);
+
+      const int *data = w->data + (g % max_num_workers) * interval_size;
+
+      long long sum = 0;
+
+      for(unsigned int i = 0; i < interval_size; ++i)
+      {
+        sum += data[i];
+      }
+
+      *result = sum;
+    }
+  }
+
+  return 0;
+}
+
+
+double run(void *(*body)(void*), std::vector<worker> &workers)
+{
+  std::vector<pthread_t> threads(workers.size());
+
+  double start = wall_clock_ms();
+
+  for(unsigned int i = 0; i < workers.size(); ++i)
+  {
+    pthread_create(&threads[i], 0, body, &workers[i]);
+  }
+
+  for(unsigned int i = 0; i < workers.size(); ++i)
+  {
+    pthread_join(threads[i], 0);
+  }
+
+  return wall_clock_ms() - start;
+}
+
+
+template<typename Array>
+void measure_agent_slots(const char *name, const int *data, const bulk::detail::affinity &placement, unsigned int num_workers, unsigned int num_rounds)
+{
+  static Array slots;
+
+  std::vector<worker> workers(num_workers);
+
+  for(unsigned int i = 0; i < num_workers; ++i)
+  {
+    workers[i].data = data;
+    workers[i].placement = &placement;
+    workers[i].index = i;
+    workers[i].num_workers = num_workers;
+    workers[i].num_rounds = num_rounds;
+    workers[i].slot = &slots[i];
+  }
+
+  double msecs = run(accumulate_to_slot, workers);
+
+  long long sum = 0;
+  for(unsigned int i = 0; i < num_workers; ++i)
+  {
+    sum += slots[i];
+  }
+
+  std::printf("%24s: %8.1f ms (sum %lld)\n", name, msecs, sum);
+}
+
+
+void measure_group_slots(const char *name, const int *data, const std::vector<std::size_t> &offsets, std::size_t size,
+                         const bulk::detail::affinity &placement, unsigned int num_workers, unsigned int num_rounds)
+{
+  void *results = 0;
+  if(posix_memalign(&results, 64, size)) return;
+
+  std::vector<worker> workers(num_workers);
+
+  for(unsigned int i = 0; i < num_workers; ++i)
+  {
+    workers[i].data = data;
+    workers[i].placement = &placement;
+    workers[i].index = i;
+    workers[i].num_workers = num_workers;
+    workers[i].num_rounds = num_rounds;
+    workers[i].results = reinterpret_cast<char*>(results);
+    workers[i].offsets = &offsets;
+  }
+
+  double msecs = run(reduce_groups, workers);
+
+  long long sum = 0;
+  for(unsigned int g = 0; g < offsets.size(); ++g)
+  {
+    sum += *reinterpret_cast<long long*>(reinterpret_cast<char*>(results) + offsets[g]);
+  }
+
+  std::printf("%24s: %8.1f ms (sum %lld, %lu bytes)\n", name, msecs, sum, static_cast<unsigned long>(size));
+
+  std::free(results);
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned int num_rounds = 1 << 16;
+  if(argc > 1) num_rounds = std::atoi(argv[1]);
+
+  bulk::detail::affinity placement(bulk::detail::affinity::compact);
+  unsigned int num_workers = std::min<std::size_t>(max_num_workers, std::max<std::size_t>(1, bulk::detail::available_cpus().size()));
+
+  std::vector<int> data(max_num_workers * interval_size);
+  for(std::size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = i % 13;
+  }
+
+  std::printf("%u workers, %u rounds\n", num_workers, num_rounds);
+
+  std::printf("per-agent slots\n");
+  measure_agent_slots<bulk::uninitialized_array<long long, max_num_workers, bulk::contiguous_layout> >("contiguous", &data[0], placement, num_workers, num_rounds);
+  measure_agent_slots<bulk::uninitialized_array<long long, max_num_workers, bulk::padded_layout<> > >("padded", &data[0], placement, num_workers, num_rounds);
+  measure_agent_slots<bulk::uninitialized_array<long long, max_num_workers, bulk::slot_layout<bulk::host_space>::type> >("slot_layout", &data[0], placement, num_workers, num_rounds);
+
+  // a few groups per worker, so that most lines of a contiguous array hold several workers' groups
+  unsigned int num_groups = 3 * num_workers;
+
+  std::vector<std::size_t> contiguous(num_groups), padded(num_groups), blocked(num_groups);
+  bulk::detail::blocked_slot_layout blocked_layout(num_groups, num_workers, sizeof(long long));
+
+  for(unsigned int g = 0; g < num_groups; ++g)
+  {
+    contiguous[g] = g * sizeof(long long);
+    padded[g]     = g * 64;
+    blocked[g]    = blocked_layout.offset(g);
+  }
+
+  std::printf("per-group slots, %u groups\n", num_groups);
+  measure_group_slots("contiguous", &data[0], contiguous, num_groups * sizeof(long long), placement, num_workers, num_rounds);
+  measure_group_slots("padded", &data[0], padded, num_groups * 64, placement, num_workers, num_rounds);
+  measure_group_slots("blocked", &data[0], blocked, blocked_layout.size(), placement, num_workers, num_rounds);
+
+  return 0;
+}
+
@@ -0,0 +1,165 @@
+#include "huge_page_allocator.hpp"
+#include "decomposition.hpp"
+#include "time_invocation_cuda.hpp"
+#include <bulk/detail/host_affinity.hpp>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// compares the bandwidth of a host reduction over the groups of an aligned_decomposition
+// when its input was first touched by a single thread & when each group's range was first
+// touched by the worker which reduces it: first_touch [number of ints]
+//
+// on a multi-socket machine the former puts every page on one node
+
+struct worker
+{
+  const int *data;
+  aligned_decomposition<long> decomp;
+  const bulk::detail::affinity *placement;
+  unsigned int index, num_workers;
+  long long sum;
+};
+
+
+// like huge_page_allocator's prefault, each worker reduces the groups worker_for_group assigns it
+void *reduce_groups(void *arg)
+{
+  worker *w = reinterpret_cast<worker*>(arg);
+
+  bulk::detail::pin_this_thread(w->placement->cpu_for_worker(w->index));
+
+  unsigned int num_groups = w->decomp.size();
+
+  long long sum = 0;
+
+  for(int trial = 0; trial < 10; ++trial)
+  {
+    for(unsigned int g = 0; g < num_groups; ++g)
+    {
+      if(bulk::detail::worker_for_group(g, num_groups, w->num_workers) != w->index) continue;
+
+      aligned_decomposition<long>::range rng = w->decomp[g];
+
+      for(long i = rng.first; i < rng.second; ++i)
+      {
+        sum += w->data[i];
+      }
+    }
+  }
+
+  w->sum = sum;
+
+  return 0;
+}
+
+
+// checks that per-worker first touch faulted in every page of an allocation & that worker 0's slice begins at page 0
+void check_first_touch(const huge_page_allocator &alloc, const char *ptr, std::size_t num_bytes, const aligned_decomposition<long> &decomp)
+{
+  std::size_t small_page_size = sysconf(_SC_PAGESIZE);
+  std::size_t num_small_pages = (num_bytes + small_page_size - 1) / small_page_size;
+
+  std::vector<unsigned char> resident(num_small_pages);
+  int error = mincore(const_cast<char*>(ptr), num_bytes, &resident[0]);
+  assert(error == 0);
+
+  std::size_t num_resident = 0;
+  for(std::size_t i = 0; i < num_small_pages; ++i)
+  {
+    num_resident += resident[i] & 1;
+  }
+
+  std::printf("%zu of %zu pages resident after first touch\n", num_resident, num_small_pages);
+  assert(num_resident == num_small_pages);
+
+  std::size_t page_size = alloc.last_page_size();
+  std::size_t size = (num_bytes + huge_page_allocator::huge_page_size - 1) / huge_page_allocator::huge_page_size * huge_page_allocator::huge_page_size;
+
+  std::vector<std::size_t> boundaries = alloc.first_touch_boundaries(size, page_size, decomp, sizeof(int));
+  assert(boundaries.front() == 0 && boundaries[1] > 0);
+  assert(boundaries.back() == size);
+  assert(std::adjacent_find(boundaries.begin(), boundaries.end(), std::greater<std::size_t>()) == boundaries.end());
+}
+
+
+void measure(const char *name, const int *data, aligned_decomposition<long> decomp, const bulk::detail::affinity &placement, unsigned int num_workers)
+{
+  std::vector<worker> workers(num_workers);
+  std::vector<pthread_t> threads(num_workers);
+
+  double start = wall_clock_ms();
+
+  for(unsigned int i = 0; i < num_workers; ++i)
+  {
+    workers[i].data = data;
+    workers[i].decomp = decomp;
+    workers[i].placement = &placement;
+    workers[i].index = i;
+    workers[i].num_workers = num_workers;
+
+    pthread_create(&threads[i], 0, reduce_groups, &workers[i]);
+  }
+
+  long long sum = 0;
+
+  for(unsigned int i = 0; i < num_workers; ++i)
+  {
+    pthread_join(threads[i], 0);
+    sum += workers[i].sum;
+  }
+
+  double msecs = wall_clock_ms() - start;
+
+  double gigabytes = 10.0 * decomp.n() * sizeof(int) / (1 << 30);
+
+  std::printf("%24s: %8.1f ms %8.2f GB/s (sum %lld)\n", name, msecs, gigabytes / (msecs / 1000), sum);
+}
+
+
+int main(int argc, char **argv)
+{
+  long n = 100000000;
+  if(argc > 1) n = std::atol(argv[1]);
+
+  bulk::detail::affinity placement(bulk::detail::affinity::compact);
+  unsigned int num_workers = std::max<std::size_t>(1, bulk::detail::available_cpus().size());
+
+  // like my_reduce's decomposition
+  const long tile_size = 128 * 7;
+  const long num_tiles = (n + tile_size - 1) / tile_size;
+  const long num_groups = std::min<long>(10 * num_workers, num_tiles);
+
+  aligned_decomposition<long> decomp(n, num_groups, tile_size);
+
+  std::printf("%ld ints, %ld groups, %u workers\n", n, num_groups, num_workers);
+
+  // one thread first touches every page
+  huge_page_allocator serial_alloc(huge_page_allocator::transparent_huge_pages, 1, placement);
+  int *serial = reinterpret_cast<int*>(serial_alloc.allocate(n * sizeof(int)));
+
+  // each worker first touches its groups' pages
+  huge_page_allocator local_alloc(huge_page_allocator::transparent_huge_pages, num_workers, placement);
+  int *local = reinterpret_cast<int*>(local_alloc.allocate(n * sizeof(int), decomp, sizeof(int)));
+
+  check_first_touch(local_alloc, reinterpret_cast<char*>(local), n * sizeof(int), decomp);
+
+  for(long i = 0; i < n; ++i)
+  {
+    serial[i] = local[i] = i % 13;
+  }
+
+  measure("single thread first touch", serial, decomp, placement, num_workers);
+  measure("per-worker first touch", local, decomp, placement, num_workers);
+
+  serial_alloc.deallocate(reinterpret_cast<char*>(serial), n * sizeof(int));
+  local_alloc.deallocate(reinterpret_cast<char*>(local), n * sizeof(int));
+
+  return 0;
+}
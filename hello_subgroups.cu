@@ -0,0 +1,78 @@
+#include <cassert>
+#include <cstdio>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/functional.h>
+
+// every subgroup of every block reduces its own segment of the input at the same time as its siblings,
+// once with the subgroups' scoped_buffers in their private heaps & once with no room for them there,
+// so that the buffers come from bulk::malloc, and checks every subgroup's sum: hello_subgroups
+
+struct reduce_segments
+{
+  template<typename Iterator>
+  __device__
+  void operator()(bulk::parallel_group<bulk::concurrent_group<bulk::concurrent_group<> > > &grid, Iterator data, int segment_size, Iterator sums)
+  {
+    bulk::concurrent_group<bulk::concurrent_group<> > &block = grid.this_exec;
+    bulk::concurrent_group<> &subgroup = block.this_exec;
+
+    int segment = block.index() * block.size() + subgroup.index();
+
+    Iterator first = data + segment * segment_size;
+
+    // subgroups share their block's barrier, so every subgroup reduces together
+    int sum = bulk::reduce(subgroup, first, first + segment_size, 0, thrust::plus<int>());
+
+    if(subgroup.this_exec.index() == 0)
+    {
+      sums[segment] = sum;
+    }
+  }
+};
+
+
+void test(size_t subgroup_heap_size)
+{
+  const int num_blocks = 2, num_subgroups = 4, subgroup_size = 8;
+  const int num_segments = num_blocks * num_subgroups;
+
+  // each segment is longer than a subgroup, which strides through it more than once
+  const int segment_size = 3 * subgroup_size + 5;
+
+  thrust::host_vector<int> h_data(num_segments * segment_size);
+  thrust::host_vector<int> expected(num_segments, 0);
+
+  for(int i = 0; i < num_segments * segment_size; ++i)
+  {
+    h_data[i] = (i * 7) % 13 - 6;
+    expected[i / segment_size] += h_data[i];
+  }
+
+  thrust::device_vector<int> data = h_data;
+  thrust::device_vector<int> sums(num_segments, 0);
+
+  bulk::async(bulk::par(bulk::con(bulk::con(subgroup_size, subgroup_heap_size), num_subgroups), num_blocks),
+              reduce_segments(),
+              bulk::root, data.begin(), segment_size, sums.begin()).wait();
+
+  thrust::host_vector<int> h_sums = sums;
+
+  for(int i = 0; i < num_segments; ++i)
+  {
+    assert(h_sums[i] == expected[i]);
+  }
+}
+
+
+int main()
+{
+  test(bulk::use_default);
+  test(0);
+
+  std::printf("every subgroup reduced its own segment\n");
+
+  return 0;
+}
+
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <bulk/detail/host_affinity.hpp>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+// allocates host memory in 2MiB pages, falling back to smaller pages when it must
+//
+//   explicit_huge_pages:    mmap(MAP_HUGETLB) from the reserved pool in /proc/sys/vm/nr_hugepages,
+//                           or transparent_huge_pages if the pool is empty
+//   transparent_huge_pages: an anonymous mapping aligned to 2MiB with madvise(MADV_HUGEPAGE),
+//                           which khugepaged & the page fault handler may back with huge pages
+//   small_pages:            an anonymous mapping
+//
+// each allocation is prefaulted in parallel: the pages are split into contiguous slices,
+// one per worker pinned by a bulk::detail::affinity, so that every page is resident before
+// the caller first touches it. an allocation may instead be split along a decomposition of
+// its elements, so that each page is first touched on the cpu which will process it
+//
+// huge_page_allocator satisfies the same contract as caching_allocator's Upstream
+class huge_page_allocator
+{
+  public:
+    typedef char value_type;
+
+    enum page_policy
+    {
+      explicit_huge_pages,
+      transparent_huge_pages,
+      small_pages
+    };
+
+    static const std::size_t huge_page_size = std::size_t(2) << 20;
+
+    // num_workers == 0 prefaults with one worker per available cpu
+    huge_page_allocator(page_policy policy = transparent_huge_pages,
+                        unsigned int num_workers = 0,
+                        const bulk::detail::affinity &placement = bulk::detail::affinity(bulk::detail::affinity::compact))
+      : m_policy(policy),
+        m_last_policy(policy),
+        m_num_workers(num_workers),
+        m_placement(placement)
+    {
+      if(m_num_workers == 0)
+      {
+        m_num_workers = std::max<std::size_t>(1, bulk::detail::available_cpus().size());
+      }
+    }
+
+    char *allocate(std::ptrdiff_t num_bytes)
+    {
+      std::size_t size = round_up(num_bytes);
+      std::size_t page_size = 0;
+
+      char *result = map_pages(size, page_size);
+
+      std::vector<std::size_t> boundaries(m_num_workers + 1);
+
+      for(std::size_t i = 0; i < boundaries.size(); ++i)
+      {
+        boundaries[i] = size / page_size * i / m_num_workers * page_size;
+      }
+
+      prefault(result, size, page_size, boundaries);
+
+      return result;
+    }
+
+    // allocates an array of elements to be processed by groups of decomp, and first touches
+    // the pages of each group's range from the worker which will process that group, so that
+    // on a NUMA machine each group's range is local to its worker
+    //
+    // groups are assigned to workers by bulk::detail::worker_for_group, and worker i runs on
+    // placement().cpu_for_worker(i)
+    template<typename Decomposition>
+    char *allocate(std::ptrdiff_t num_bytes, const Decomposition &decomp, std::size_t element_size)
+    {
+      std::size_t size = round_up(num_bytes);
+      std::size_t page_size = 0;
+
+      char *result = map_pages(size, page_size);
+
+      prefault(result, size, page_size, first_touch_boundaries(size, page_size, decomp, element_size));
+
+      return result;
+    }
+
+    // worker i of an allocation of size bytes along decomp first touches the pages in [boundaries[i], boundaries[i+1])
+    //
+    // worker 0's slice begins at the first page, each other worker's slice begins at the page of the first
+    // group worker_for_group assigns it, and workers without groups, which come last, get empty slices
+    template<typename Decomposition>
+    std::vector<std::size_t> first_touch_boundaries(std::size_t size, std::size_t page_size, const Decomposition &decomp, std::size_t element_size) const
+    {
+      unsigned int num_groups = decomp.size();
+
+      std::vector<std::size_t> boundaries(m_num_workers + 1, size);
+      boundaries[0] = 0;
+
+      for(unsigned int worker = 1; worker < m_num_workers; ++worker)
+      {
+        unsigned int group = bulk::detail::first_group_of_worker(worker, num_groups, m_num_workers);
+
+        if(group < num_groups)
+        {
+          // the page which straddles two workers' ranges goes to the earlier worker
+          std::size_t boundary = (decomp[group].first * element_size + page_size - 1) / page_size * page_size;
+
+          boundaries[worker] = boundary < size ? boundary : size;
+        }
+      }
+
+      return boundaries;
+    }
+
+    void deallocate(char *ptr, std::size_t num_bytes)
+    {
+      munmap(ptr, round_up(num_bytes));
+    }
+
+    unsigned int num_workers() const
+    {
+      return m_num_workers;
+    }
+
+    const bulk::detail::affinity &placement() const
+    {
+      return m_placement;
+    }
+
+    page_policy policy() const
+    {
+      return m_policy;
+    }
+
+    // the policy the latest allocation got after any fallback
+    page_policy last_policy() const
+    {
+      return m_last_policy;
+    }
+
+    // the size of the pages of the latest allocation
+    std::size_t last_page_size() const
+    {
+      return m_last_policy == small_pages ? sysconf(_SC_PAGESIZE) : huge_page_size;
+    }
+
+  private:
+    static std::size_t round_up(std::ptrdiff_t num_bytes)
+    {
+      std::size_t n = num_bytes > 0 ? num_bytes : 1;
+      return (n + huge_page_size - 1) / huge_page_size * huge_page_size;
+    }
+
+    char *map_pages(std::size_t size, std::size_t &page_size)
+    {
+      page_policy policy = m_policy;
+      char *result = 0;
+
+#ifdef MAP_HUGETLB
+      if(policy == explicit_huge_pages)
+      {
+        result = map(size, MAP_HUGETLB);
+      }
+#endif
+
+      if(!result && policy != small_pages)
+      {
+        policy = transparent_huge_pages;
+        result = map_aligned(size);
+
+#ifdef MADV_HUGEPAGE
+        if(result)
+        {
+          // XXX the kernel may ignore this when transparent huge pages are disabled
+          madvise(result, size, MADV_HUGEPAGE);
+        }
+#endif
+      }
+
+      if(!result)
+      {
+        policy = small_pages;
+        result = map(size, 0);
+      }
+
+      if(!result)
+      {
+        throw std::bad_alloc();
+      }
+
+      m_last_policy = policy;
+      page_size = last_page_size();
+
+      return result;
+    }
+
+    static char *map(std::size_t size, int flags)
+    {
+      void *result = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+
+      return result == MAP_FAILED ? 0 : reinterpret_cast<char*>(result);
+    }
+
+    // the fault handler only installs a huge page where a whole aligned 2MiB fits,
+    // so overallocate by a huge page & trim the ends
+    static char *map_aligned(std::size_t size)
+    {
+      char *raw = map(size + huge_page_size, 0);
+      if(!raw) return 0;
+
+      std::size_t misalignment = reinterpret_cast<std::size_t>(raw) % huge_page_size;
+      std::size_t head = misalignment ? huge_page_size - misalignment : 0;
+
+      if(head)
+      {
+        munmap(raw, head);
+      }
+
+      munmap(raw + head + size, huge_page_size - head);
+
+      return raw + head;
+    }
+
+    struct prefault_slice
+    {
+      char *first, *last;
+      std::size_t page_size;
+      int cpu;
+    };
+
+    static void *prefault_slice_thread(void *arg)
+    {
+      prefault_slice *slice = reinterpret_cast<prefault_slice*>(arg);
+
+      bulk::detail::pin_this_thread(slice->cpu);
+
+      for(volatile char *page = slice->first; page < slice->last; page += slice->page_size)
+      {
+        *page = 0;
+      }
+
+      return 0;
+    }
+
+    // worker i first touches the pages in [boundaries[i], boundaries[i+1])
+    void prefault(char *ptr, std::size_t size, std::size_t page_size, const std::vector<std::size_t> &boundaries)
+    {
+      std::size_t num_threads = boundaries.size() - 1;
+
+      std::vector<prefault_slice> slices(num_threads);
+      std::vector<pthread_t> threads(num_threads);
+      std::vector<bool> joinable(num_threads, false);
+
+      for(std::size_t i = 0; i < num_threads; ++i)
+      {
+        slices[i].first = ptr + boundaries[i];
+        slices[i].last  = ptr + (boundaries[i+1] < size ? boundaries[i+1] : size);
+        slices[i].page_size = page_size;
+        slices[i].cpu = m_placement.cpu_for_worker(i);
+
+        // the calling thread keeps its affinity, so every slice gets a thread of its own
+        if(slices[i].first < slices[i].last)
+        {
+          joinable[i] = pthread_create(&threads[i], 0, prefault_slice_thread, &slices[i]) == 0;
+
+          if(!joinable[i])
+          {
+            // no thread, so fault the slice here without pinning
+            for(volatile char *page = slices[i].first; page < slices[i].last; page += page_size)
+            {
+              *page = 0;
+            }
+          }
+        }
+      }
+
+      for(std::size_t i = 0; i < num_threads; ++i)
+      {
+        if(joinable[i])
+        {
+          pthread_join(threads[i], 0);
+        }
+      }
+    }
+
+    page_policy m_policy;
+    page_policy m_last_policy;
+    unsigned int m_num_workers;
+    bulk::detail::affinity m_placement;
+};
+
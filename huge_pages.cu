@@ -0,0 +1,226 @@
+#include "huge_page_allocator.hpp"
+#include "time_invocation_cuda.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+// compares host sort & merge by key over buffers in small, transparent huge & explicit huge pages,
+// with keys, values & their ping-pong buffers laid out like stable_merge_sort_by_key's:
+// huge_pages [number of keys]
+//
+// dTLB misses are counted with perf_event_open, which may need
+// /proc/sys/kernel/perf_event_paranoid <= 2
+
+class dtlb_miss_counter
+{
+  public:
+    dtlb_miss_counter()
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      m_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~dtlb_miss_counter()
+    {
+      if(m_fd >= 0) close(m_fd);
+    }
+
+    void start()
+    {
+      if(m_fd < 0) return;
+
+      ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    // returns -1 when the counter is unavailable
+    long long stop()
+    {
+      if(m_fd < 0) return -1;
+
+      ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+
+      long long result = 0;
+      if(read(m_fd, &result, sizeof(result)) != sizeof(result)) return -1;
+
+      return result;
+    }
+
+  private:
+    int m_fd;
+};
+
+
+void merge_by_key(const int *keys1, const int *values1, size_t n1,
+                  const int *keys2, const int *values2, size_t n2,
+                  int *keys_result, int *values_result)
+{
+  size_t i = 0, j = 0;
+
+  while(i < n1 && j < n2)
+  {
+    // stable: take from the first list on ties
+    if(keys2[j] < keys1[i])
+    {
+      *keys_result++ = keys2[j];
+      *values_result++ = values2[j++];
+    }
+    else
+    {
+      *keys_result++ = keys1[i];
+      *values_result++ = values1[i++];
+    }
+  }
+
+  std::copy(keys1 + i, keys1 + n1, keys_result);
+  std::copy(values1 + i, values1 + n1, values_result);
+  std::copy(keys2 + j, keys2 + n2, keys_result + (n1 - i));
+  std::copy(values2 + j, values2 + n2, values_result + (n1 - i));
+}
+
+
+bool pair_less(const std::pair<int,int> &x, const std::pair<int,int> &y)
+{
+  return x.first < y.first;
+}
+
+
+// sorts tiles, then merges pairs of runs back & forth between the source & pong buffers
+void merge_sort_by_key(int *keys, int *values, int *keys_pong, int *values_pong, size_t n)
+{
+  const size_t tile_size = 128 * 7;
+
+  std::vector<std::pair<int,int> > tile(tile_size);
+
+  for(size_t first = 0; first < n; first += tile_size)
+  {
+    size_t last = std::min(n, first + tile_size);
+
+    for(size_t i = first; i < last; ++i)
+    {
+      tile[i - first] = std::make_pair(keys[i], values[i]);
+    }
+
+    std::stable_sort(tile.begin(), tile.begin() + (last - first), pair_less);
+
+    for(size_t i = first; i < last; ++i)
+    {
+      keys[i] = tile[i - first].first;
+      values[i] = tile[i - first].second;
+    }
+  }
+
+  bool ping = true;
+
+  for(size_t run = tile_size; run < n; run *= 2, ping = !ping)
+  {
+    int *keys_src     = ping ? keys : keys_pong;
+    int *values_src   = ping ? values : values_pong;
+    int *keys_dst     = ping ? keys_pong : keys;
+    int *values_dst   = ping ? values_pong : values;
+
+    for(size_t first = 0; first < n; first += 2 * run)
+    {
+      size_t mid  = std::min(n, first + run);
+      size_t last = std::min(n, first + 2 * run);
+
+      merge_by_key(keys_src + first, values_src + first, mid - first,
+                   keys_src + mid,   values_src + mid,   last - mid,
+                   keys_dst + first, values_dst + first);
+    }
+  }
+
+  if(!ping)
+  {
+    std::copy(keys_pong, keys_pong + n, keys);
+    std::copy(values_pong, values_pong + n, values);
+  }
+}
+
+
+const char *policy_name(huge_page_allocator::page_policy policy)
+{
+  return policy == huge_page_allocator::explicit_huge_pages    ? "explicit" :
+         policy == huge_page_allocator::transparent_huge_pages ? "transparent" :
+                                                                 "small";
+}
+
+
+void measure(huge_page_allocator::page_policy policy, size_t n)
+{
+  huge_page_allocator alloc(policy);
+
+  double start = wall_clock_ms();
+
+  int *keys        = reinterpret_cast<int*>(alloc.allocate(n * sizeof(int)));
+  int *values      = reinterpret_cast<int*>(alloc.allocate(n * sizeof(int)));
+  int *keys_pong   = reinterpret_cast<int*>(alloc.allocate(n * sizeof(int)));
+  int *values_pong = reinterpret_cast<int*>(alloc.allocate(n * sizeof(int)));
+
+  double allocate_msecs = wall_clock_ms() - start;
+
+  std::srand(13);
+  for(size_t i = 0; i < n; ++i)
+  {
+    keys[i] = std::rand();
+    values[i] = i;
+  }
+
+  dtlb_miss_counter counter;
+
+  counter.start();
+  start = wall_clock_ms();
+  // sort each half, so the merge below has two lists to merge
+  merge_sort_by_key(keys, values, keys_pong, values_pong, n / 2);
+  merge_sort_by_key(keys + n / 2, values + n / 2, keys_pong + n / 2, values_pong + n / 2, n - n / 2);
+  double sort_msecs = wall_clock_ms() - start;
+  long long sort_misses = counter.stop();
+
+  // merge the sorted halves into the pong buffers
+  counter.start();
+  start = wall_clock_ms();
+  merge_by_key(keys, values, n / 2, keys + n / 2, values + n / 2, n - n / 2, keys_pong, values_pong);
+  double merge_msecs = wall_clock_ms() - start;
+  long long merge_misses = counter.stop();
+
+  std::printf("%12s (got %11s): allocate & prefault %8.1f ms, sort %9.1f ms %14lld dTLB misses, merge %8.1f ms %14lld dTLB misses\n",
+              policy_name(policy), policy_name(alloc.last_policy()),
+              allocate_msecs,
+              sort_msecs, sort_misses,
+              merge_msecs, merge_misses);
+
+  alloc.deallocate(reinterpret_cast<char*>(keys), n * sizeof(int));
+  alloc.deallocate(reinterpret_cast<char*>(values), n * sizeof(int));
+  alloc.deallocate(reinterpret_cast<char*>(keys_pong), n * sizeof(int));
+  alloc.deallocate(reinterpret_cast<char*>(values_pong), n * sizeof(int));
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t n = 100000000;
+  if(argc > 1) n = std::atol(argv[1]);
+
+  std::printf("%lu keys, -1 means the counter is unavailable\n", static_cast<unsigned long>(n));
+
+  measure(huge_page_allocator::small_pages, n);
+  measure(huge_page_allocator::transparent_huge_pages, n);
+  measure(huge_page_allocator::explicit_huge_pages, n);
+
+  return 0;
+}
+
@@ -0,0 +1,205 @@
+#include <bulk/malloc.hpp>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// runs the group heap's allocators through the same random sequences of allocations &
+// deallocations on the host, checks each allocation's bounds, alignment & contents, and
+// compares the allocators' failures, then checks that the on-chip heap's lock-free arena takes
+// only as much of the heap as its agents use: malloc_fuzz [number of sequences] [operations per sequence]
+
+
+struct live_allocation
+{
+  unsigned char *ptr;
+  size_t size;
+  unsigned char tag;
+};
+
+
+struct fuzz_statistics
+{
+  unsigned int num_allocations;
+  unsigned int num_failures;
+};
+
+
+// each live allocation is filled with its own tag, so an allocation which overlaps
+// another, or a block header written over live data, changes some allocation's tag
+void check_contents(const live_allocation &a)
+{
+  for(size_t i = 0; i < a.size; ++i)
+  {
+    assert(a.ptr[i] == a.tag);
+  }
+}
+
+
+template<typename Allocator>
+fuzz_statistics fuzz(unsigned int seed, size_t arena_size, unsigned int max_live, unsigned int num_operations)
+{
+  std::vector<double> arena(arena_size / sizeof(double));
+  unsigned char *arena_begin = reinterpret_cast<unsigned char*>(&arena[0]);
+
+  Allocator alloc(arena_begin, arena_size);
+
+  std::vector<live_allocation> live;
+  fuzz_statistics stats = {0, 0};
+
+  std::srand(seed);
+
+  for(unsigned int i = 0; i < num_operations; ++i)
+  {
+    if(live.empty() || (live.size() < max_live && std::rand() % 100 < 55))
+    {
+      size_t n = (std::rand() % 4 == 0) ? std::rand() % 2048 : std::rand() % 64;
+
+      // draw the tag whether or not the allocation succeeds, so that both allocators see the same sequence
+      unsigned char tag = std::rand();
+
+      unsigned char *ptr = reinterpret_cast<unsigned char*>(alloc.allocate(n));
+      ++stats.num_allocations;
+
+      if(ptr)
+      {
+        assert(arena_begin <= ptr && ptr + n <= arena_begin + arena_size);
+        assert((ptr - arena_begin) % 8 == 0);
+
+        std::memset(ptr, tag, n);
+
+        live_allocation a = {ptr, n, tag};
+        live.push_back(a);
+      }
+      else
+      {
+        ++stats.num_failures;
+      }
+    }
+    else
+    {
+      size_t j = std::rand() % live.size();
+
+      check_contents(live[j]);
+
+      alloc.deallocate(live[j].ptr);
+      live[j] = live.back();
+      live.pop_back();
+    }
+  }
+
+  for(size_t j = 0; j < live.size(); ++j)
+  {
+    check_contents(live[j]);
+    alloc.deallocate(live[j].ptr);
+  }
+
+  // once everything is freed, nothing has leaked: nearly the whole arena is allocatable again
+  void *everything = alloc.allocate(arena_size - 64);
+  assert(everything != 0);
+  alloc.deallocate(everything);
+
+  return stats;
+}
+
+
+// the agents' individual allocations grow the arena a slab at a time, and a collective
+// allocation which needs the arena's unused tail takes it back
+void test_arena()
+{
+  const size_t heap_size = 48 * 1024;
+  const size_t slab_size = heap_size / 32;
+
+  std::vector<double> heap(heap_size / sizeof(double));
+
+  bulk::detail::singleton_on_chip_allocator alloc(&heap[0], heap_size);
+
+  // the first individual allocation carves a single slab
+  std::vector<void*> individual(1, alloc.allocate(16));
+  assert(individual[0] != 0);
+  assert(alloc.unsafe_heap_size() <= slab_size + 16);
+
+  // the arena grows with the agents' demand
+  while(individual.size() < 300)
+  {
+    individual.push_back(alloc.allocate(16));
+    assert(individual.back() != 0);
+  }
+
+  size_t bytes_in_use = 300 * 16;
+  size_t arena_size = alloc.unsafe_heap_size();
+  assert(arena_size <= bytes_in_use + slab_size + 16);
+
+  // a collective allocation of everything the agents do not use succeeds once the arena is trimmed
+  void *collective = alloc.unsafe_allocate(heap_size - bytes_in_use - 64);
+  assert(collective != 0);
+
+  alloc.unsafe_deallocate(collective);
+
+  for(size_t i = 0; i < individual.size(); ++i)
+  {
+    alloc.deallocate(individual[i]);
+  }
+
+  // the empty arena goes back to the heap, so the whole heap is allocatable
+  collective = alloc.unsafe_allocate(heap_size - 64);
+  assert(collective != 0);
+  alloc.unsafe_deallocate(collective);
+
+  std::printf("%lu byte heap: the arena took %lu bytes for %lu bytes of individual allocations\n",
+              static_cast<unsigned long>(heap_size),
+              static_cast<unsigned long>(arena_size),
+              static_cast<unsigned long>(bytes_in_use));
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned int num_sequences = 100;
+  if(argc > 1) num_sequences = std::atoi(argv[1]);
+
+  unsigned int num_operations = 100000;
+  if(argc > 2) num_operations = std::atoi(argv[2]);
+
+  const unsigned int max_live = 64;
+
+  // an arena large enough for max_live of the largest allocations, & one which runs out
+  const size_t roomy_arena_size = 2 * max_live * (2048 + 16);
+  const size_t tight_arena_size = 16 * 1024;
+
+  fuzz_statistics first_fit_tight  = {0, 0};
+  fuzz_statistics size_class_tight = {0, 0};
+
+  for(unsigned int seed = 1; seed <= num_sequences; ++seed)
+  {
+    // with room to spare, neither allocator may fail
+    fuzz_statistics first_fit  = fuzz<bulk::detail::first_fit_allocator>(seed, roomy_arena_size, max_live, num_operations);
+    fuzz_statistics size_class = fuzz<bulk::detail::size_class_allocator>(seed, roomy_arena_size, max_live, num_operations);
+
+    assert(first_fit.num_failures == 0);
+    assert(size_class.num_failures == 0);
+    assert(first_fit.num_allocations == size_class.num_allocations);
+
+    // out of room, the allocators may fail different requests, but each must fail cleanly
+    first_fit  = fuzz<bulk::detail::first_fit_allocator>(seed, tight_arena_size, max_live, num_operations);
+    size_class = fuzz<bulk::detail::size_class_allocator>(seed, tight_arena_size, max_live, num_operations);
+
+    first_fit_tight.num_allocations  += first_fit.num_allocations;
+    first_fit_tight.num_failures     += first_fit.num_failures;
+    size_class_tight.num_allocations += size_class.num_allocations;
+    size_class_tight.num_failures    += size_class.num_failures;
+  }
+
+  std::printf("%u sequences of %u operations with at most %u live allocations\n", num_sequences, num_operations, max_live);
+  std::printf("%lu byte arena: no failures\n", static_cast<unsigned long>(roomy_arena_size));
+  std::printf("%lu byte arena: first fit failed %u of %u allocations, size class failed %u of %u\n",
+              static_cast<unsigned long>(tight_arena_size),
+              first_fit_tight.num_failures, first_fit_tight.num_allocations,
+              size_class_tight.num_failures, size_class_tight.num_allocations);
+
+  test_arena();
+
+  return 0;
+}
+
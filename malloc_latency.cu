@@ -0,0 +1,84 @@
+#include <bulk/malloc.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "time_invocation_cuda.hpp"
+
+// compares the group heap's allocators on the host with a random sequence of
+// small allocations & deallocations, like those the algorithms make of their heap
+// usage: malloc_latency [maximum live allocations] [arena bytes]
+//
+// the live set is bounded & the arena defaults to a size neither allocator
+// exhausts, so both time the same sequence of successful operations. failures
+// are reported beside the timings, because a failed allocation returns early &
+// makes an allocator look faster than it is
+
+const size_t max_allocation_size = 2048;
+
+template<typename Allocator>
+void measure(const char *name, size_t arena_size, unsigned int max_live, unsigned int num_operations)
+{
+  std::vector<double> arena(arena_size / sizeof(double));
+  Allocator alloc(&arena[0], arena_size);
+
+  std::vector<void*> live;
+  unsigned int num_allocations = 0;
+  unsigned int num_failures = 0;
+
+  std::srand(13);
+
+  double start = wall_clock_ns();
+
+  for(unsigned int i = 0; i < num_operations; ++i)
+  {
+    if(live.empty() || (live.size() < max_live && std::rand() % 100 < 55))
+    {
+      size_t n = (std::rand() % 4 == 0) ? std::rand() % max_allocation_size : std::rand() % 64;
+
+      void *ptr = alloc.allocate(n);
+      ++num_allocations;
+
+      if(ptr) live.push_back(ptr);
+      else    ++num_failures;
+    }
+    else
+    {
+      size_t j = std::rand() % live.size();
+
+      alloc.deallocate(live[j]);
+      live[j] = live.back();
+      live.pop_back();
+    }
+  }
+
+  double elapsed_ns = wall_clock_ns() - start;
+
+  for(size_t j = 0; j < live.size(); ++j)
+  {
+    alloc.deallocate(live[j]);
+  }
+
+  std::printf("%12s %10.1f ns per operation %10u of %u allocations failed%s\n",
+              name, elapsed_ns / num_operations, num_failures, num_allocations,
+              num_failures ? " (timing is not comparable)" : "");
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int max_live = 64;
+  if(argc > 1) max_live = std::atoi(argv[1]);
+
+  // room for max_live of the largest allocations, plus as much again for fragmentation
+  size_t arena_size = 2 * max_live * (max_allocation_size + 16);
+  if(argc > 2) arena_size = std::atol(argv[2]);
+
+  const unsigned int num_operations = 1 << 20;
+
+  std::printf("at most %u live allocations in a %lu byte arena\n", max_live, static_cast<unsigned long>(arena_size));
+
+  measure<bulk::detail::first_fit_allocator>("first fit", arena_size, max_live, num_operations);
+  measure<bulk::detail::size_class_allocator>("size class", arena_size, max_live, num_operations);
+
+  return 0;
+}
+
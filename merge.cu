@@ -7,6 +7,7 @@
 #include <bulk/bulk.hpp>
 #include "join_iterator.hpp"
 #include "time_invocation_cuda.hpp"
+#include "caching_allocator.hpp"
 
 
 template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size,typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename Compare>
@@ -124,11 +125,13 @@ struct locate_merge_path
 };
 
 
-template<typename RandomAccessIterator1,
+template<typename Allocator,
+         typename RandomAccessIterator1,
          typename RandomAccessIterator2,
          typename RandomAccessIterator3,
          typename Compare>
-RandomAccessIterator3 my_merge(RandomAccessIterator1 first1,
+RandomAccessIterator3 my_merge(Allocator &alloc,
+                               RandomAccessIterator1 first1,
                                RandomAccessIterator1 last1,
                                RandomAccessIterator2 first2,
                                RandomAccessIterator2 last2,
@@ -148,8 +151,7 @@ RandomAccessIterator3 my_merge(RandomAccessIterator1 first1,
   difference_type n = (last1 - first1) + (last2 - first2);
   difference_type num_groups = (n + tile_size - 1) / tile_size;
 
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<size_type,thrust::cuda::tag> merge_paths(t, num_groups + 1);
+  temporary_buffer<size_type,Allocator> merge_paths(alloc, num_groups + 1);
 
   thrust::tabulate(merge_paths.begin(), merge_paths.end(), locate_merge_path<size_type,RandomAccessIterator1,RandomAccessIterator2,Compare>(tile_size,first1,last1,first2,last2,comp));
 
@@ -162,6 +164,22 @@ RandomAccessIterator3 my_merge(RandomAccessIterator1 first1,
 } // end merge()
 
 
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 my_merge(RandomAccessIterator1 first1,
+                               RandomAccessIterator1 last1,
+                               RandomAccessIterator2 first2,
+                               RandomAccessIterator2 last2,
+                               RandomAccessIterator3 result,
+                               Compare comp)
+{
+  cuda_allocator alloc;
+  return my_merge(alloc, first1, last1, first2, last2, result, comp);
+} // end merge()
+
+
 template<typename T>
 void my_merge(const thrust::device_vector<T> *a,
               const thrust::device_vector<T> *b,
@@ -174,6 +192,20 @@ void my_merge(const thrust::device_vector<T> *a,
 }
 
 
+template<typename T>
+void my_cached_merge(const thrust::device_vector<T> *a,
+                     const thrust::device_vector<T> *b,
+                     thrust::device_vector<T> *c,
+                     caching_allocator<> *alloc)
+{
+  my_merge(*alloc,
+           a->begin(), a->end(),
+           b->begin(), b->end(),
+           c->begin(),
+           thrust::less<T>());
+}
+
+
 template<typename T>
 void sean_merge(const thrust::device_vector<T> *a,
                 const thrust::device_vector<T> *b,
@@ -240,6 +272,10 @@ void compare(size_t n)
   my_merge(&a, &b, &c);
   double my_msecs = time_invocation_cuda(50, my_merge<T>, &a, &b, &c);
 
+  caching_allocator<> alloc;
+  my_cached_merge(&a, &b, &c, &alloc);
+  double cached_msecs = time_invocation_cuda(50, my_cached_merge<T>, &a, &b, &c, &alloc);
+
   sean_merge(&a, &b, &c);
   double sean_msecs = time_invocation_cuda(50, sean_merge<T>, &a, &b, &c);
 
@@ -249,6 +285,7 @@ void compare(size_t n)
   std::cout << "Sean's time: " << sean_msecs << " ms" << std::endl;
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "Cached time:   " << cached_msecs << " ms" << std::endl;
 
   std::cout << "Performance relative to Sean: " << sean_msecs / my_msecs << std::endl;
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
@@ -7,6 +7,7 @@
 #include <bulk/bulk.hpp>
 #include "time_invocation_cuda.hpp"
 #include "join_iterator.hpp"
+#include "caching_allocator.hpp"
 
 
 struct stable_sort_each_kernel
@@ -147,8 +148,8 @@ void locate_merge_paths_(thrust::system::cuda::execution_policy<DerivedPolicy> &
 }
 
 
-template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
-void stable_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, Compare comp)
+template<typename Allocator, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_merge_sort_by_key(Allocator &alloc, RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, Compare comp)
 {
   typename thrust::iterator_difference<RandomAccessIterator1>::type n = keys_last - keys_first;
 
@@ -167,21 +168,21 @@ void stable_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIter
   size_type num_groups = (n + tilesize - 1) / tilesize;
   size_type num_passes = thrust::detail::log2_ri(num_groups);
 
-  size_type heap_size = tilesize * thrust::max(sizeof(key_type), sizeof(value_type));
-  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), stable_sort_each_kernel(), bulk::root.this_exec, keys_first, values_first, n, comp);
+  bulk::heap_requirement<bulk::stable_sort_by_key_tag,groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2> sort_heap_size;
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, sort_heap_size), stable_sort_each_kernel(), bulk::root.this_exec, keys_first, values_first, n, comp);
 
   // XXX forward exec from parameters here
   thrust::cuda::tag exec;
 
   // ping being true means the latest data is in the source array
   bool ping = true;
-  thrust::detail::temporary_array<key_type,thrust::cuda::tag>   keys_pong(exec, n);
-  thrust::detail::temporary_array<value_type,thrust::cuda::tag> values_pong(exec, n);
+  temporary_buffer<key_type,Allocator>   keys_pong(alloc, n);
+  temporary_buffer<value_type,Allocator> values_pong(alloc, n);
 
-  thrust::detail::temporary_array<size_type,thrust::cuda::tag> merge_paths(exec, num_groups + 1);
+  temporary_buffer<size_type,Allocator> merge_paths(alloc, num_groups + 1);
   
   // merge_by_key_kernel's heap requirements differ
-  heap_size = tilesize * thrust::max(sizeof(key_type), sizeof(size_type));
+  bulk::heap_requirement<bulk::merge_by_key_tag,groupsize,grainsize,RandomAccessIterator1> heap_size;
 
   for(size_type pass = 0; pass < num_passes; ++pass, ping = !ping) 
   {
@@ -209,6 +210,14 @@ void stable_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIter
 }
 
 
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, Compare comp)
+{
+  cuda_allocator alloc;
+  stable_merge_sort_by_key(alloc, keys_first, keys_last, values_first, comp);
+}
+
+
 struct my_less
 {
   template<typename T>
@@ -232,6 +241,19 @@ void my_sort_by_key(const thrust::device_vector<T> *unsorted_keys,
 }
 
 
+template<typename T>
+void my_cached_sort_by_key(const thrust::device_vector<T> *unsorted_keys,
+                           const thrust::device_vector<T> *unsorted_values,
+                           thrust::device_vector<T> *sorted_keys,
+                           thrust::device_vector<T> *sorted_values,
+                           caching_allocator<> *alloc)
+{
+  *sorted_keys = *unsorted_keys;
+  *sorted_values = *unsorted_values;
+  stable_merge_sort_by_key(*alloc, sorted_keys->begin(), sorted_keys->end(), sorted_values->begin(), my_less());
+}
+
+
 template<typename T>
 void sean_sort_by_key(const thrust::device_vector<T> *unsorted_keys,
                       const thrust::device_vector<T> *unsorted_values,                    
@@ -297,6 +319,10 @@ void compare(size_t n)
   my_sort_by_key(&unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
   double my_msecs = time_invocation_cuda(20, my_sort_by_key<T>, &unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
 
+  caching_allocator<> alloc;
+  my_cached_sort_by_key(&unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values, &alloc);
+  double cached_msecs = time_invocation_cuda(20, my_cached_sort_by_key<T>, &unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values, &alloc);
+
   sean_sort_by_key(&unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
   double sean_msecs = time_invocation_cuda(20, sean_sort_by_key<T>, &unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
 
@@ -306,6 +332,7 @@ void compare(size_t n)
   std::cout << "Sean's time: " << sean_msecs << " ms" << std::endl;
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "Cached time:   " << cached_msecs << " ms" << std::endl;
 
   std::cout << "Performance relative to Sean: " << sean_msecs / my_msecs << std::endl;
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
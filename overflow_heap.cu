@@ -0,0 +1,212 @@
+#include <bulk/malloc.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
+#include "time_invocation_cuda.hpp"
+
+// simulates a launch whose groups requested more heap than they were granted on the host,
+// with one thread per group, and compares falling back to malloc with falling back to each
+// group's slice of an overflow_heap:
+// overflow_heap [requested heap bytes] [granted heap bytes] [number of groups]
+
+struct fallback_statistics
+{
+  unsigned int num_on_chip_allocations;
+  unsigned int num_overflow_allocations;
+  unsigned int num_global_allocations;
+  unsigned int num_failures;
+  unsigned int num_corruptions;
+};
+
+
+struct group
+{
+  bulk::detail::singleton_on_chip_allocator *alloc;
+  char *heap_begin, *heap_end;
+  unsigned int index;
+  unsigned int num_operations;
+  size_t requested_heap_size;
+  fallback_statistics stats;
+};
+
+
+// like shmalloc, tries the on-chip heap, then the overflow slice, then malloc
+void *allocate(group &g, size_t n)
+{
+  void *result = g.alloc->allocate(n);
+
+  if(result)
+  {
+    ++g.stats.num_on_chip_allocations;
+    return result;
+  }
+
+  result = g.alloc->overflow_allocate(n);
+
+  if(result)
+  {
+    ++g.stats.num_overflow_allocations;
+    return result;
+  }
+
+  result = std::malloc(n);
+
+  if(result) ++g.stats.num_global_allocations;
+  else       ++g.stats.num_failures;
+
+  return result;
+}
+
+
+// like shfree
+void deallocate(group &g, void *ptr)
+{
+  char *p = reinterpret_cast<char*>(ptr);
+
+  if(g.heap_begin <= p && p < g.heap_end)
+  {
+    g.alloc->deallocate(ptr);
+  }
+  else if(!g.alloc->overflow_deallocate(ptr))
+  {
+    std::free(ptr);
+  }
+}
+
+
+// allocates & frees like the algorithms, whose scratch grows with the heap they request,
+// and tags the ends of each allocation with the group's index to catch slices which overlap
+void *run_group(void *arg)
+{
+  group &g = *reinterpret_cast<group*>(arg);
+
+  std::vector<std::pair<char*,size_t> > live;
+  unsigned int seed = g.index + 13;
+
+  for(unsigned int i = 0; i < g.num_operations; ++i)
+  {
+    if(live.size() < 4 && (live.empty() || rand_r(&seed) % 2))
+    {
+      size_t n = 1 + rand_r(&seed) % (g.requested_heap_size / 4);
+
+      char *ptr = reinterpret_cast<char*>(allocate(g, n));
+
+      if(ptr)
+      {
+        ptr[0] = ptr[n-1] = g.index;
+        live.push_back(std::make_pair(ptr, n));
+      }
+    }
+    else
+    {
+      size_t j = rand_r(&seed) % live.size();
+
+      char *ptr = live[j].first;
+      size_t n = live[j].second;
+
+      if(ptr[0] != static_cast<char>(g.index) || ptr[n-1] != static_cast<char>(g.index))
+      {
+        ++g.stats.num_corruptions;
+      }
+
+      deallocate(g, ptr);
+      live[j] = live.back();
+      live.pop_back();
+    }
+  }
+
+  for(size_t j = 0; j < live.size(); ++j)
+  {
+    deallocate(g, live[j].first);
+  }
+
+  return 0;
+}
+
+
+void measure(const char *name, size_t requested_heap_size, size_t granted_heap_size, unsigned int num_groups, bool use_overflow_heap)
+{
+  const unsigned int num_operations = 1 << 16;
+
+  // each group's "on-chip" heap
+  std::vector<std::vector<double> > heaps(num_groups, std::vector<double>(granted_heap_size / sizeof(double) + 1));
+
+  // the launch's overflow heap
+  size_t slice_size = use_overflow_heap ? bulk::detail::overflow_heap::choose_slice_size(requested_heap_size, granted_heap_size) : 0;
+  std::vector<double> buffer(bulk::detail::overflow_heap::buffer_size(slice_size, num_groups) / sizeof(double) + 1);
+  bulk::detail::overflow_heap overflow(slice_size ? &buffer[0] : 0, slice_size);
+
+  std::vector<group> groups(num_groups);
+
+  for(unsigned int i = 0; i < num_groups; ++i)
+  {
+    groups[i].alloc = new bulk::detail::singleton_on_chip_allocator(&heaps[i][0], granted_heap_size, overflow.slice(i), overflow.slice_size());
+    groups[i].heap_begin = reinterpret_cast<char*>(&heaps[i][0]);
+    groups[i].heap_end = groups[i].heap_begin + granted_heap_size;
+    groups[i].index = i;
+    groups[i].num_operations = num_operations;
+    groups[i].requested_heap_size = requested_heap_size;
+    std::memset(&groups[i].stats, 0, sizeof(fallback_statistics));
+  }
+
+  std::vector<pthread_t> threads(num_groups);
+
+  double start = wall_clock_ns();
+
+  for(unsigned int i = 0; i < num_groups; ++i)
+  {
+    pthread_create(&threads[i], 0, run_group, &groups[i]);
+  }
+
+  for(unsigned int i = 0; i < num_groups; ++i)
+  {
+    pthread_join(threads[i], 0);
+  }
+
+  double elapsed_ns = wall_clock_ns() - start;
+
+  fallback_statistics total;
+  std::memset(&total, 0, sizeof(fallback_statistics));
+
+  for(unsigned int i = 0; i < num_groups; ++i)
+  {
+    total.num_on_chip_allocations  += groups[i].stats.num_on_chip_allocations;
+    total.num_overflow_allocations += groups[i].stats.num_overflow_allocations;
+    total.num_global_allocations   += groups[i].stats.num_global_allocations;
+    total.num_failures             += groups[i].stats.num_failures;
+    total.num_corruptions          += groups[i].stats.num_corruptions;
+
+    delete groups[i].alloc;
+  }
+
+  std::printf("%10s %8.1f ns per operation, allocations: %9u on chip %9u overflow %9u global %6u failed %6u corrupt\n",
+              name, elapsed_ns / (num_groups * num_operations),
+              total.num_on_chip_allocations, total.num_overflow_allocations, total.num_global_allocations,
+              total.num_failures, total.num_corruptions);
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t requested_heap_size = 64 * 1024;
+  size_t granted_heap_size = 16 * 1024;
+  unsigned int num_groups = 8;
+
+  if(argc > 1) requested_heap_size = std::atol(argv[1]);
+  if(argc > 2) granted_heap_size = std::atol(argv[2]);
+  if(argc > 3) num_groups = std::atoi(argv[3]);
+
+  std::printf("%u groups requested %lu heap bytes & were granted %lu, so each overflow slice is %lu bytes\n",
+              num_groups,
+              static_cast<unsigned long>(requested_heap_size),
+              static_cast<unsigned long>(granted_heap_size),
+              static_cast<unsigned long>(bulk::detail::overflow_heap::choose_slice_size(requested_heap_size, granted_heap_size)));
+
+  measure("malloc", requested_heap_size, granted_heap_size, num_groups, false);
+  measure("overflow", requested_heap_size, granted_heap_size, num_groups, true);
+
+  return 0;
+}
+
@@ -0,0 +1,295 @@
+#include <bulk/detail/cuda_launcher/parameter_arena.hpp>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+// runs bulk::detail::parameter_arena through a fake runtime whose fences complete only when
+// the test says so, and checks wraparound, back-pressure, the oversized fallback & fences which
+// cannot be recorded: parameter_arena [number of allocations]
+
+
+// fence i is complete once completed[i] is set, by the test or by wait()
+struct fake_runtime
+{
+  typedef int stream_type;
+  typedef int fence_type;
+
+  std::vector<bool> *completed;
+  std::vector<int>  *waited;
+  int *num_buffers;
+
+  // when set, record_fence throws
+  bool *fail_fences;
+
+  // the streams synchronized in place of fences which could not be recorded
+  std::vector<int> *synchronized;
+
+  // when set, wait() uses the arena, which it can only do if allocate() let go of its lock
+  bulk::detail::parameter_arena<fake_runtime> **arena;
+
+  void *allocate(std::size_t n)
+  {
+    ++*num_buffers;
+    return std::malloc(n);
+  }
+
+  void deallocate(void *ptr)
+  {
+    --*num_buffers;
+    std::free(ptr);
+  }
+
+  int record_fence(int)
+  {
+    if(*fail_fences) throw std::runtime_error("fake_runtime::record_fence");
+
+    completed->push_back(false);
+    return completed->size() - 1;
+  }
+
+  void synchronize(int s)
+  {
+    synchronized->push_back(s);
+  }
+
+  bool is_complete(int f)
+  {
+    return (*completed)[f];
+  }
+
+  // the arena only blocks when it is out of room, so the fence it blocks on must be the oldest
+  void wait(int f);
+
+  void destroy_fence(int) {}
+};
+
+
+typedef bulk::detail::parameter_arena<fake_runtime> arena_type;
+
+
+void fake_runtime::wait(int f)
+{
+  if(*arena)
+  {
+    (*arena)->bytes_in_use();
+  }
+
+  waited->push_back(f);
+  (*completed)[f] = true;
+}
+
+
+struct live_allocation
+{
+  std::size_t first, last;
+  int fence;
+};
+
+
+// the fences which have not completed, oldest first
+std::vector<int> incomplete_fences(const std::vector<bool> &completed)
+{
+  std::vector<int> result;
+
+  for(std::size_t f = 0; f < completed.size(); ++f)
+  {
+    if(!completed[f]) result.push_back(f);
+  }
+
+  return result;
+}
+
+
+// returns the oldest fence which has not completed, or -1
+int oldest_incomplete_fence(const std::vector<bool> &completed)
+{
+  for(std::size_t f = 0; f < completed.size(); ++f)
+  {
+    if(!completed[f]) return f;
+  }
+
+  return -1;
+}
+
+
+void test_wraparound_and_back_pressure(std::size_t num_allocations)
+{
+  std::vector<bool> completed;
+  std::vector<int> waited, synchronized;
+  int num_buffers = 0;
+  bool fail_fences = false;
+  arena_type *arena_ptr = 0;
+
+  fake_runtime runtime = {&completed, &waited, &num_buffers, &fail_fences, &synchronized, &arena_ptr};
+
+  const std::size_t capacity = 1000;
+
+  {
+    arena_type arena(capacity, runtime);
+    arena_ptr = &arena;
+
+    // merely creating the arena allocates nothing
+    assert(num_buffers == 0);
+
+    char *buffer = 0;
+    std::vector<live_allocation> live;
+
+    for(std::size_t i = 0; i < num_allocations; ++i)
+    {
+      std::size_t n = 1 + std::rand() % 300;
+      std::size_t alignment = std::size_t(1) << (std::rand() % 5);
+
+      std::vector<int> outstanding = incomplete_fences(completed);
+      std::size_t num_waits = waited.size();
+
+      char *ptr = reinterpret_cast<char*>(arena.allocate(n, alignment));
+      assert(ptr);
+
+      if(!buffer) buffer = ptr;
+
+      std::size_t first = ptr - buffer;
+
+      // allocations are aligned & never straddle the end of the ring
+      assert(first % alignment == 0);
+      assert(first + n <= capacity);
+
+      // when the ring was full, allocate() blocked on the outstanding fences oldest first
+      for(std::size_t j = num_waits; j < waited.size(); ++j)
+      {
+        assert(waited[j] == outstanding[j - num_waits]);
+      }
+
+      // a slot is reused only after the fence of the work which read it has completed
+      for(std::size_t j = 0; j < live.size(); ++j)
+      {
+        if(!completed[live[j].fence])
+        {
+          assert(first + n <= live[j].first || live[j].last <= first);
+        }
+      }
+
+      arena.release(ptr, 0);
+
+      live_allocation a = {first, first + n, static_cast<int>(completed.size()) - 1};
+      live.push_back(a);
+
+      // the device finishes some of the outstanding work, in order
+      if(std::rand() % 3 == 0)
+      {
+        int f = oldest_incomplete_fence(completed);
+        if(f >= 0) completed[f] = true;
+      }
+
+      // forget allocations whose work has completed
+      std::vector<live_allocation> still_live;
+      for(std::size_t j = 0; j < live.size(); ++j)
+      {
+        if(!completed[live[j].fence]) still_live.push_back(live[j]);
+      }
+      live.swap(still_live);
+    }
+
+    bulk::detail::parameter_arena_statistics stats = arena.statistics();
+
+    assert(stats.allocations == num_allocations);
+    assert(stats.wraps > 0);
+    assert(stats.stalls > 0);
+    assert(stats.oversized == 0);
+    assert(num_buffers == 1);
+
+    arena_ptr = 0;
+
+    std::printf("%zu allocations of up to 300 bytes from a ring of %zu bytes: %zu wraps, %zu stalls\n",
+                stats.allocations, capacity, stats.wraps, stats.stalls);
+  }
+
+  // the arena waits for its outstanding work & returns its buffer
+  assert(oldest_incomplete_fence(completed) == -1);
+  assert(num_buffers == 0);
+}
+
+
+void test_oversized()
+{
+  std::vector<bool> completed;
+  std::vector<int> waited, synchronized;
+  int num_buffers = 0;
+  bool fail_fences = false;
+  arena_type *arena_ptr = 0;
+
+  fake_runtime runtime = {&completed, &waited, &num_buffers, &fail_fences, &synchronized, &arena_ptr};
+
+  arena_type arena(100, runtime);
+
+  // triple_chevron_launcher marshals a task through make_parameter when its slot is null
+  {
+    bulk::detail::scoped_parameter_allocation<arena_type> slot(arena, 101, 8, 0);
+    assert(slot.get() == 0);
+  }
+
+  // a null slot records no fence & the arena never touched the runtime
+  assert(completed.empty());
+  assert(num_buffers == 0);
+  assert(arena.statistics().oversized == 1);
+
+  // a task which fills the whole arena still fits
+  {
+    bulk::detail::scoped_parameter_allocation<arena_type> slot(arena, 100, 8, 0);
+    assert(slot.get() != 0);
+  }
+
+  assert(completed.size() == 1);
+
+  std::printf("tasks larger than the arena fall back to make_parameter\n");
+}
+
+
+void test_failed_fence()
+{
+  std::vector<bool> completed;
+  std::vector<int> waited, synchronized;
+  int num_buffers = 0;
+  bool fail_fences = false;
+  arena_type *arena_ptr = 0;
+
+  fake_runtime runtime = {&completed, &waited, &num_buffers, &fail_fences, &synchronized, &arena_ptr};
+
+  arena_type arena(100, runtime);
+
+  // the destructor of a slot whose fence cannot be recorded does not throw,
+  // but synchronizes the slot's stream & recycles its bytes at once
+  fail_fences = true;
+  {
+    bulk::detail::scoped_parameter_allocation<arena_type> slot(arena, 60, 8, 7);
+    assert(slot.get() != 0);
+  }
+
+  assert(synchronized.size() == 1 && synchronized[0] == 7);
+  assert(arena.bytes_in_use() == 0);
+
+  // so the next task fills the whole arena without waiting
+  fail_fences = false;
+  {
+    bulk::detail::scoped_parameter_allocation<arena_type> slot(arena, 100, 8, 0);
+    assert(slot.get() != 0);
+  }
+
+  assert(waited.empty());
+
+  std::printf("a fence which cannot be recorded is replaced by synchronizing its stream\n");
+}
+
+
+int main(int argc, char **argv)
+{
+  std::size_t num_allocations = 100000;
+  if(argc > 1) num_allocations = std::atol(argv[1]);
+
+  test_wraparound_and_back_pressure(num_allocations);
+  test_oversized();
+  test_failed_fence();
+
+  return 0;
+}
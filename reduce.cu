@@ -4,10 +4,15 @@
 #include <thrust/sequence.h>
 #include <thrust/reduce.h>
 #include <thrust/extrema.h>
+#include <bulk/mapped_range.hpp>
 #include <cassert>
+#include <cstdio>
 #include <iostream>
+#include <vector>
 #include "time_invocation_cuda.hpp"
 #include "decomposition.hpp"
+#include "caching_allocator.hpp"
+#include "chunked_reader.hpp"
 
 
 struct reduce_partitions
@@ -55,10 +60,25 @@ struct reduce_partitions
 };
 
 
-template<typename RandomAccessIterator,
+const int reduce_groupsize = 128;
+const int reduce_grainsize = 7;
+
+
+// the tiles of n elements which my_reduce's groups reduce
+template<typename Size>
+aligned_decomposition<Size> reduce_decomposition(Size n)
+{
+  const Size subscription = 10;
+
+  return make_tiled_decomposition<Size>(n, reduce_groupsize * reduce_grainsize, subscription * bulk::concurrent_group<>::hardware_concurrency());
+}
+
+
+template<typename Allocator,
+         typename RandomAccessIterator,
          typename T,
          typename BinaryOperation>
-T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
+T my_reduce(Allocator &alloc, RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
 {
   typedef typename thrust::iterator_difference<RandomAccessIterator>::type size_type;
 
@@ -66,23 +86,14 @@ T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, Binar
 
   if(n <= 0) return init;
 
-  const size_type groupsize = 128;
-  const size_type grainsize = 7;
-  const size_type tile_size = groupsize * grainsize;
-  const size_type num_tiles = (n + tile_size - 1) / tile_size;
-  const size_type subscription = 10;
-
   bulk::concurrent_group<
-    bulk::agent<grainsize>,
-    groupsize
+    bulk::agent<reduce_grainsize>,
+    reduce_groupsize
   > g;
 
-  const size_type num_groups = thrust::min<size_type>(subscription * g.hardware_concurrency(), num_tiles);
-
-  aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
+  aligned_decomposition<size_type> decomp = reduce_decomposition(n);
 
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<T,thrust::cuda::tag> partial_sums(t, decomp.size());
+  temporary_buffer<T,Allocator> partial_sums(alloc, decomp.size());
 
   // reduce into partial sums
   bulk::async(bulk::par(g, decomp.size()), reduce_partitions(), bulk::root.this_exec, first, decomp, partial_sums.begin(), init, binary_op);
@@ -97,6 +108,36 @@ T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, Binar
 } // end my_reduce()
 
 
+template<typename RandomAccessIterator,
+         typename T,
+         typename BinaryOperation>
+T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
+{
+  cuda_allocator alloc;
+  return my_reduce(alloc, first, last, init, binary_op);
+} // end my_reduce()
+
+
+// reduces a stream too large for memory in chunks of chunk_size elements
+// the running sum of the chunks so far is the init of the next chunk
+template<typename Allocator,
+         typename Source,
+         typename T,
+         typename BinaryOperation>
+T streaming_reduce(Allocator &alloc, Source source, std::size_t chunk_size, T init, BinaryOperation binary_op)
+{
+  chunked_reader<Source> reader(source, chunk_size);
+
+  while(std::size_t n = reader.next())
+  {
+    // my_reduce waits for its result, so the chunk is free for the reader afterwards
+    init = my_reduce(alloc, reader.begin(), reader.begin() + n, init, binary_op);
+  } // end while
+
+  return init;
+} // end streaming_reduce()
+
+
 template<typename T>
 T my_reduce(const thrust::device_vector<T> *vec)
 {
@@ -104,6 +145,13 @@ T my_reduce(const thrust::device_vector<T> *vec)
 }
 
 
+template<typename T>
+T my_cached_reduce(const thrust::device_vector<T> *vec, caching_allocator<> *alloc)
+{
+  return my_reduce(*alloc, vec->begin(), vec->end(), T(0), thrust::plus<T>());
+}
+
+
 template<typename T>
 T thrust_reduce(const thrust::device_vector<T> *vec)
 {
@@ -111,6 +159,89 @@ T thrust_reduce(const thrust::device_vector<T> *vec)
 }
 
 
+// reduces a column file in place, prefetching its pages along the tiles of my_reduce's groups
+template<typename T>
+T reduce_mapped_file(const char *filename)
+{
+  bulk::mapped_range<T> column(filename);
+
+  // an empty column has no decomposition to prefetch
+  if(column.empty()) return T(0);
+
+  column.prefetch(reduce_decomposition(column.size()));
+
+  return my_reduce(column.device_begin(), column.device_end(), T(0), thrust::plus<T>());
+}
+
+
+// reads a column file into a vector, copies it to the device & reduces it there
+template<typename T>
+T reduce_copied_file(const char *filename)
+{
+  std::vector<T> column;
+
+  if(std::FILE *f = std::fopen(filename, "rb"))
+  {
+    T buffer[4096];
+    size_t n = 0;
+
+    while((n = std::fread(buffer, sizeof(T), 4096, f)) > 0)
+    {
+      column.insert(column.end(), buffer, buffer + n);
+    }
+
+    std::fclose(f);
+  }
+
+  thrust::device_vector<T> vec(column.begin(), column.end());
+
+  return my_reduce(vec.begin(), vec.end(), T(0), thrust::plus<T>());
+}
+
+
+// reduces a column file in chunks, reading the next chunk while the last one is reduced
+template<typename T>
+T reduce_streamed_file(const char *filename)
+{
+  T result = 0;
+
+  if(std::FILE *f = std::fopen(filename, "rb"))
+  {
+    caching_allocator<> alloc;
+    result = streaming_reduce(alloc, file_source<T>(f), std::size_t(1) << 24, T(0), thrust::plus<T>());
+
+    std::fclose(f);
+  }
+
+  return result;
+}
+
+
+template<typename T>
+void compare_file(const char *filename)
+{
+  T mapped_result = reduce_mapped_file<T>(filename);
+  T copied_result = reduce_copied_file<T>(filename);
+  T streamed_result = reduce_streamed_file<T>(filename);
+
+  assert(mapped_result == copied_result);
+  assert(mapped_result == streamed_result);
+
+  // the first invocations warm the page cache, so these measure page-cache-speed startup
+  double mapped_msecs = time_invocation_cuda(1, reduce_mapped_file<T>, filename);
+  double copied_msecs = time_invocation_cuda(1, reduce_copied_file<T>, filename);
+  double streamed_msecs = time_invocation_cuda(1, reduce_streamed_file<T>, filename);
+
+  double gigabytes = double(bulk::mapped_range<T>(filename).size() * sizeof(T)) / (1 << 30);
+
+  std::cout << "result:        " << mapped_result << std::endl;
+  std::cout << "Mapped time:   " << mapped_msecs << " ms" << std::endl;
+  std::cout << "Copied time:   " << copied_msecs << " ms" << std::endl;
+  std::cout << "Streamed time: " << streamed_msecs << " ms" << std::endl;
+  std::cout << "Streamed rate: " << gigabytes / (streamed_msecs / 1000) << " GB/s" << std::endl;
+}
+
+
 template<typename T>
 void compare()
 {
@@ -122,15 +253,27 @@ void compare()
   my_reduce(&vec);
   double my_msecs = time_invocation_cuda(50, my_reduce<T>, &vec);
 
+  caching_allocator<> alloc;
+  my_cached_reduce(&vec, &alloc);
+  double cached_msecs = time_invocation_cuda(50, my_cached_reduce<T>, &vec, &alloc);
+
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "Cached time:   " << cached_msecs << " ms (" << alloc.statistics().num_upstream_allocations << " cudaMallocs)" << std::endl;
 
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
 }
 
 
-int main()
+// reduce [column file of ints]
+int main(int argc, char **argv)
 {
+  if(argc > 1)
+  {
+    compare_file<int>(argv[1]);
+    return 0;
+  }
+
   size_t n = 123456789;
 
   thrust::device_vector<int> vec(n);
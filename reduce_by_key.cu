@@ -6,11 +6,16 @@
 #include <thrust/iterator/constant_iterator.h>
 #include <thrust/detail/temporary_array.h>
 #include <thrust/random.h>
+#include <thrust/system/cuda/execution_policy.h>
 #include <bulk/bulk.hpp>
 #include "head_flags.hpp"
 #include "tail_flags.hpp"
 #include "time_invocation_cuda.hpp"
 #include "reduce_intervals.hpp"
+#include "caching_allocator.hpp"
+#include "chunked_reader.hpp"
+#include <bulk/mapped_range.hpp>
+#include <vector>
 
 
 struct reduce_by_key_kernel
@@ -173,14 +178,16 @@ void sum_tail_carries(Iterator1 interval_values_first,
 }
 
 
-template<typename RandomAccessIterator1,
+template<typename Allocator,
+         typename RandomAccessIterator1,
          typename RandomAccessIterator2,
          typename RandomAccessIterator3,
          typename RandomAccessIterator4,
          typename BinaryPredicate,
          typename BinaryFunction>
 thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
-  my_reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+  my_reduce_by_key(Allocator &alloc,
+                   RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
                    RandomAccessIterator2 values_first,
                    RandomAccessIterator3 keys_result,
                    RandomAccessIterator4 values_result,
@@ -196,15 +203,14 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
 
   if(n <= threshold_of_parallelism)
   {
-    thrust::cuda::tag t;
-    thrust::detail::temporary_array<size_type,thrust::cuda::tag> result_size_storage(t, 1);
+    temporary_buffer<size_type,Allocator> result_size_storage(alloc, 1);
 
     // XXX these sizes aren't actually optimal, but anything larger
     //     will cause sm_1x to run out of smem at compile time
     const int groupsize = (sizeof(value_type) == sizeof(int)) ? 512 : 256;
     const int grainsize = (sizeof(value_type) == sizeof(int)) ?   3 :   5;
 
-    size_type heap_size = groupsize * grainsize * (sizeof(size_type) + sizeof(value_type));
+    bulk::heap_requirement<bulk::reduce_by_key_tag,groupsize,grainsize,RandomAccessIterator2> heap_size;
     bulk::async(bulk::grid<groupsize,grainsize>(1,heap_size), reduce_by_key_kernel(), bulk::root.this_exec, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op, result_size_storage.begin());
 
     size_type result_size = result_size_storage[0];
@@ -234,25 +240,25 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
     size_type
   > tail_flags(keys_first, keys_last, pred);
 
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<size_type,thrust::cuda::tag> interval_output_offsets(t, decomp.size());
+  temporary_buffer<size_type,Allocator> interval_output_offsets(alloc, decomp.size());
 
   reduce_intervals(tail_flags.begin(), decomp, interval_output_offsets.begin(), thrust::plus<size_type>());
 
   // scan the interval counts
-  thrust::inclusive_scan(interval_output_offsets.begin(), interval_output_offsets.end(), interval_output_offsets.begin());
+  thrust::inclusive_scan(thrust::cuda::par(alloc), interval_output_offsets.begin(), interval_output_offsets.end(), interval_output_offsets.begin());
 
   // reduce each interval
-  thrust::detail::temporary_array<bool,thrust::cuda::tag> is_carry(t, decomp.size());
-  thrust::detail::temporary_array<intermediate_type,thrust::cuda::tag> interval_values(t, decomp.size());
+  temporary_buffer<bool,Allocator> is_carry(alloc, decomp.size());
+  temporary_buffer<intermediate_type,Allocator> interval_values(alloc, decomp.size());
 
-  size_type heap_size = tile_size * (sizeof(size_type) + sizeof(value_type));
+  bulk::heap_requirement<bulk::reduce_by_key_tag,groupsize,grainsize,RandomAccessIterator2> heap_size;
   bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(),heap_size), reduce_by_key_kernel(),
     bulk::root.this_exec, keys_first, decomp, values_first, keys_result, values_result, interval_output_offsets.begin(), interval_values.begin(), is_carry.begin(), thrust::make_tuple(pred, binary_op)
   );
 
   // scan by key the carries
-  thrust::inclusive_scan_by_key(thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets.begin(), is_carry.begin())),
+  thrust::inclusive_scan_by_key(thrust::cuda::par(alloc),
+                                thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets.begin(), is_carry.begin())),
                                 thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets.end(),   is_carry.end())),
                                 interval_values.begin(),
                                 interval_values.begin(),
@@ -272,6 +278,120 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
 }
 
 
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  my_reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                   RandomAccessIterator2 values_first,
+                   RandomAccessIterator3 keys_result,
+                   RandomAccessIterator4 values_result,
+                   BinaryPredicate pred,
+                   BinaryFunction binary_op)
+{
+  cuda_allocator alloc;
+  return my_reduce_by_key(alloc, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op);
+}
+
+
+// reduces by key streams of keys & values too large for memory in chunks of chunk_size elements
+// & passes each chunk of the result to sink(const K *keys, const V *values, std::size_t n)
+//
+// the last segment of a chunk may continue into the next chunk, so like the interval_values & is_carry
+// of my_reduce_by_key's groups, its key & partial value are held back as the carry & summed into the
+// first segment of the next chunk when their keys are equal
+// returns the number of segments
+template<typename Allocator,
+         typename KeySource,
+         typename ValueSource,
+         typename Sink,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+std::size_t streaming_reduce_by_key(Allocator &alloc,
+                                    KeySource key_source,
+                                    ValueSource value_source,
+                                    Sink sink,
+                                    std::size_t chunk_size,
+                                    BinaryPredicate pred,
+                                    BinaryFunction binary_op)
+{
+  typedef typename KeySource::value_type   key_type;
+  typedef typename ValueSource::value_type value_type;
+
+  chunked_reader<KeySource>   keys(key_source, chunk_size);
+  chunked_reader<ValueSource> values(value_source, chunk_size);
+
+  temporary_buffer<key_type,Allocator>   keys_result(alloc, chunk_size);
+  temporary_buffer<value_type,Allocator> values_result(alloc, chunk_size);
+
+  std::vector<key_type>   host_keys(chunk_size);
+  std::vector<value_type> host_values(chunk_size);
+
+  bool has_carry = false;
+  key_type carry_key = key_type();
+  value_type carry_value = value_type();
+
+  std::size_t result_size = 0;
+
+  while(std::size_t n = keys.next())
+  {
+    if(values.next() != n)
+    {
+      throw std::runtime_error("streaming_reduce_by_key: keys & values have different lengths");
+    }
+
+    std::size_t m = my_reduce_by_key(alloc,
+                                     keys.begin(), keys.begin() + n,
+                                     values.begin(),
+                                     keys_result.begin(),
+                                     values_result.begin(),
+                                     pred,
+                                     binary_op).first - keys_result.begin();
+
+    // copying the result back waits for the reduction, so the chunks are free for the readers afterwards
+    thrust::copy(keys_result.begin(),   keys_result.begin() + m,   host_keys.begin());
+    thrust::copy(values_result.begin(), values_result.begin() + m, host_values.begin());
+
+    if(has_carry)
+    {
+      if(pred(carry_key, host_keys[0]))
+      {
+        // the carry's segment continues into this chunk
+        host_values[0] = binary_op(carry_value, host_values[0]);
+      }
+      else
+      {
+        // the carry's segment ended with the last chunk
+        sink(&carry_key, &carry_value, 1);
+        ++result_size;
+      } // end else
+    } // end if
+
+    // every segment but the last is complete
+    if(m > 1)
+    {
+      sink(&host_keys[0], &host_values[0], m - 1);
+      result_size += m - 1;
+    } // end if
+
+    has_carry = true;
+    carry_key = host_keys[m - 1];
+    carry_value = host_values[m - 1];
+  } // end while
+
+  if(has_carry)
+  {
+    sink(&carry_key, &carry_value, 1);
+    ++result_size;
+  } // end if
+
+  return result_size;
+}
+
+
 template<typename T>
 size_t my_reduce_by_key(const thrust::device_vector<T> *keys,
                         const thrust::device_vector<T> *values,
@@ -288,6 +408,24 @@ size_t my_reduce_by_key(const thrust::device_vector<T> *keys,
 }
 
 
+template<typename T>
+size_t my_cached_reduce_by_key(const thrust::device_vector<T> *keys,
+                               const thrust::device_vector<T> *values,
+                               thrust::device_vector<T> *keys_result,
+                               thrust::device_vector<T> *values_result,
+                               caching_allocator<> *alloc)
+{
+  return my_reduce_by_key(*alloc,
+                          keys->begin(), keys->end(),
+                          values->begin(),
+                          keys_result->begin(),
+                          values_result->begin(),
+                          thrust::equal_to<T>(),
+                          thrust::plus<T>()).first -
+         keys_result->begin();
+}
+
+
 template<typename T>
 size_t thrust_reduce_by_key(const thrust::device_vector<T> *keys,
                             const thrust::device_vector<T> *values,
@@ -340,11 +478,16 @@ void compare(size_t n)
   size_t my_size = my_reduce_by_key(&keys, &values, &keys_result, &values_result);
   double my_msecs = time_invocation_cuda(50, my_reduce_by_key<T>, &keys, &values, &keys_result, &values_result);
 
+  caching_allocator<> alloc;
+  my_cached_reduce_by_key(&keys, &values, &keys_result, &values_result, &alloc);
+  double cached_msecs = time_invocation_cuda(50, my_cached_reduce_by_key<T>, &keys, &values, &keys_result, &values_result, &alloc);
+
   thrust_reduce_by_key(&keys, &values, &keys_result, &values_result);
   double thrust_msecs = time_invocation_cuda(50, thrust_reduce_by_key<T>, &keys, &values, &keys_result, &values_result);
 
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "Cached time:   " << cached_msecs << " ms" << std::endl;
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
 
   double my_secs = my_msecs / 1000;
@@ -402,8 +545,101 @@ void validate(size_t n)
 }
 
 
-int main()
+// writes each chunk of the keys & values of a reduce_by_key to a pair of files
+template<typename K, typename V>
+struct segment_file_sink
+{
+  segment_file_sink(std::FILE *keys, std::FILE *values)
+    : keys(keys), values(values)
+  {}
+
+  void operator()(const K *k, const V *v, std::size_t n)
+  {
+    keys(k, n);
+    values(v, n);
+  }
+
+  file_sink<K> keys;
+  file_sink<V> values;
+};
+
+
+template<typename T>
+size_t reduce_by_key_streamed_files(const char *keys_filename, const char *values_filename, const char *keys_result_filename, const char *values_result_filename)
 {
+  std::FILE *keys          = std::fopen(keys_filename, "rb");
+  std::FILE *values        = std::fopen(values_filename, "rb");
+  std::FILE *keys_result   = std::fopen(keys_result_filename, "wb");
+  std::FILE *values_result = std::fopen(values_result_filename, "wb");
+
+  size_t result = 0;
+
+  if(keys && values && keys_result && values_result)
+  {
+    caching_allocator<> alloc;
+    result = streaming_reduce_by_key(alloc,
+                                     file_source<T>(keys), file_source<T>(values),
+                                     segment_file_sink<T,T>(keys_result, values_result),
+                                     std::size_t(1) << 24,
+                                     thrust::equal_to<T>(),
+                                     thrust::plus<T>());
+  }
+
+  if(keys)          std::fclose(keys);
+  if(values)        std::fclose(values);
+  if(keys_result)   std::fclose(keys_result);
+  if(values_result) std::fclose(values_result);
+
+  return result;
+}
+
+
+template<typename T>
+void validate_files(const char *keys_filename, const char *values_filename, const char *keys_result_filename, const char *values_result_filename)
+{
+  // the first invocation warms the page cache
+  size_t my_size = reduce_by_key_streamed_files<T>(keys_filename, values_filename, keys_result_filename, values_result_filename);
+  double msecs = time_invocation_cuda(1, reduce_by_key_streamed_files<T>, keys_filename, values_filename, keys_result_filename, values_result_filename);
+
+  bulk::mapped_range<T> keys(keys_filename), values(values_filename);
+  bulk::mapped_range<T> keys_result(keys_result_filename), values_result(values_result_filename);
+
+  assert(keys.size() == values.size());
+  assert(keys_result.size() == my_size && values_result.size() == my_size);
+
+  // reduce by key sequentially alongside the result
+  size_t j = 0;
+  for(size_t i = 0; i < keys.size(); ++j)
+  {
+    T key = keys[i], sum = values[i];
+
+    for(++i; i < keys.size() && keys[i] == key; ++i)
+    {
+      sum += values[i];
+    }
+
+    assert(keys_result[j] == key);
+    assert(values_result[j] == sum);
+  }
+
+  assert(j == my_size);
+
+  double gigabytes = double(2 * sizeof(T) * (keys.size() + my_size)) / (1 << 30);
+
+  std::cout << "Streamed time: " << msecs << " ms" << std::endl;
+  std::cout << gigabytes / (msecs / 1000) << "GB/s" << std::endl;
+}
+
+
+// reduce_by_key [keys column file of ints] [values column file of ints] [keys result file] [values result file]
+int main(int argc, char **argv)
+{
+  if(argc > 4)
+  {
+    validate_files<int>(argv[1], argv[2], argv[3], argv[4]);
+    return 0;
+  }
+
   for(size_t n = 1; n <= 1 << 20; n <<= 1)
   {
     std::cout << "Testing n = " << n << std::endl;
@@ -31,9 +31,9 @@ struct reduce_intervals_kernel
 template<typename RandomAccessIterator1, typename Decomposition, typename RandomAccessIterator2, typename BinaryFunction>
 RandomAccessIterator2 reduce_intervals(RandomAccessIterator1 first, Decomposition decomp, RandomAccessIterator2 result, BinaryFunction binary_op)
 {
-  typedef typename thrust::iterator_value<RandomAccessIterator2>::type result_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
   const size_t groupsize = 128;
-  size_t heap_size = groupsize * sizeof(result_type);
+  bulk::heap_requirement<bulk::reduce_tag,groupsize,7,value_type> heap_size;
   bulk::async(bulk::grid<groupsize,7>(decomp.size(),heap_size), reduce_intervals_kernel(), bulk::root.this_exec, first, decomp, result, binary_op);
 
   return result + decomp.size();
@@ -0,0 +1,275 @@
+#include <bulk/detail/resource_pool.hpp>
+#include <cassert>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+// runs bulk::detail::resource_pool through a fake runtime which counts the streams & events
+// it creates & destroys, and whose streams are busy or failed until the test says they are idle,
+// and checks the pool's statistics at its capacity: resource_pool
+
+
+struct counting_runtime
+{
+  typedef int stream_type;
+  typedef int event_type;
+
+  int *num_created;
+  int *num_destroyed;
+  int *num_queries;
+  std::set<int> *busy_streams;
+  std::set<int> *failed_streams;
+
+  int create_stream()
+  {
+    return ++*num_created;
+  }
+
+  void destroy_stream(int)
+  {
+    ++*num_destroyed;
+  }
+
+  bulk::detail::stream_status status(int s)
+  {
+    ++*num_queries;
+
+    if(failed_streams->count(s)) return bulk::detail::stream_error;
+    if(busy_streams->count(s))   return bulk::detail::stream_busy;
+
+    return bulk::detail::stream_idle;
+  }
+
+  int create_event()
+  {
+    return ++*num_created;
+  }
+
+  void destroy_event(int)
+  {
+    ++*num_destroyed;
+  }
+};
+
+
+typedef bulk::detail::resource_pool<counting_runtime> pool_type;
+
+
+void check_statistics(const bulk::detail::resource_pool_statistics &stats,
+                      std::size_t hits, std::size_t misses, std::size_t busy, std::size_t releases, std::size_t discards,
+                      std::size_t evictions = 0)
+{
+  assert(stats.hits == hits);
+  assert(stats.misses == misses);
+  assert(stats.busy == busy);
+  assert(stats.releases == releases);
+  assert(stats.discards == discards);
+  assert(stats.evictions == evictions);
+}
+
+
+void test_capacity()
+{
+  int num_created = 0, num_destroyed = 0, num_queries = 0;
+  std::set<int> busy_streams, failed_streams;
+
+  counting_runtime runtime = {&num_created, &num_destroyed, &num_queries, &busy_streams, &failed_streams};
+
+  {
+    pool_type pool(2, runtime);
+
+    // an empty pool misses
+    int a = pool.acquire_stream();
+    int b = pool.acquire_stream();
+    int c = pool.acquire_stream();
+    check_statistics(pool.stream_statistics(), 0, 3, 0, 0, 0);
+    assert(num_created == 3);
+
+    // the pool retains two streams & destroys the third
+    pool.release_stream(a);
+    pool.release_stream(b);
+    pool.release_stream(c);
+    check_statistics(pool.stream_statistics(), 0, 3, 0, 3, 1);
+    assert(num_destroyed == 1);
+
+    // idle streams are reused
+    a = pool.acquire_stream();
+    b = pool.acquire_stream();
+    check_statistics(pool.stream_statistics(), 2, 3, 0, 3, 1);
+    assert(num_created == 3);
+
+    // the same goes for events
+    int e = pool.acquire_event();
+    pool.release_event(e);
+    assert(pool.acquire_event() == e);
+    check_statistics(pool.event_statistics(), 1, 1, 0, 1, 0);
+    pool.release_event(e);
+
+    pool.release_stream(a);
+    pool.release_stream(b);
+
+    // shrinking the pool destroys the idle resources it no longer retains
+    pool.set_capacity(1);
+    check_statistics(pool.stream_statistics(), 2, 3, 0, 5, 2);
+    assert(num_destroyed == 2);
+  }
+
+  // destroying the pool destroys everything it retained
+  assert(num_created == 4);
+  assert(num_destroyed == 4);
+
+  std::printf("an idle pool of two streams reuses them & destroys the rest\n");
+}
+
+
+void test_busy_streams()
+{
+  int num_created = 0, num_destroyed = 0, num_queries = 0;
+  std::set<int> busy_streams, failed_streams;
+
+  counting_runtime runtime = {&num_created, &num_destroyed, &num_queries, &busy_streams, &failed_streams};
+
+  {
+    pool_type pool(2, runtime);
+
+    int a = pool.acquire_stream();
+    int b = pool.acquire_stream();
+
+    // both streams are released with their work still queued
+    busy_streams.insert(a);
+    busy_streams.insert(b);
+    pool.release_stream(a);
+    pool.release_stream(b);
+
+    // no busy stream is handed out, so the acquisition creates a new stream
+    int c = pool.acquire_stream();
+    assert(c != a && c != b);
+    check_statistics(pool.stream_statistics(), 0, 3, 2, 2, 0);
+    assert(num_created == 3);
+
+    // the busy streams stay pooled, so the pool is full & the new stream is destroyed
+    pool.release_stream(c);
+    check_statistics(pool.stream_statistics(), 0, 3, 2, 3, 1);
+    assert(num_destroyed == 1);
+
+    // once b finishes, it is handed out in spite of a, which was released before it & is still busy
+    busy_streams.erase(b);
+    assert(pool.acquire_stream() == b);
+    check_statistics(pool.stream_statistics(), 1, 3, 3, 3, 1);
+
+    // once a finishes, it is reused too
+    busy_streams.erase(a);
+    assert(pool.acquire_stream() == a);
+    check_statistics(pool.stream_statistics(), 2, 3, 3, 3, 1);
+    assert(num_created == 3);
+
+    pool.release_stream(a);
+    pool.release_stream(b);
+  }
+
+  assert(num_destroyed == num_created);
+
+  std::printf("streams released with work queued are not reused until they finish\n");
+}
+
+
+void test_failed_streams()
+{
+  int num_created = 0, num_destroyed = 0, num_queries = 0;
+  std::set<int> busy_streams, failed_streams;
+
+  counting_runtime runtime = {&num_created, &num_destroyed, &num_queries, &busy_streams, &failed_streams};
+
+  {
+    pool_type pool(2, runtime);
+
+    int a = pool.acquire_stream();
+    int b = pool.acquire_stream();
+    pool.release_stream(a);
+    pool.release_stream(b);
+
+    // a's query fails, so a is destroyed rather than left pooled, & b is handed out
+    failed_streams.insert(a);
+    assert(pool.acquire_stream() == b);
+    check_statistics(pool.stream_statistics(), 1, 2, 0, 2, 0, 1);
+    assert(num_destroyed == 1);
+
+    // once b fails too, the empty pool replaces it with a new stream
+    failed_streams.insert(b);
+    pool.release_stream(b);
+    int c = pool.acquire_stream();
+    assert(c != a && c != b);
+    check_statistics(pool.stream_statistics(), 1, 3, 0, 3, 0, 2);
+    assert(num_destroyed == 2);
+
+    // the new stream is reused
+    pool.release_stream(c);
+    assert(pool.acquire_stream() == c);
+    check_statistics(pool.stream_statistics(), 2, 3, 0, 4, 0, 2);
+
+    pool.release_stream(c);
+  }
+
+  assert(num_destroyed == num_created);
+
+  std::printf("streams whose queries fail are destroyed & replaced\n");
+}
+
+
+void test_bounded_queries()
+{
+  int num_created = 0, num_destroyed = 0, num_queries = 0;
+  std::set<int> busy_streams, failed_streams;
+
+  counting_runtime runtime = {&num_created, &num_destroyed, &num_queries, &busy_streams, &failed_streams};
+
+  const int num_streams = 3 * pool_type::max_queried_streams;
+
+  {
+    pool_type pool(num_streams, runtime);
+
+    std::vector<int> streams;
+    for(int i = 0; i < num_streams; ++i)
+    {
+      streams.push_back(pool.acquire_stream());
+    }
+
+    // every stream is released with its work still queued
+    for(int i = 0; i < num_streams; ++i)
+    {
+      busy_streams.insert(streams[i]);
+      pool.release_stream(streams[i]);
+    }
+
+    // an acquisition queries only the oldest few streams before it creates one
+    num_queries = 0;
+    int s = pool.acquire_stream();
+    assert(num_queries == static_cast<int>(pool_type::max_queried_streams));
+    assert(busy_streams.count(s) == 0);
+    check_statistics(pool.stream_statistics(), 0, num_streams + 1, pool_type::max_queried_streams, num_streams, 0);
+
+    // the busy streams it queried stay pooled in order, so the oldest is reused once it finishes
+    busy_streams.erase(streams[0]);
+    assert(pool.acquire_stream() == streams[0]);
+
+    // the pool has room for only one of the two
+    pool.release_stream(s);
+    pool.release_stream(streams[0]);
+  }
+
+  assert(num_destroyed == num_created);
+
+  std::printf("an acquisition queries at most %d pooled streams\n", static_cast<int>(pool_type::max_queried_streams));
+}
+
+
+int main()
+{
+  test_capacity();
+  test_busy_streams();
+  test_failed_streams();
+  test_bounded_queries();
+
+  return 0;
+}
+
@@ -5,11 +5,15 @@
 #include <thrust/random.h>
 #include <cassert>
 #include <iostream>
+#include <vector>
+#include <bulk/mapped_range.hpp>
 #include "time_invocation_cuda.hpp"
 #include <thrust/detail/temporary_array.h>
 #include <thrust/detail/type_traits/function_traits.h>
 #include <bulk/bulk.hpp>
 #include "decomposition.hpp"
+#include "caching_allocator.hpp"
+#include "chunked_reader.hpp"
 
 
 struct inclusive_scan_n
@@ -84,8 +88,30 @@ struct accumulate_tiles
 }; // end accumulate_tiles
 
 
-template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
-RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
+template<typename IntermediateType>
+struct scan_tiling
+{
+  // determined from empirical testing on k20c
+  static const int groupsize = sizeof(IntermediateType) <= sizeof(int) ? 128 : 256;
+  static const int grainsize = sizeof(IntermediateType) <= sizeof(int) ?   9 :   5;
+};
+
+
+// the tiles of n elements which inclusive_scan's groups scan
+template<typename IntermediateType, typename Size>
+aligned_decomposition<Size> scan_decomposition(Size n)
+{
+  const Size tile_size = scan_tiling<IntermediateType>::groupsize * scan_tiling<IntermediateType>::grainsize;
+
+  // 20 determined from empirical testing on k20c & GTX 480
+  int subscription = 20;
+
+  return make_tiled_decomposition<Size>(n, tile_size, subscription * bulk::concurrent_group<>::hardware_concurrency());
+}
+
+
+template<typename Allocator, typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(Allocator &alloc, RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
 {
   typedef typename bulk::detail::scan_detail::scan_intermediate<
     RandomAccessIterator1,
@@ -101,53 +127,74 @@ RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIt
 
   if(n < threshold_of_parallelism)
   {
-    typedef bulk::detail::scan_detail::scan_buffer<512,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> heap_type;
-    Size heap_size = sizeof(heap_type);
+    bulk::heap_requirement<bulk::inclusive_scan_tag,512,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> heap_size;
     bulk::async(bulk::con<512,3>(heap_size), inclusive_scan_n(), bulk::root, first, n, result, init, binary_op);
   } // end if
   else
   {
-    // determined from empirical testing on k20c
-    const int groupsize = sizeof(intermediate_type) <= sizeof(int) ? 128 : 256;
-    const int grainsize = sizeof(intermediate_type) <= sizeof(int) ?   9 :   5;
-
-    const Size tile_size = groupsize * grainsize;
-    int num_tiles = (n + tile_size - 1) / tile_size;
+    const int groupsize = scan_tiling<intermediate_type>::groupsize;
+    const int grainsize = scan_tiling<intermediate_type>::grainsize;
 
-    // 20 determined from empirical testing on k20c & GTX 480
-    int subscription = 20;
-    Size num_groups = thrust::min<Size>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles);
+    aligned_decomposition<Size> decomp = scan_decomposition<intermediate_type>(n);
+    Size num_groups = decomp.size();
 
-    aligned_decomposition<Size> decomp(n, num_groups, tile_size);
-
-    thrust::cuda::tag t;
-    thrust::detail::temporary_array<intermediate_type,thrust::cuda::tag> carries(t, num_groups);
+    temporary_buffer<intermediate_type,Allocator> carries(alloc, num_groups);
     	
     // Run the parallel raking reduce as an upsweep.
     // n loads + num_groups stores
-    Size heap_size = groupsize * sizeof(intermediate_type);
-    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,heap_size), accumulate_tiles(), bulk::root.this_exec, first, decomp, carries.begin(), binary_op);
+    bulk::heap_requirement<bulk::accumulate_tag,groupsize,grainsize,RandomAccessIterator1,typename thrust::iterator_value<RandomAccessIterator1>::type> upsweep_heap_size;
+    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,upsweep_heap_size), accumulate_tiles(), bulk::root.this_exec, first, decomp, carries.begin(), binary_op);
     
     // scan the sums to get the carries
     // num_groups loads + num_groups stores
-    typedef bulk::detail::scan_detail::scan_buffer<256,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> heap_type2;
-    heap_size = sizeof(heap_type2);
-    bulk::async(bulk::con<256,3>(heap_size), exclusive_scan_n(), bulk::root, carries.begin(), num_groups, carries.begin(), init, binary_op);
+    bulk::heap_requirement<bulk::exclusive_scan_tag,256,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> carries_heap_size;
+    bulk::async(bulk::con<256,3>(carries_heap_size), exclusive_scan_n(), bulk::root, carries.begin(), num_groups, carries.begin(), init, binary_op);
 
     // do the downsweep - n loads, n stores
-    typedef bulk::detail::scan_detail::scan_buffer<
-      groupsize,
-      grainsize,
-      RandomAccessIterator1,RandomAccessIterator2,BinaryFunction
-    > heap_type3;
-    heap_size = sizeof(heap_type3);
-    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,heap_size), inclusive_downsweep(), bulk::root.this_exec, first, decomp, carries.begin(), result, binary_op);
+    bulk::heap_requirement<bulk::inclusive_scan_tag,groupsize,grainsize,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> downsweep_heap_size;
+    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,downsweep_heap_size), inclusive_downsweep(), bulk::root.this_exec, first, decomp, carries.begin(), result, binary_op);
   } // end else
 
   return result + n;
 } // end inclusive_scan()
 
 
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
+{
+  cuda_allocator alloc;
+  return ::inclusive_scan(alloc, first, last, result, init, binary_op);
+} // end inclusive_scan()
+
+
+// scans a stream too large for memory in chunks of chunk_size elements & passes each chunk
+// of the result to sink(const T *data, std::size_t n)
+// the last element of the result so far is the init of the next chunk
+// returns the last element of the result
+template<typename Allocator, typename Source, typename Sink, typename T, typename BinaryFunction>
+T streaming_inclusive_scan(Allocator &alloc, Source source, Sink sink, std::size_t chunk_size, T init, BinaryFunction binary_op)
+{
+  chunked_reader<Source> reader(source, chunk_size);
+
+  temporary_buffer<T,Allocator> result(alloc, chunk_size);
+  std::vector<T> host_result(chunk_size);
+
+  while(std::size_t n = reader.next())
+  {
+    ::inclusive_scan(alloc, reader.begin(), reader.begin() + n, result.begin(), init, binary_op);
+
+    // copying the result back waits for the scan, so the chunk is free for the reader afterwards
+    thrust::copy(result.begin(), result.begin() + n, host_result.begin());
+
+    init = host_result[n - 1];
+
+    sink(&host_result[0], n);
+  } // end while
+
+  return init;
+} // end streaming_inclusive_scan()
+
+
 template<typename T>
 void my_scan(thrust::device_vector<T> *data, T init)
 {
@@ -155,6 +202,13 @@ void my_scan(thrust::device_vector<T> *data, T init)
 }
 
 
+template<typename T>
+void my_cached_scan(thrust::device_vector<T> *data, T init, caching_allocator<> *alloc)
+{
+  ::inclusive_scan(*alloc, data->begin(), data->end(), data->begin(), init, thrust::plus<T>());
+}
+
+
 template<typename T>
 void validate(size_t n)
 {
@@ -202,17 +256,113 @@ void compare(size_t n = 1 << 28)
   my_scan(&vec, T(13));
   double my_msecs = time_invocation_cuda(50, my_scan<T>, &vec, 13);
 
+  caching_allocator<> alloc;
+  my_cached_scan(&vec, T(13), &alloc);
+  double cached_msecs = time_invocation_cuda(50, my_cached_scan<T>, &vec, 13, &alloc);
+
   std::cout << "N: " << n << std::endl;
   std::cout << "  Thrust's time:                  " << thrust_msecs << " ms" << std::endl;
   std::cout << "  My time:                        " << my_msecs << " ms" << std::endl;
+  std::cout << "  Cached time:                    " << cached_msecs << " ms" << std::endl;
   std::cout << "  Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
   std::cout << std::endl;
 }
 
 
+// scans a column file into another in place, prefetching the input's pages along the tiles of inclusive_scan's groups
+template<typename T>
+void scan_file(const char *input_filename, const char *output_filename)
+{
+  bulk::mapped_range<T> input(input_filename);
 
-int main()
+  // a read_write range of no elements would keep the output's old length, so empty it instead
+  if(input.empty())
+  {
+    if(std::FILE *output = std::fopen(output_filename, "wb"))
+    {
+      std::fclose(output);
+    }
+
+    return;
+  }
+
+  bulk::mapped_range<T> output(output_filename, bulk::mapped_range<T>::read_write, input.size());
+
+  input.prefetch(scan_decomposition<T>(input.size()));
+
+  ::inclusive_scan(input.device_begin(), input.device_end(), output.device_begin(), T(0), thrust::plus<T>());
+  cudaDeviceSynchronize();
+
+  output.flush();
+}
+
+
+// scans a column file into another in chunks, reading the next chunk while the last one is scanned
+template<typename T>
+void scan_streamed_file(const char *input_filename, const char *output_filename)
 {
+  std::FILE *input  = std::fopen(input_filename, "rb");
+  std::FILE *output = std::fopen(output_filename, "wb");
+
+  if(input && output)
+  {
+    caching_allocator<> alloc;
+    streaming_inclusive_scan(alloc, file_source<T>(input), file_sink<T>(output), std::size_t(1) << 24, T(0), thrust::plus<T>());
+  }
+
+  if(input)  std::fclose(input);
+  if(output) std::fclose(output);
+}
+
+
+template<typename T>
+void validate_scanned_file(const char *input_filename, const char *output_filename)
+{
+  bulk::mapped_range<T> input(input_filename);
+  bulk::mapped_range<T> output(output_filename);
+
+  assert(input.size() == output.size());
+
+  T sum = 0;
+  for(typename bulk::mapped_range<T>::size_type i = 0; i < input.size(); ++i)
+  {
+    sum += input[i];
+    assert(sum == output[i]);
+  }
+}
+
+
+template<typename T>
+void validate_file(const char *input_filename, const char *output_filename)
+{
+  // the first invocations warm the page cache, so these measure page-cache-speed startup
+  scan_file<T>(input_filename, output_filename);
+  validate_scanned_file<T>(input_filename, output_filename);
+  double mapped_msecs = time_invocation_cuda(1, scan_file<T>, input_filename, output_filename);
+
+  scan_streamed_file<T>(input_filename, output_filename);
+  validate_scanned_file<T>(input_filename, output_filename);
+  double streamed_msecs = time_invocation_cuda(1, scan_streamed_file<T>, input_filename, output_filename);
+
+  size_t n = bulk::mapped_range<T>(input_filename).size();
+  double gigabytes = double(2 * sizeof(T) * n) / (1 << 30);
+
+  std::cout << "N: " << n << std::endl;
+  std::cout << "  Mapped time:   " << mapped_msecs << " ms" << std::endl;
+  std::cout << "  Streamed time: " << streamed_msecs << " ms" << std::endl;
+  std::cout << "  Streamed rate: " << gigabytes / (streamed_msecs / 1000) << " GB/s" << std::endl;
+}
+
+
+// scan [input column file of ints] [output column file]
+int main(int argc, char **argv)
+{
+  if(argc > 2)
+  {
+    validate_file<int>(argv[1], argv[2]);
+    return 0;
+  }
+
   for(size_t n = 1; n <= 1 << 20; n <<= 1)
   {
     std::cout << "Testing n = " << n << std::endl;
@@ -0,0 +1,198 @@
+#define BULK_BARRIER_INSTRUMENTATION
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/functional.h>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include "time_invocation_cuda.hpp"
+
+// counts the barriers each group waits at per call when its scratch comes from scoped_buffers
+// stacked in its heap, and when the heap has no room for them, so that they fall back to
+// bulk::malloc & bulk::free, and times both: scratch_barriers [number of calls per group]
+//
+// the counts come from bulk::read_process_barrier_count(), which counts every barrier
+// a block waits at, so they include the barriers which the algorithms need for their data.
+// the barriers of a launch with no calls are subtracted, which leaves those of the calls
+
+const int groupsize = 128;
+const int grainsize = 3;
+const int num_groups = 120;
+
+typedef bulk::concurrent_group<bulk::agent<grainsize>,groupsize> group_type;
+
+
+// the scratch alone: a buffer which the group writes & waits on before destroying it
+struct scoped_buffer_scratch
+{
+  __device__
+  void operator()(group_type &g, int num_calls, int *result)
+  {
+    int sum = 0;
+
+    for(int i = 0; i < num_calls; ++i)
+    {
+      bulk::scoped_buffer<int> buffer(g, groupsize);
+
+      buffer[g.this_exec.index()] = i;
+      g.wait();
+
+      sum += buffer[(g.this_exec.index() + 1) % groupsize];
+      g.wait();
+    }
+
+    result[g.index() * groupsize + g.this_exec.index()] = sum;
+  }
+};
+
+
+// the same scratch from bulk::malloc & bulk::free
+struct malloc_scratch
+{
+  __device__
+  void operator()(group_type &g, int num_calls, int *result)
+  {
+    int sum = 0;
+
+    for(int i = 0; i < num_calls; ++i)
+    {
+      int *buffer = static_cast<int*>(bulk::malloc(g, groupsize * sizeof(int)));
+
+      buffer[g.this_exec.index()] = i;
+      g.wait();
+
+      sum += buffer[(g.this_exec.index() + 1) % groupsize];
+      g.wait();
+
+      bulk::free(g, buffer);
+    }
+
+    result[g.index() * groupsize + g.this_exec.index()] = sum;
+  }
+};
+
+
+// bulk::reduce, whose scratch is a scoped_buffer
+struct reduce_calls
+{
+  __device__
+  void operator()(group_type &g, int num_calls, const int *data, int n, int *result)
+  {
+    int sum = 0;
+
+    for(int i = 0; i < num_calls; ++i)
+    {
+      sum += bulk::reduce(g, data, data + n, 0, thrust::plus<int>());
+    }
+
+    if(g.this_exec.index() == 0)
+    {
+      result[g.index()] = sum;
+    }
+  }
+};
+
+
+template<typename Function>
+void launch_scratch(Function f, size_t heap_size, int num_calls, thrust::device_vector<int> *result)
+{
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), f, bulk::root.this_exec, num_calls, thrust::raw_pointer_cast(result->data())).wait();
+}
+
+
+void launch_reduce(size_t heap_size, int num_calls, const thrust::device_vector<int> *data, thrust::device_vector<int> *result)
+{
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), reduce_calls(), bulk::root.this_exec, num_calls,
+              thrust::raw_pointer_cast(data->data()), static_cast<int>(data->size()), thrust::raw_pointer_cast(result->data())).wait();
+}
+
+
+template<typename Function>
+unsigned long long count_barriers(Function f, size_t heap_size, int num_calls)
+{
+  thrust::device_vector<int> result(num_groups * groupsize);
+
+  bulk::reset_process_barrier_count();
+  launch_scratch(f, heap_size, num_calls, &result);
+
+  return bulk::read_process_barrier_count();
+}
+
+
+template<typename Function>
+double barriers_per_call(Function f, size_t heap_size, int num_calls)
+{
+  double num_barriers = count_barriers(f, heap_size, num_calls) - count_barriers(f, heap_size, 0);
+
+  return num_barriers / (num_groups * num_calls);
+}
+
+
+unsigned long long count_reduce_barriers(size_t heap_size, int num_calls, const thrust::device_vector<int> &data)
+{
+  thrust::device_vector<int> result(num_groups);
+
+  bulk::reset_process_barrier_count();
+  launch_reduce(heap_size, num_calls, &data, &result);
+
+  unsigned long long num_barriers = bulk::read_process_barrier_count();
+
+  int expected = num_calls * static_cast<int>(data.size());
+  for(int i = 0; i < num_groups; ++i)
+  {
+    assert(result[i] == expected);
+  }
+
+  return num_barriers;
+}
+
+
+double reduce_barriers_per_call(size_t heap_size, int num_calls, const thrust::device_vector<int> &data)
+{
+  double num_barriers = count_reduce_barriers(heap_size, num_calls, data) - count_reduce_barriers(heap_size, 0, data);
+
+  return num_barriers / (num_groups * num_calls);
+}
+
+
+int main(int argc, char **argv)
+{
+  int num_calls = 1000;
+  if(argc > 1) num_calls = std::atoi(argv[1]);
+
+  // room for every buffer on the stack, & no heap at all
+  const size_t roomy_heap_size = 4 * groupsize * sizeof(int);
+  const size_t no_heap_size = 0;
+
+  thrust::device_vector<int> data(4 * groupsize * grainsize, 1);
+  thrust::device_vector<int> result(num_groups * groupsize);
+
+  double stacked   = barriers_per_call(scoped_buffer_scratch(), roomy_heap_size, num_calls);
+  double fallback  = barriers_per_call(scoped_buffer_scratch(), no_heap_size, num_calls);
+  double allocated = barriers_per_call(malloc_scratch(), roomy_heap_size, num_calls);
+
+  // a buffer on the stack waits only where the group's data does, while one which falls back
+  // waits as often as bulk::malloc & bulk::free do
+  assert(stacked == 2);
+  assert(fallback == allocated);
+
+  double reduce_stacked  = reduce_barriers_per_call(roomy_heap_size, num_calls, data);
+  double reduce_fallback = reduce_barriers_per_call(no_heap_size, num_calls, data);
+
+  assert(reduce_stacked < reduce_fallback);
+
+  double stacked_msecs   = time_invocation_cuda(20, launch_scratch<scoped_buffer_scratch>, scoped_buffer_scratch(), roomy_heap_size, num_calls, &result);
+  double allocated_msecs = time_invocation_cuda(20, launch_scratch<malloc_scratch>, malloc_scratch(), roomy_heap_size, num_calls, &result);
+  double reduce_stacked_msecs  = time_invocation_cuda(20, launch_reduce, roomy_heap_size, num_calls, &data, &result);
+  double reduce_fallback_msecs = time_invocation_cuda(20, launch_reduce, no_heap_size, num_calls, &data, &result);
+
+  std::printf("%d groups of %d agents, %d calls per group\n", num_groups, groupsize, num_calls);
+  std::printf("                          barriers per call   ms\n");
+  std::printf("scoped_buffer, stacked    %17.2f %6.3f\n", stacked, stacked_msecs);
+  std::printf("scoped_buffer, fallback   %17.2f\n", fallback);
+  std::printf("bulk::malloc & bulk::free %17.2f %6.3f\n", allocated, allocated_msecs);
+  std::printf("bulk::reduce, stacked     %17.2f %6.3f\n", reduce_stacked, reduce_stacked_msecs);
+  std::printf("bulk::reduce, fallback    %17.2f %6.3f\n", reduce_fallback, reduce_fallback_msecs);
+
+  return 0;
+}
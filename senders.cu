@@ -0,0 +1,45 @@
+#include <bulk/bulk.hpp>
+#include <cstdio>
+
+struct task
+{
+  __device__
+  void operator()(bulk::parallel_group<> &g, int id)
+  {
+    if(g.this_exec.index() == 0)
+    {
+      printf("Hello world from task%d\n", id);
+    }
+  }
+};
+
+int main()
+{
+  using bulk::par;
+  using bulk::root;
+
+  // describe a pipeline: task1 & task2 are independent, task3 follows both
+  // nothing is launched yet
+  bulk::schedule_sender<bulk::parallel_group<> > sched = bulk::schedule(par(32));
+
+  // start enqueues every launch without blocking this thread
+  bulk::future<void> f =
+    bulk::start(
+      bulk::then(
+        bulk::when_all(
+          bulk::then(sched, task(), root, 1),
+          bulk::then(sched, task(), root, 2)
+        ),
+        task(), root, 3
+      )
+    );
+
+  printf("Hello world from the host, while the pipeline runs\n");
+
+  f.wait();
+
+  // sync_wait starts the pipeline and waits for it to complete
+  bulk::sync_wait(bulk::then(bulk::then(sched, task(), root, 4), task(), root, 5));
+
+  return 0;
+}
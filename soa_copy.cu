@@ -0,0 +1,96 @@
+#include <thrust/device_vector.h>
+#include <thrust/copy.h>
+#include <thrust/equal.h>
+#include <thrust/fill.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <bulk/bulk.hpp>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include "time_invocation_cuda.hpp"
+#include "decomposition.hpp"
+
+// compares copying records stored as a structure of arrays one field at a time with copying them a tuple at a time:
+// soa_copy [number of records]
+//
+// bulk::copy_n recognizes the iterators of two soa_vectors & copies each field with 16B loads & stores, while
+// simple_copy_n assigns one tuple of references per element, which issues a narrow load & store per field
+
+typedef bulk::soa_vector<float,int,double> records;
+
+const int groupsize = 256;
+const int grainsize = 4;
+
+
+struct fieldwise_copy_tiles
+{
+  template<typename ConcurrentGroup, typename Iterator1, typename Decomposition, typename Iterator2>
+  __device__
+  void operator()(ConcurrentGroup &this_group, Iterator1 first, Decomposition decomp, Iterator2 result)
+  {
+    typename Decomposition::range range = decomp[this_group.index()];
+
+    bulk::copy_n(this_group, first + range.first, range.second - range.first, result + range.first);
+  }
+};
+
+
+struct tuple_copy_tiles
+{
+  template<typename ConcurrentGroup, typename Iterator1, typename Decomposition, typename Iterator2>
+  __device__
+  void operator()(ConcurrentGroup &this_group, Iterator1 first, Decomposition decomp, Iterator2 result)
+  {
+    typename Decomposition::range range = decomp[this_group.index()];
+
+    bulk::detail::simple_copy_n(this_group, first + range.first, range.second - range.first, result + range.first);
+  }
+};
+
+
+template<typename Function>
+void copy_records(const records *input, records *result)
+{
+  bulk::concurrent_group<bulk::agent<grainsize>,groupsize> g;
+
+  const int subscription = 10;
+
+  aligned_decomposition<int> decomp = make_tiled_decomposition<int>(input->size(), groupsize * grainsize, subscription * bulk::concurrent_group<>::hardware_concurrency());
+
+  bulk::async(bulk::par(g, decomp.size()), Function(), bulk::root.this_exec, input->begin(), decomp, result->begin());
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t n = 1 << 24;
+  if(argc > 1) n = std::atol(argv[1]);
+
+  records input(n), result(n);
+
+  thrust::copy_n(thrust::make_zip_iterator(thrust::make_tuple(thrust::make_counting_iterator<float>(0),
+                                                              thrust::make_counting_iterator<int>(0),
+                                                              thrust::make_counting_iterator<double>(0))),
+                 n,
+                 input.begin());
+
+  double gigabytes = double(2 * n * (sizeof(float) + sizeof(int) + sizeof(double))) / (1 << 30);
+
+  std::cout << "N: " << n << std::endl;
+
+  copy_records<fieldwise_copy_tiles>(&input, &result);
+  assert(thrust::equal(input.begin(), input.end(), result.begin()));
+  double fieldwise_msecs = time_invocation_cuda(20, copy_records<fieldwise_copy_tiles>, &input, &result);
+
+  thrust::fill_n(result.begin(), n, thrust::make_tuple(0.f, 0, 0.));
+
+  copy_records<tuple_copy_tiles>(&input, &result);
+  assert(thrust::equal(input.begin(), input.end(), result.begin()));
+  double tuple_msecs = time_invocation_cuda(20, copy_records<tuple_copy_tiles>, &input, &result);
+
+  std::cout << "field-wise copy_n: " << fieldwise_msecs << " ms, " << gigabytes / (fieldwise_msecs / 1000) << " GB/s" << std::endl;
+  std::cout << "tuple-wise copy_n: " << tuple_msecs     << " ms, " << gigabytes / (tuple_msecs / 1000)     << " GB/s" << std::endl;
+
+  return 0;
+}
+
@@ -1,7 +1,21 @@
 #pragma once
 #include <cstddef>
+#include <ctime>
 #include <cuda_runtime_api.h>
 
+// the time since an arbitrary point, for timing code on the host
+inline double wall_clock_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1e9 * ts.tv_sec + ts.tv_nsec;
+}
+
+inline double wall_clock_ms()
+{
+  return 1e-6 * wall_clock_ns();
+}
+
 template<typename Function>
   double time_invocation_cuda(std::size_t num_trials, Function f)
 {
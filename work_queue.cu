@@ -0,0 +1,278 @@
+#include <thrust/device_vector.h>
+#include <thrust/copy.h>
+#include <bulk/bulk.hpp>
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+#include <pthread.h>
+
+// exercises bulk::work_queue on both sides: host threads which mix pushes & pops on a shared queue,
+// and a breadth-first search whose frontier is drained by a concurrent_group while the visited
+// vertices push their unvisited neighbors: work_queue [number of vertices] [degree]
+
+
+typedef bulk::work_queue<unsigned int> queue_type;
+
+
+struct host_worker
+{
+  queue_type *queue;
+  unsigned int index, num_items;
+  std::vector<unsigned int> popped;
+};
+
+
+// pushes num_items distinct items in small batches, popping a batch after each push
+void *push_and_pop(void *arg)
+{
+  host_worker *w = reinterpret_cast<host_worker*>(arg);
+
+  unsigned int batch[7];
+
+  for(unsigned int i = 0; i < w->num_items; )
+  {
+    unsigned int n = std::min<unsigned int>(1 + i % 7, w->num_items - i);
+
+    for(unsigned int j = 0; j < n; ++j)
+    {
+      batch[j] = w->index * w->num_items + i + j;
+    }
+
+    // a push may fall short while other workers' pops are in flight
+    i += w->queue->push_n(batch, n);
+
+    unsigned int num_popped = w->queue->pop_n(batch, 1 + w->index % 5);
+    w->popped.insert(w->popped.end(), batch, batch + num_popped);
+  }
+
+  return 0;
+}
+
+
+// checks that every item pushed by concurrent host threads is popped exactly once
+void test_host_threads(unsigned int num_threads, unsigned int num_items, unsigned int capacity, unsigned int overflow_capacity)
+{
+  std::vector<unsigned long long> storage(queue_type::storage_size(capacity) / sizeof(unsigned long long) + 1);
+  std::vector<unsigned long long> overflow_storage(queue_type::overflow_storage_size(overflow_capacity) / sizeof(unsigned long long) + 1);
+
+  queue_type queue(&storage[0], capacity, &overflow_storage[0], overflow_capacity);
+  queue.clear();
+
+  std::vector<host_worker> workers(num_threads);
+  std::vector<pthread_t> threads(num_threads);
+
+  for(unsigned int i = 0; i < num_threads; ++i)
+  {
+    workers[i].queue = &queue;
+    workers[i].index = i;
+    workers[i].num_items = num_items;
+
+    pthread_create(&threads[i], 0, push_and_pop, &workers[i]);
+  }
+
+  std::vector<unsigned int> count(num_threads * num_items, 0);
+
+  for(unsigned int i = 0; i < num_threads; ++i)
+  {
+    pthread_join(threads[i], 0);
+
+    for(size_t j = 0; j < workers[i].popped.size(); ++j)
+    {
+      ++count[workers[i].popped[j]];
+    }
+  }
+
+  unsigned int x = 0;
+  while(queue.pop(x))
+  {
+    ++count[x];
+  }
+
+  for(size_t i = 0; i < count.size(); ++i)
+  {
+    assert(count[i] == 1);
+  }
+
+  std::printf("host: %u threads pushed & popped %u items each through a queue of %u + %u slots\n", num_threads, num_items, capacity, overflow_capacity);
+}
+
+
+const unsigned int unvisited = UINT_MAX;
+
+
+struct visit_neighbors
+{
+  const unsigned int *row_offsets;
+  const unsigned int *columns;
+  unsigned int *distances;
+  unsigned int *num_dropped;
+  queue_type queue;
+
+  __device__
+  void operator()(unsigned int v)
+  {
+    unsigned int d = distances[v] + 1;
+
+    for(unsigned int e = row_offsets[v]; e < row_offsets[v+1]; ++e)
+    {
+      unsigned int u = columns[e];
+
+      // the first visitor of u claims it, so that each vertex is pushed at most once
+      if(atomicCAS(&distances[u], unvisited, d) == unvisited)
+      {
+        if(!queue.push(u))
+        {
+          atomicAdd(num_dropped, 1);
+        }
+      }
+    }
+  }
+};
+
+
+struct breadth_first_search
+{
+  __device__
+  void operator()(bulk::concurrent_group<> &g,
+                  const unsigned int *row_offsets,
+                  const unsigned int *columns,
+                  unsigned int *distances,
+                  unsigned int source,
+                  unsigned int queue_capacity,
+                  void *overflow_storage,
+                  unsigned int overflow_capacity,
+                  unsigned int *num_dropped)
+  {
+    queue_type queue = bulk::make_work_queue<unsigned int>(g, queue_capacity, overflow_storage, overflow_capacity);
+
+    if(g.this_exec.index() == 0)
+    {
+      distances[source] = 0;
+      queue.push(source);
+    }
+
+    visit_neighbors f = {row_offsets, columns, distances, num_dropped, queue};
+
+    // each drain consumes a level of the search & pushes the next
+    while(queue.drain(g, f) > 0)
+    {
+      ;
+    }
+
+    bulk::free(g, queue);
+  }
+};
+
+
+// a ring, so that every vertex is reachable, plus random edges
+void make_graph(unsigned int n, unsigned int degree, std::vector<unsigned int> &row_offsets, std::vector<unsigned int> &columns)
+{
+  row_offsets.resize(n + 1);
+  columns.clear();
+
+  for(unsigned int v = 0; v < n; ++v)
+  {
+    row_offsets[v] = columns.size();
+
+    columns.push_back((v + 1) % n);
+
+    for(unsigned int e = 1; e < degree; ++e)
+    {
+      columns.push_back(std::rand() % n);
+    }
+  }
+
+  row_offsets[n] = columns.size();
+}
+
+
+std::vector<unsigned int> reference_distances(const std::vector<unsigned int> &row_offsets, const std::vector<unsigned int> &columns, unsigned int source)
+{
+  std::vector<unsigned int> result(row_offsets.size() - 1, unvisited);
+
+  std::queue<unsigned int> frontier;
+  result[source] = 0;
+  frontier.push(source);
+
+  while(!frontier.empty())
+  {
+    unsigned int v = frontier.front();
+    frontier.pop();
+
+    for(unsigned int e = row_offsets[v]; e < row_offsets[v+1]; ++e)
+    {
+      unsigned int u = columns[e];
+
+      if(result[u] == unvisited)
+      {
+        result[u] = result[v] + 1;
+        frontier.push(u);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+void test_breadth_first_search(unsigned int n, unsigned int degree)
+{
+  std::vector<unsigned int> h_row_offsets, h_columns;
+  make_graph(n, degree, h_row_offsets, h_columns);
+
+  thrust::device_vector<unsigned int> row_offsets = h_row_offsets;
+  thrust::device_vector<unsigned int> columns = h_columns;
+  thrust::device_vector<unsigned int> distances(n, unvisited);
+  thrust::device_vector<unsigned int> num_dropped(1, 0);
+
+  // the on-chip ring holds small frontiers & the rest spill into global memory
+  // each vertex is pushed at most once, so an overflow ring of n slots never fills
+  const unsigned int groupsize = 256;
+  const unsigned int queue_capacity = 2048;
+  // plus room for the heap's bookkeeping
+  const size_t heap_size = queue_type::storage_size(queue_capacity) + 1024;
+
+  thrust::device_vector<char> overflow_storage(queue_type::overflow_storage_size(n));
+
+  bulk::async(bulk::con(groupsize, heap_size),
+              breadth_first_search(),
+              bulk::root,
+              thrust::raw_pointer_cast(row_offsets.data()),
+              thrust::raw_pointer_cast(columns.data()),
+              thrust::raw_pointer_cast(distances.data()),
+              0u,
+              queue_capacity,
+              thrust::raw_pointer_cast(overflow_storage.data()),
+              n,
+              thrust::raw_pointer_cast(num_dropped.data())).wait();
+
+  assert(num_dropped[0] == 0);
+
+  std::vector<unsigned int> h_distances(n);
+  thrust::copy(distances.begin(), distances.end(), h_distances.begin());
+  assert(h_distances == reference_distances(h_row_offsets, h_columns, 0));
+
+  std::printf("device: breadth-first search of %u vertices of degree %u matches the host\n", n, degree);
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned int n = 1 << 16;
+  unsigned int degree = 4;
+
+  if(argc > 1) n = std::atoi(argv[1]);
+  if(argc > 2) degree = std::atoi(argv[2]);
+
+  test_host_threads(4, 100000, 64, 0);
+  test_host_threads(8, 100000, 16, 64);
+  test_host_threads(3, 50000, 2, 2);
+
+  test_breadth_first_search(n, degree);
+
+  return 0;
+}